@@ -178,6 +178,8 @@
     #define SECTION_OCRAM12 __attribute__((section(".data.$SRAM_OC12")))
     // #define SECTION_OCRAM2 __attribute__((section(".data.$SRAM_OC2")))
     #define SECTION_OCRAM3 __attribute__((section(".data.$SRAM_OC3")))
+    #define SECTION_SHMEM  __attribute__((section(".noinit.$rpmsg_sh_mem")))
+    #define SECTION_SDRAM  __attribute__((section(".noinit.$BOARD_SDRAM")))
 
 #elif __CORTEX_M == 4
     // All instructions are run from ITCM in CORE1, as the program is loaded
@@ -9,6 +9,11 @@
 
 #include <string.h>
 
+/**
+ * @brief Payload of a doorbell, distinguishes it from a Message.
+ */
+#define DOORBELL (0xD00BE11U)
+
 /**
  * @brief Time to wait whilst CORE1 is checking if it has booted successfully.
  */
@@ -23,9 +28,11 @@
     #define CORE1_BOOT_ADDRESS ((uint32_t*)0x20200000)
 
     /**
-     * @brief RPMSG buffer size.
+     * @brief RPMSG buffer size. The two vrings and the two buffers in each
+     * direction take 4KB, the rest of rpmsg_sh_mem is left for the frame
+     * rings (see SECTION_SHMEM).
      */
-    #define SH_MEM_TOTAL_SIZE (0x2000)
+    #define SH_MEM_TOTAL_SIZE (0x1000)
 
 /**
  * @brief Defined by the include binary assembly file (inc_core1_bin.S). The
@@ -65,13 +72,18 @@ namespace multicore {
      */
     MessageCallback message_callback = NULL;
 
+    /**
+     * @brief Doorbell callback.
+     */
+    DoorbellCallback doorbell_callback = NULL;
+
 #if MULTICORE_MASTER
 
     /**
      * @brief Memory for RPMSG.
      */
     static char rpmsg_base[SH_MEM_TOTAL_SIZE]
-        __attribute__((section(".noinit.$rpmsg_sh_mem")));
+        __attribute__((section(".noinit.$rpmsg_sh_mem"), aligned(VRING_ALIGN)));
 
     /**
      * @brief Called when a core triggers an MCMGR event.
@@ -98,9 +110,20 @@ namespace multicore {
                                      __attribute__((unused)) uint32_t source,
                                      __attribute__((unused)) void* context) {
 
-        if (payload_length <= sizeof(Message)) {
+        if (payload_length == sizeof(uint32_t) &&
+            *(uint32_t*)payload == DOORBELL) {
+            if (doorbell_callback != NULL) {
+                doorbell_callback();
+            }
+        } else if (payload_length == sizeof(Message)) {
+            // Passed on straight from the RPMSG buffer, which is only
+            // released after the callback
+            if (message_callback != NULL) {
+                message_callback(*(const Message*)payload);
+            }
+        } else if (payload_length < sizeof(Message)) {
             if (message_callback != NULL) {
-                Message message;
+                Message message = {};
                 memcpy((void*)&message, payload, payload_length);
                 message_callback(message);
             }
@@ -212,14 +235,21 @@ namespace multicore {
         message_callback = callback;
     }
 
-    void send_message(const Message message) {
+    void register_doorbell_callback(DoorbellCallback callback) {
+        doorbell_callback = callback;
+    }
+
+    /**
+     * @brief Sends @p size bytes of @p data to the endpoint on the other core.
+     */
+    static void send(const void* data, const uint32_t size) {
 #ifdef MULTICORE_MASTER
 
         rpmsg_lite_send(rpmsg,
                         endpoint,
                         RPMSG_SLAVE_ENDPOINT_ADDRESS,
-                        (char*)&message,
-                        sizeof(Message),
+                        (char*)data,
+                        size,
                         RL_DONT_BLOCK);
 
 #elif MULTICORE_SLAVE
@@ -227,9 +257,19 @@ namespace multicore {
         rpmsg_lite_send(rpmsg,
                         endpoint,
                         RPMSG_MASTER_ENDPOINT_ADDRESS,
-                        (char*)&message,
-                        sizeof(Message),
+                        (char*)data,
+                        size,
                         RL_DONT_BLOCK);
 #endif
     }
+
+    void send_message(const Message& message) {
+        send(&message, sizeof(Message));
+    }
+
+    void ring_doorbell() {
+        const uint32_t doorbell = DOORBELL;
+
+        send(&doorbell, sizeof(doorbell));
+    }
 }
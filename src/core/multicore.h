@@ -13,7 +13,9 @@ namespace multicore {
         uint16_t data[164];
     };
 
-    typedef void (*MessageCallback)(const Message message);
+    typedef void (*MessageCallback)(const Message& message);
+
+    typedef void (*DoorbellCallback)();
 
     /**
      * @brief Initialises the MCMGR module.
@@ -35,10 +37,23 @@ namespace multicore {
      */
     void register_message_callback(MessageCallback message_callback);
 
+    /**
+     * @brief Register a callback for when the other core rings the doorbell.
+     * Called from the interrupt handler.
+     */
+    void register_doorbell_callback(DoorbellCallback doorbell_callback);
+
     /**
      * @brief Sends a @p message to the other core.
      */
-    void send_message(const Message message);
+    void send_message(const Message& message);
+
+    /**
+     * @brief Notifies the other core that there is new data in memory shared
+     * between the cores, e.g. a frame_ring::Ring. Only sends a single word,
+     * the data itself is not copied.
+     */
+    void ring_doorbell();
 };
 
 #endif
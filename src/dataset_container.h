@@ -0,0 +1,84 @@
+#ifndef DATASET_CONTAINER_H_
+#define DATASET_CONTAINER_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Alignment of the index and the frames in the container, which is the
+ * block size of the SD card, so that every frame is read with whole blocks.
+ */
+#define DATASET_CONTAINER_ALIGNMENT (512U)
+
+#define DATASET_CONTAINER_VERSION (1U)
+
+/**
+ * @brief File extension of a container, which is placed next to the dataset
+ * directory (e.g. /v23.vds for /v23).
+ */
+#define DATASET_CONTAINER_EXTENSION ".vds"
+
+/**
+ * @brief Format of a dataset packed into a single file by vio_dataset_pack,
+ * which replaces the directory of PNGs.
+ *
+ * The file starts with a Header, followed by the index (an Entry per frame,
+ * ordered by the frame index) at Header::index_offset. The frames are raw
+ * 8 bit grayscale images, each starting at a multiple of
+ * DATASET_CONTAINER_ALIGNMENT and padded up to the next one. All values are
+ * little-endian.
+ */
+namespace dataset_container {
+
+    struct __attribute__((packed)) Header {
+        /**
+         * @brief dataset_container::MAGIC.
+         */
+        char magic[8];
+
+        uint32_t version;
+        uint32_t frame_count;
+
+        /**
+         * @brief Offset of the index in the file.
+         */
+        uint32_t index_offset;
+    };
+
+    struct __attribute__((packed)) Entry {
+        /**
+         * @brief Index of the frame in the dataset, which is the number of
+         * the PNG it was converted from.
+         */
+        uint32_t index;
+
+        /**
+         * @brief Offset of the frame in the file.
+         */
+        uint32_t offset;
+
+        uint16_t width;
+        uint16_t height;
+
+        /**
+         * @brief Keeps the timestamp 8-byte aligned, 0.
+         */
+        uint32_t reserved;
+
+        /**
+         * @brief Time of the frame in nanoseconds, 0 if unknown.
+         */
+        uint64_t timestamp;
+    };
+
+    constexpr char MAGIC[8] = {'V', 'I', 'O', 'D', 'S', 'E', 'T', '\0'};
+
+    /**
+     * @return @p offset rounded up to DATASET_CONTAINER_ALIGNMENT.
+     */
+    constexpr uint32_t align(const uint32_t offset) {
+        return (offset + DATASET_CONTAINER_ALIGNMENT - 1) &
+               ~(DATASET_CONTAINER_ALIGNMENT - 1);
+    }
+}
+
+#endif
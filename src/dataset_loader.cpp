@@ -4,11 +4,15 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "ff.h"
+#ifdef CPU_MIMXRT1166DVM6A
+    #include "ff.h"
+#endif
 
+#include "dataset_container.h"
 #include "file_system.h"
 #include "lodepng.h"
 #include "logger.h"
+#include "png_decoder.h"
 
 #include "algorithm.h"
 
@@ -19,29 +23,366 @@ namespace dataset_loader {
      */
     static size_t current_file_index = 1;
 
+    /**
+     * @brief The container of the dataset, if there is one next to its
+     * directory, see dataset_container.h.
+     */
+    static struct {
+        bool active;
+
+#ifdef CPU_MIMXRT1166DVM6A
+        file_system::File file;
+#else
+        const uint8_t* data;
+        size_t size;
+#endif
+
+        uint32_t frame_count;
+
+        /**
+         * @brief The index of the container, allocated once in initialise.
+         */
+        dataset_container::Entry* entries;
+    } container;
+
+    /**
+     * @brief State of the image retrieved with begin_retrieve_image_into.
+     */
+    static struct {
+        /**
+         * @brief Set while the frame is read by the DMA of the SD controller.
+         */
+        bool reading;
+
+        /**
+         * @brief Result of the retrieval when it was not started in the
+         * background.
+         */
+        bool result;
+    } retrieval;
+
+    /**
+     * @brief Reads @p size bytes at @p offset of the container into @p
+     * out_buffer.
+     */
+    static bool read_container(const uint32_t offset,
+                               uint8_t* out_buffer,
+                               const uint32_t size) {
+#ifdef CPU_MIMXRT1166DVM6A
+        uint32_t bytes_read = 0;
+
+        return file_system::seek(container.file, offset) &&
+               file_system::read(container.file,
+                                 out_buffer,
+                                 size,
+                                 &bytes_read) &&
+               bytes_read == size;
+#else
+        if ((size_t)offset + size > container.size) {
+            return false;
+        }
+
+        memcpy(out_buffer, container.data + offset, size);
+
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Opens the container at @p container_path and reads its index.
+     */
+    static bool open_container(const char* container_path) {
+
+#ifdef CPU_MIMXRT1166DVM6A
+        if (!file_system::open(container_path, container.file)) {
+            return false;
+        }
+#else
+        container.data = file_system::map(container_path, &container.size);
+
+        if (container.data == NULL) {
+            return false;
+        }
+#endif
+
+        // The container has to be closed on failure
+        container.active = true;
+
+        dataset_container::Header header;
+
+        if (!read_container(0, (uint8_t*)&header, sizeof(header)) ||
+            memcmp(header.magic,
+                   dataset_container::MAGIC,
+                   sizeof(header.magic)) != 0 ||
+            header.version != DATASET_CONTAINER_VERSION) {
+            logger::errorf("%s is not a dataset container\r\n",
+                           container_path);
+            return false;
+        }
+
+        const uint32_t index_size = header.frame_count *
+                                    sizeof(dataset_container::Entry);
+
+        container.entries = (dataset_container::Entry*)malloc(index_size);
+
+        if (container.entries == NULL) {
+            logger::errorf("Container index allocation failed\r\n");
+            return false;
+        }
+
+        if (!read_container(header.index_offset,
+                            (uint8_t*)container.entries,
+                            index_size)) {
+            logger::errorf("Failed to read the index of %s\r\n",
+                           container_path);
+            return false;
+        }
+
+        container.frame_count = header.frame_count;
+
+        return true;
+    }
+
     void initialise(const char* path) {
 
         current_file_index = 1;
 
         deinitialise();
 
+        char container_path[64] = "";
+        snprintf(container_path,
+                 sizeof(container_path),
+                 "%s" DATASET_CONTAINER_EXTENSION,
+                 path);
+
+        if (file_system::exists(container_path)) {
+            if (open_container(container_path)) {
+                logger::infof("Loading dataset from %s\r\n", container_path);
+                return;
+            }
+
+            deinitialise();
+        }
+
         file_system::cd(path);
     }
 
-    void deinitialise() {}
+    void deinitialise() {
 
-    bool retrieve_image(image::Image& image, const int32_t index) {
+        if (!container.active) {
+            return;
+        }
 
-        // Retrieve next element in directory
-        char file_path[16] = "";
+#ifdef CPU_MIMXRT1166DVM6A
+        file_system::close(container.file);
+#else
+        file_system::unmap(container.data, container.size);
+#endif
+
+        free(container.entries);
 
+        memset(&container, 0, sizeof(container));
+    }
+
+    /**
+     * @return The index of the image at @p index, or the next one if -1.
+     */
+    static uint32_t next_index(const int32_t index) {
         if (index == -1) {
-            sprintf(file_path, "%u.png", current_file_index++);
-        } else {
-            sprintf(file_path, "%ld.png", index);
-            current_file_index = index + 1;
+            return (uint32_t)current_file_index++;
+        }
+
+        current_file_index = index + 1;
+
+        return (uint32_t)index;
+    }
+
+    /**
+     * @brief Places the file name of the image at @p index, or the next one
+     * if -1, in @p file_path.
+     */
+    static void image_file_path(char* file_path, const int32_t index) {
+        sprintf(file_path, "%lu.png", (unsigned long)next_index(index));
+    }
+
+    /**
+     * @return The entry of the frame at @p index in the container, NULL if
+     * there is none.
+     */
+    static const dataset_container::Entry* find_entry(const uint32_t index) {
+
+        // The entries are ordered by index, which usually start at 1 without
+        // gaps, so the entry is looked up directly before searching
+        if (index >= 1 && index <= container.frame_count &&
+            container.entries[index - 1].index == index) {
+            return &container.entries[index - 1];
         }
 
+        uint32_t low  = 0;
+        uint32_t high = container.frame_count;
+
+        while (low < high) {
+            const uint32_t middle = low + (high - low) / 2;
+
+            if (container.entries[middle].index < index) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+
+        if (low < container.frame_count &&
+            container.entries[low].index == index) {
+            return &container.entries[low];
+        }
+
+        return NULL;
+    }
+
+    /**
+     * @brief Reads the frame at @p index in the container into @p image.
+     *
+     * @param capacity The size of image.data, or 0 to allocate it.
+     */
+    static bool retrieve_container_image(image::Image& image,
+                                         const size_t capacity,
+                                         const int32_t index) {
+
+        const dataset_container::Entry* entry = find_entry(next_index(index));
+
+        if (entry == NULL) {
+            return false;
+        }
+
+        const uint32_t size = (uint32_t)entry->width * entry->height;
+
+        if (capacity == 0) {
+            image.data = (uint8_t*)malloc(size);
+
+            if (image.data == NULL) {
+                logger::errorf("Image allocation failed\r\n");
+                return false;
+            }
+        } else if (size > capacity) {
+            logger::errorf("Frame %lu does not fit in %lu bytes\r\n",
+                           (unsigned long)entry->index,
+                           (unsigned long)capacity);
+            return false;
+        }
+
+        image.width  = entry->width;
+        image.height = entry->height;
+
+        // The frame starts at a sector, so on the target FatFs reads all its
+        // whole sectors straight into the image, without going through its
+        // sector buffer
+        if (!read_container(entry->offset, image.data, size)) {
+            logger::errorf("Failed to read frame %lu\r\n",
+                           (unsigned long)entry->index);
+
+            if (capacity == 0) {
+                free(image.data);
+                image.data = NULL;
+            }
+
+            return false;
+        }
+
+        return true;
+    }
+
+    bool begin_retrieve_image_into(image::Image& image,
+                                   const size_t capacity,
+                                   const int32_t index) {
+
+        retrieval.reading = false;
+
+#ifdef CPU_MIMXRT1166DVM6A
+        if (container.active) {
+            const int32_t next = index == -1 ? (int32_t)current_file_index
+                                             : index;
+
+            const dataset_container::Entry* entry = find_entry(next);
+
+            // The read covers whole sectors, so it includes the padding of
+            // the frame
+            uint32_t size = 0;
+
+            if (entry != NULL) {
+                size = dataset_container::align((uint32_t)entry->width *
+                                                entry->height);
+            }
+
+            if (entry != NULL && size <= capacity &&
+                file_system::begin_read(container.file,
+                                        entry->offset,
+                                        image.data,
+                                        size)) {
+
+                current_file_index = next + 1;
+
+                image.width  = entry->width;
+                image.height = entry->height;
+
+                retrieval.reading = true;
+                return true;
+            }
+        }
+#endif
+
+        retrieval.result = retrieve_image_into(image, capacity, index);
+
+        return retrieval.result;
+    }
+
+    bool end_retrieve_image() {
+#ifdef CPU_MIMXRT1166DVM6A
+        if (retrieval.reading) {
+            retrieval.reading = false;
+            retrieval.result  = file_system::end_read();
+        }
+#endif
+
+        return retrieval.result;
+    }
+
+    bool timestamp(const int32_t index, uint64_t* out_timestamp) {
+
+        if (!container.active) {
+            return false;
+        }
+
+        const dataset_container::Entry* entry = find_entry((uint32_t)index);
+
+        if (entry == NULL) {
+            return false;
+        }
+
+        *out_timestamp = entry->timestamp;
+
+        return true;
+    }
+
+    static bool read_file(void* context,
+                          uint8_t* buffer,
+                          const uint32_t size,
+                          uint32_t* out_read) {
+        return file_system::read(*(file_system::File*)context,
+                                 buffer,
+                                 size,
+                                 out_read);
+    }
+
+    bool retrieve_image(image::Image& image, const int32_t index) {
+
+        if (container.active) {
+            return retrieve_container_image(image, 0, index);
+        }
+
+        // Retrieve next element in directory
+        char file_path[16] = "";
+        image_file_path(file_path, index);
+
         // Retrieve the file size
         uint32_t file_size = 0;
         if (!file_system::size(file_path, &file_size)) {
@@ -65,14 +406,19 @@ namespace dataset_loader {
         }
 
         // Now we decode the PNG
+        unsigned int width = 0, height = 0;
+
         uint8_t decode_status = lodepng_decode_memory(&image.data,
-                                                      &image.width,
-                                                      &image.height,
+                                                      &width,
+                                                      &height,
                                                       file_content_buffer,
                                                       file_size,
                                                       LCT_GREY,
                                                       8);
 
+        image.width  = width;
+        image.height = height;
+
         // Free the file content buffer now that we have the PNG data
         free(file_content_buffer);
 
@@ -85,4 +431,73 @@ namespace dataset_loader {
 
         return true;
     }
+
+    bool retrieve_image_into(image::Image& image,
+                             const size_t capacity,
+                             const int32_t index) {
+
+        if (container.active) {
+            return retrieve_container_image(image, capacity, index);
+        }
+
+        char file_path[16] = "";
+        image_file_path(file_path, index);
+
+        file_system::File file;
+
+        if (!file_system::open(file_path, file)) {
+            return false;
+        }
+
+        uint32_t width = 0, height = 0;
+
+        const png_decoder::Status status = png_decoder::decode(read_file,
+                                                               &file,
+                                                               image.data,
+                                                               capacity,
+                                                               &width,
+                                                               &height);
+
+        file_system::close(file);
+
+        image.width  = width;
+        image.height = height;
+
+        if (status == png_decoder::STATUS_UNSUPPORTED) {
+            // Fall back to LodePNG, which allocates
+            image::Image image_heap;
+
+            if (!retrieve_image(image_heap, index == -1
+                                                ? current_file_index - 1
+                                                : index)) {
+                return false;
+            }
+
+            const bool fits = (size_t)image_heap.width * image_heap.height <=
+                              capacity;
+
+            if (fits) {
+                memcpy(image.data,
+                       image_heap.data,
+                       image_heap.width * image_heap.height);
+            } else {
+                logger::errorf("Image %s does not fit in %lu bytes\r\n",
+                               file_path,
+                               (unsigned long)capacity);
+            }
+
+            free(image_heap.data);
+
+            return fits;
+        }
+
+        if (status != png_decoder::STATUS_OK) {
+            logger::errorf("Error happened while decoding %s. Status: %d\r\n",
+                           file_path,
+                           status);
+            return false;
+        }
+
+        return true;
+    }
 }
@@ -11,6 +11,10 @@ namespace dataset_loader {
     /**
      * @brief Sets the working directory for the dataset loader and retrieves
      * the file names for the data in the directory.
+     *
+     * If a container packed with vio_dataset_pack exists at @p path with the
+     * extension .vds (e.g. /v23.vds for /v23), the frames are read from it
+     * instead, see dataset_container.h.
      */
     void initialise(const char* path);
 
@@ -30,6 +34,53 @@ namespace dataset_loader {
      */
     bool retrieve_image(image::Image& image, const int32_t index = -1);
 
+    /**
+     * @brief Retrieves the next image in the working directory into the
+     * caller's buffer, without allocating. The PNG is streamed from the file
+     * and decoded row by row, see png_decoder.h.
+     *
+     * @param image The image, where image.data has to point to @p capacity
+     * bytes. The width and height are set.
+     * @param index Optional index, if set to -1, the next image in the
+     * directory will be loaded.
+     *
+     * @return true if image was retrieved.
+     */
+    bool retrieve_image_into(image::Image& image,
+                             const size_t capacity,
+                             const int32_t index = -1);
+
+    /**
+     * @brief Starts retrieving the image like retrieve_image_into, to be
+     * completed with end_retrieve_image.
+     *
+     * On the target, frames of a container are read by the DMA of the SD
+     * controller in the background, for which @p capacity has to include the
+     * padding of the frame to the next sector. Otherwise, the image is
+     * retrieved before returning. Until end_retrieve_image has returned, no
+     * other function of the dataset loader or the file system may be called.
+     *
+     * @return false if the image could not be retrieved.
+     */
+    bool begin_retrieve_image_into(image::Image& image,
+                                   const size_t capacity,
+                                   const int32_t index = -1);
+
+    /**
+     * @brief Waits for the image started with begin_retrieve_image_into.
+     *
+     * @return true if the image was retrieved.
+     */
+    bool end_retrieve_image();
+
+    /**
+     * @brief Retrieves the timestamp in nanoseconds of the image at @p index,
+     * which is only stored in containers.
+     *
+     * @return true if the dataset is a container with the image.
+     */
+    bool timestamp(const int32_t index, uint64_t* out_timestamp);
+
 }
 
 #endif
@@ -11,6 +11,8 @@
 #include "fsl_iomuxc.h"
 #pragma GCC diagnostic pop
 
+#include "fsl_cache.h"
+
 #include "ff.h"
 
 #include "logger.h"
@@ -90,6 +92,35 @@ static char current_directory_path[64] = "";
  */
 const TCHAR volume[3U] = {SDDISK + '0', ':', '/'};
 
+/**
+ * @brief The read started with begin_read, which the host driver accesses
+ * until it has completed.
+ */
+static struct {
+    bool pending;
+
+    uint8_t* buffer;
+    uint32_t size;
+
+    sdmmchost_cmd_t command;
+    sdmmchost_data_t data;
+    sdmmchost_transfer_t transfer;
+} async_read;
+
+/**
+ * @brief Time to wait for a read started with begin_read, forever as in the
+ * host driver.
+ */
+#define ASYNC_READ_TIMEOUT (~0U)
+
+/**
+ * @brief Events of the host driver which end a transfer.
+ */
+#define TRANSFER_EVENTS                        \
+    (SDMMC_OSA_EVENT_TRANSFER_CMD_FAIL |       \
+     SDMMC_OSA_EVENT_TRANSFER_DATA_SUCCESS |   \
+     SDMMC_OSA_EVENT_TRANSFER_DATA_FAIL)
+
 static void power_control(bool enable) {
     GPIO_PinWrite(SDMMC_SD_POWER_RESET_GPIO_BASE,
                   SDMMC_SD_POWER_RESET_GPIO_PIN,
@@ -379,6 +410,243 @@ namespace file_system {
         return true;
     }
 
+    bool open(const char* path, File& file) {
+
+        file.fragmented = false;
+
+        FRESULT status = f_open(&file.handle, path, FA_READ);
+
+        if (status != FR_OK) {
+            logger::errorf("Failed to open file: %s\r\n", path);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool read(File& file,
+              uint8_t* out_buffer,
+              const uint32_t bytes_to_read,
+              uint32_t* out_bytes_read) {
+
+        UINT bytes_read = 0;
+
+        FRESULT status = f_read(&file.handle,
+                                out_buffer,
+                                bytes_to_read,
+                                &bytes_read);
+
+        *out_bytes_read = bytes_read;
+
+        if (status != FR_OK) {
+            logger::errorf("Reading file failed with error code: %d\r\n",
+                           status);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool seek(File& file, const uint32_t offset) {
+
+        FRESULT status = f_lseek(&file.handle, offset);
+
+        if (status != FR_OK) {
+            logger::errorf("Seeking file failed with error code: %d\r\n",
+                           status);
+            return false;
+        }
+
+        return true;
+    }
+
+    void close(File& file) { f_close(&file.handle); }
+
+    /**
+     * @brief Finds the sector on the card at @p offset of @p file, using its
+     * cluster map.
+     *
+     * @return false if the @p size bytes from @p offset are not in one
+     * fragment of the file.
+     */
+    static bool find_sector(File& file,
+                            const uint32_t offset,
+                            const uint32_t size,
+                            LBA_t* out_sector) {
+
+        const FATFS* fat = file.handle.obj.fs;
+
+        const uint32_t cluster_size = (uint32_t)fat->csize * FF_MIN_SS;
+
+        // Index of the first and the last cluster of the range in the file
+        DWORD cluster            = offset / cluster_size;
+        const DWORD cluster_span = (offset + size - 1) / cluster_size -
+                                   cluster;
+
+        // The map is a list of (length, first cluster) of the fragments
+        const DWORD* fragment = &file.cluster_map[1];
+
+        while (fragment[0] != 0) {
+            const DWORD length = fragment[0];
+
+            if (cluster < length) {
+                if (cluster + cluster_span >= length) {
+                    return false;
+                }
+
+                *out_sector = fat->database +
+                              (LBA_t)(fragment[1] + cluster - 2) * fat->csize +
+                              (offset % cluster_size) / FF_MIN_SS;
+                return true;
+            }
+
+            cluster -= length;
+            fragment += 2;
+        }
+
+        return false;
+    }
+
+    bool begin_read(File& file,
+                    const uint32_t offset,
+                    uint8_t* out_buffer,
+                    const uint32_t size) {
+
+        if (async_read.pending || file.fragmented || size == 0 ||
+            offset % FF_MIN_SS != 0 || size % FF_MIN_SS != 0 ||
+            (uint32_t)out_buffer % SDMMC_DATA_BUFFER_ALIGN_SIZE != 0) {
+            return false;
+        }
+
+        if (file.handle.cltbl == NULL) {
+            file.cluster_map[0] = FILE_SYSTEM_CLUSTER_MAP_SIZE;
+            file.handle.cltbl   = file.cluster_map;
+
+            if (f_lseek(&file.handle, CREATE_LINKMAP) != FR_OK) {
+                logger::warnf("File is too fragmented to be read with "
+                              "DMA\r\n");
+                file.handle.cltbl = NULL;
+                file.fragmented   = true;
+                return false;
+            }
+        }
+
+        LBA_t sector = 0;
+
+        if (!find_sector(file, offset, size, &sector)) {
+            return false;
+        }
+
+        // Same as SD_Read, but without waiting for the transfer
+        memset(&async_read, 0, sizeof(async_read));
+
+        async_read.data.blockSize           = FF_MIN_SS;
+        async_read.data.blockCount          = size / FF_MIN_SS;
+        async_read.data.rxData              = (uint32_t*)out_buffer;
+        async_read.data.enableAutoCommand12 = true;
+
+        async_read.command.index = async_read.data.blockCount == 1
+                                       ? (uint32_t)kSDMMC_ReadSingleBlock
+                                       : (uint32_t)kSDMMC_ReadMultipleBlock;
+        async_read.command.argument = (uint32_t)sector;
+
+        if ((g_sd.flags & (uint32_t)kSD_SupportHighCapacityFlag) == 0) {
+            async_read.command.argument *= FF_MIN_SS;
+        }
+
+        async_read.command.responseType       = kCARD_ResponseTypeR1;
+        async_read.command.responseErrorFlags = SDMMC_R1_ALL_ERROR_FLAG;
+
+        async_read.transfer.command = &async_read.command;
+        async_read.transfer.data    = &async_read.data;
+
+        usdhc_adma_config_t dma_config = {};
+        dma_config.dmaMode             = SDMMCHOST_DMA_MODE;
+#if !(defined(FSL_FEATURE_USDHC_HAS_NO_RW_BURST_LEN) && \
+      FSL_FEATURE_USDHC_HAS_NO_RW_BURST_LEN)
+        dma_config.burstLen = kUSDHC_EnBurstLenForINCR;
+#endif
+        dma_config.admaTable      = host.dmaDesBuffer;
+        dma_config.admaTableWords = host.dmaDesBufferWordsNum;
+
+#if ((defined __DCACHE_PRESENT) && __DCACHE_PRESENT) || \
+    (defined FSL_FEATURE_HAS_L1CACHE && FSL_FEATURE_HAS_L1CACHE)
+        // Dirty lines of the buffer must not be evicted over the data
+        DCACHE_CleanInvalidateByRange((uint32_t)out_buffer, size);
+#endif
+
+        (void)SDMMC_OSAEventClear(&host.hostEvent,
+                                  SDMMC_OSA_EVENT_TRANSFER_CMD_SUCCESS |
+                                      TRANSFER_EVENTS);
+
+        if (USDHC_TransferNonBlocking(host.hostController.base,
+                                      &host.handle,
+                                      &dma_config,
+                                      &async_read.transfer) !=
+            kStatus_Success) {
+            return false;
+        }
+
+        async_read.pending = true;
+        async_read.buffer  = out_buffer;
+        async_read.size    = size;
+
+        return true;
+    }
+
+    bool is_read_complete() {
+
+        if (!async_read.pending) {
+            return true;
+        }
+
+        uint32_t events = 0;
+        (void)SDMMC_OSAEventGet(&host.hostEvent, TRANSFER_EVENTS, &events);
+
+        return (events & TRANSFER_EVENTS) != 0;
+    }
+
+    bool end_read() {
+
+        if (!async_read.pending) {
+            return false;
+        }
+
+        async_read.pending = false;
+
+        uint32_t events = 0;
+
+        const bool successful =
+            SDMMC_OSAEventWait(&host.hostEvent,
+                               TRANSFER_EVENTS,
+                               ASYNC_READ_TIMEOUT,
+                               &events) == kStatus_Success &&
+            (events & SDMMC_OSA_EVENT_TRANSFER_DATA_SUCCESS) != 0;
+
+        if (!successful) {
+            logger::errorf("DMA read failed\r\n");
+
+            // Same recovery as the host driver after a failed transfer
+            (void)USDHC_Reset(host.hostController.base,
+                              kUSDHC_ResetCommand | kUSDHC_ResetData,
+                              100U);
+            return false;
+        }
+
+#if ((defined __DCACHE_PRESENT) && __DCACHE_PRESENT) || \
+    (defined FSL_FEATURE_HAS_L1CACHE && FSL_FEATURE_HAS_L1CACHE)
+        DCACHE_InvalidateByRange((uint32_t)async_read.buffer, async_read.size);
+#endif
+
+        return true;
+    }
+
+    bool exists(const char* path) {
+        FILINFO file_information;
+
+        return f_stat(path, &file_information) == FR_OK;
+    }
+
     bool write(const char* path,
                const uint8_t* buffer,
                const uint32_t buffer_length) {
@@ -9,7 +9,43 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#ifdef CPU_MIMXRT1166DVM6A
+    #include "ff.h"
+#else
+    #include <stdio.h>
+#endif
+
+/**
+ * @brief Size of the cluster map of a file in words, which holds
+ * (FILE_SYSTEM_CLUSTER_MAP_SIZE - 1) / 2 fragments.
+ */
+#define FILE_SYSTEM_CLUSTER_MAP_SIZE (32)
+
 namespace file_system {
+
+    /**
+     * @brief A file opened with open, which is read in parts.
+     */
+    struct File {
+#ifdef CPU_MIMXRT1166DVM6A
+        FIL handle;
+
+        /**
+         * @brief Where the clusters of the file are on the card, built by
+         * the first begin_read (see the fast seek of FatFs).
+         */
+        DWORD cluster_map[FILE_SYSTEM_CLUSTER_MAP_SIZE];
+
+        /**
+         * @brief Set if the file has more fragments than fit in the cluster
+         * map, in which case begin_read is not possible.
+         */
+        bool fragmented;
+#else
+        FILE* handle;
+#endif
+    };
+
     /**
      * @brief Initialises the SD controller and mounts the FAT file system on
      * it.
@@ -73,6 +109,93 @@ namespace file_system {
     bool
     read(const char* path, uint8_t* out_buffer, const uint32_t bytes_to_read);
 
+    /**
+     * @brief Opens the file at @p path for reading with read.
+     *
+     * @return true if the file was opened.
+     */
+    bool open(const char* path, File& file);
+
+    /**
+     * @brief Reads the next @p bytes_to_read bytes of @p file into the @p
+     * out_buffer.
+     *
+     * @param out_bytes_read The amount of bytes read, which is less than @p
+     * bytes_to_read at the end of the file.
+     *
+     * @return true if read was successful.
+     */
+    bool read(File& file,
+              uint8_t* out_buffer,
+              const uint32_t bytes_to_read,
+              uint32_t* out_bytes_read);
+
+    /**
+     * @brief Moves the read position of @p file to @p offset bytes from the
+     * start.
+     *
+     * @return true if the position was set.
+     */
+    bool seek(File& file, const uint32_t offset);
+
+    /**
+     * @brief Closes a file opened with open.
+     */
+    void close(File& file);
+
+    /**
+     * @return true if a file or directory exists at @p path. Unlike size, a
+     * missing file is not logged as an error.
+     */
+    bool exists(const char* path);
+
+#ifdef CPU_MIMXRT1166DVM6A
+    /**
+     * @brief Starts reading @p size bytes at @p offset of @p file into @p
+     * out_buffer with the DMA of the SD controller, without waiting for the
+     * read to complete.
+     *
+     * @p offset and @p size have to be multiples of the sector size and @p
+     * out_buffer has to be aligned to a cache line. Until end_read has
+     * returned, no other function of the file system may be called and the
+     * buffer must not be accessed.
+     *
+     * @return false if the read could not be started, e.g. because the range
+     * is not contiguous on the card, in which case it has to be read with
+     * read instead.
+     */
+    bool begin_read(File& file,
+                    const uint32_t offset,
+                    uint8_t* out_buffer,
+                    const uint32_t size);
+
+    /**
+     * @return true if there is no read started with begin_read in progress.
+     */
+    bool is_read_complete();
+
+    /**
+     * @brief Waits for the read started with begin_read to complete.
+     *
+     * @return true if the read was successful.
+     */
+    bool end_read();
+#else
+    /**
+     * @brief Maps the file at @p path into memory read-only. Host only.
+     *
+     * @param out_size The size of the file.
+     *
+     * @return The mapped file, to be unmapped with unmap, or NULL on error.
+     */
+    const uint8_t* map(const char* path, size_t* out_size);
+
+    /**
+     * @brief Unmaps a file mapped with map.
+     */
+    void unmap(const uint8_t* data, const size_t size);
+#endif
+
     /**
      * @brief Writes a @p buffer into a file at @p path.
      *
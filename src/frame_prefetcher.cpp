@@ -0,0 +1,224 @@
+#include "frame_prefetcher.h"
+
+#include "dataset_loader.h"
+
+#include <string.h>
+
+#ifndef CPU_MIMXRT1166DVM6A
+    #include <condition_variable>
+    #include <mutex>
+    #include <thread>
+#endif
+
+namespace frame_prefetcher {
+
+    /**
+     * @brief The frames are read and acquired in order, so the buffer of a
+     * frame follows from the number of frames read, acquired or released
+     * before it.
+     */
+    static struct {
+        Frame frames[PREFETCH_BUFFERS];
+
+        uint8_t* buffers[PREFETCH_BUFFERS];
+        size_t capacity;
+
+        int32_t start_index;
+        int32_t end_index;
+
+        /**
+         * @brief Number of frames whose read has been started, acquired and
+         * released.
+         */
+        uint32_t started;
+        uint32_t acquired;
+        uint32_t released;
+
+#ifndef CPU_MIMXRT1166DVM6A
+        /**
+         * @brief Number of frames the reader thread has completed.
+         */
+        uint32_t read;
+
+        bool stopping;
+
+        std::thread reader;
+        std::mutex mutex;
+        std::condition_variable changed;
+#endif
+    } state;
+
+    /**
+     * @return True if there is a frame left to read and a buffer to read it
+     * into.
+     */
+    static bool can_start() {
+        return state.start_index + (int32_t)state.started <= state.end_index &&
+               state.started - state.released < PREFETCH_BUFFERS;
+    }
+
+    /**
+     * @brief Prepares the frame of the next read in its buffer.
+     */
+    static Frame* next_frame() {
+        Frame* frame = &state.frames[state.started % PREFETCH_BUFFERS];
+
+        frame->index      = state.start_index + (int32_t)state.started;
+        frame->valid      = false;
+        frame->image.data = state.buffers[state.started % PREFETCH_BUFFERS];
+
+        return frame;
+    }
+
+#ifdef CPU_MIMXRT1166DVM6A
+
+    /**
+     * @brief Starts reading the next frame if possible. Only one read is in
+     * progress at a time, as the SD controller transfers one at a time.
+     */
+    static void try_start() {
+        if (state.started != state.acquired || !can_start()) {
+            return;
+        }
+
+        Frame* frame = next_frame();
+
+        // Any error is reported by end_retrieve_image
+        (void)dataset_loader::begin_retrieve_image_into(frame->image,
+                                                        state.capacity,
+                                                        frame->index);
+        state.started++;
+    }
+
+    void start(uint8_t* const buffers[PREFETCH_BUFFERS],
+               const size_t capacity,
+               const int32_t start_index,
+               const int32_t end_index) {
+
+        memset(&state, 0, sizeof(state));
+        memcpy(state.buffers, buffers, sizeof(state.buffers));
+
+        state.capacity    = capacity;
+        state.start_index = start_index;
+        state.end_index   = end_index;
+
+        try_start();
+    }
+
+    const Frame* acquire() {
+        if (state.acquired == state.started) {
+            return NULL;
+        }
+
+        Frame* frame = &state.frames[state.acquired % PREFETCH_BUFFERS];
+
+        frame->valid = dataset_loader::end_retrieve_image();
+
+        state.acquired++;
+
+        try_start();
+
+        return frame;
+    }
+
+    void release() {
+        state.released++;
+
+        try_start();
+    }
+
+    void stop() {
+        if (state.acquired != state.started) {
+            (void)dataset_loader::end_retrieve_image();
+        }
+
+        state.started = state.acquired;
+    }
+
+#else
+
+    /**
+     * @brief Retrieves the frames ahead of the consumer.
+     */
+    static void read_frames() {
+        std::unique_lock<std::mutex> lock(state.mutex);
+
+        while (true) {
+            state.changed.wait(lock,
+                               [] { return state.stopping || can_start(); });
+
+            if (state.stopping) {
+                return;
+            }
+
+            Frame* frame = next_frame();
+            state.started++;
+
+            // The buffer belongs to this thread until the frame is read
+            lock.unlock();
+            frame->valid = dataset_loader::retrieve_image_into(frame->image,
+                                                               state.capacity,
+                                                               frame->index);
+            lock.lock();
+
+            state.read++;
+            state.changed.notify_all();
+        }
+    }
+
+    void start(uint8_t* const buffers[PREFETCH_BUFFERS],
+               const size_t capacity,
+               const int32_t start_index,
+               const int32_t end_index) {
+
+        stop();
+
+        memcpy(state.buffers, buffers, sizeof(state.buffers));
+
+        state.capacity    = capacity;
+        state.start_index = start_index;
+        state.end_index   = end_index;
+        state.started     = 0;
+        state.acquired    = 0;
+        state.released    = 0;
+        state.read        = 0;
+        state.stopping    = false;
+
+        state.reader = std::thread(read_frames);
+    }
+
+    const Frame* acquire() {
+        std::unique_lock<std::mutex> lock(state.mutex);
+
+        if (state.start_index + (int32_t)state.acquired > state.end_index) {
+            return NULL;
+        }
+
+        state.changed.wait(lock,
+                           [] { return state.read > state.acquired; });
+
+        return &state.frames[state.acquired++ % PREFETCH_BUFFERS];
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(state.mutex);
+
+        state.released++;
+        state.changed.notify_all();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+
+            state.stopping = true;
+            state.changed.notify_all();
+        }
+
+        if (state.reader.joinable()) {
+            state.reader.join();
+        }
+    }
+
+#endif
+}
@@ -0,0 +1,77 @@
+#ifndef FRAME_PREFETCHER_H_
+#define FRAME_PREFETCHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image.h"
+
+/**
+ * @brief Number of image buffers of the prefetcher. With two buffers, the
+ * next frame is read into one while the current frame in the other is
+ * processed.
+ */
+#define PREFETCH_BUFFERS (2)
+
+/**
+ * @brief Double-buffered reader of the frames of the dataset set up with
+ * dataset_loader::initialise, which reads the next frame while the current
+ * one is processed.
+ *
+ * On the target, the next frame of a container (see dataset_container.h) is
+ * read by the DMA of the SD controller in the background (see
+ * dataset_loader::begin_retrieve_image_into), PNGs are still decoded when
+ * the frame is acquired. On the host, a reader thread retrieves the frames
+ * ahead.
+ *
+ * A frame belongs to the caller from acquire until release, and only one
+ * frame can be acquired at a time. While the prefetcher runs, the dataset
+ * loader and the file system must not be used otherwise.
+ */
+namespace frame_prefetcher {
+
+    struct Frame {
+        /**
+         * @brief Index of the image in the dataset.
+         */
+        int32_t index;
+
+        /**
+         * @brief False if the image could not be retrieved.
+         */
+        bool valid;
+
+        image::Image image;
+    };
+
+    /**
+     * @brief Starts reading the frames in [@p start_index, @p end_index] into
+     * @p buffers, which hold @p capacity bytes each and are aligned to a cache
+     * line. On the target, the capacity has to include the padding of the
+     * frames to the next sector for them to be read in the background.
+     */
+    void start(uint8_t* const buffers[PREFETCH_BUFFERS],
+               const size_t capacity,
+               const int32_t start_index,
+               const int32_t end_index);
+
+    /**
+     * @brief Waits for the next frame and starts reading the one after it.
+     *
+     * @return The frame, or NULL after the last frame.
+     */
+    const Frame* acquire();
+
+    /**
+     * @brief Hands the buffer of the frame returned by acquire back to the
+     * prefetcher.
+     */
+    void release();
+
+    /**
+     * @brief Waits for the frame being read and stops the prefetcher.
+     */
+    void stop();
+}
+
+#endif
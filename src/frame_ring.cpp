@@ -0,0 +1,103 @@
+#include "frame_ring.h"
+
+#include <stddef.h>
+
+#ifdef CPU_MIMXRT1166DVM6A
+    #include "fsl_cache.h"
+#endif
+
+/**
+ * @brief Size of a line in the data caches of both cores.
+ */
+#define CACHE_LINE_SIZE (32U)
+
+namespace frame_ring {
+
+    void initialise(Ring& ring) {
+        ring.head.store(0, std::memory_order_relaxed);
+        ring.tail.store(0, std::memory_order_release);
+    }
+
+    uint32_t size(const Ring& ring) {
+        return ring.head.load(std::memory_order_acquire) -
+               ring.tail.load(std::memory_order_acquire);
+    }
+
+    bool push(Ring& ring, const Descriptor& descriptor) {
+        const uint32_t head = ring.head.load(std::memory_order_relaxed);
+
+        // The acquire makes sure that the consumer is done with the
+        // descriptor (and the buffer it refers to) before it is overwritten
+        if (head - ring.tail.load(std::memory_order_acquire) >=
+            FRAME_RING_CAPACITY) {
+            return false;
+        }
+
+        ring.descriptors[head & (FRAME_RING_CAPACITY - 1)] = descriptor;
+
+        // The release makes the descriptor visible before the new head
+        ring.head.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    const Descriptor* front(Ring& ring) {
+        const uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+
+        if (ring.head.load(std::memory_order_acquire) == tail) {
+            return NULL;
+        }
+
+        return &ring.descriptors[tail & (FRAME_RING_CAPACITY - 1)];
+    }
+
+    void pop(Ring& ring) {
+        const uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+
+        ring.tail.store(tail + 1, std::memory_order_release);
+    }
+
+#ifdef CPU_MIMXRT1166DVM6A
+
+    /**
+     * @brief The cache maintenance operations work on whole lines, so the
+     * range is extended to the lines which @p data and @p size touch.
+     */
+    static void line_range(const void* data,
+                           const size_t size,
+                           uint32_t* out_address,
+                           uint32_t* out_size) {
+
+        const uint32_t start = (uint32_t)data & ~(CACHE_LINE_SIZE - 1);
+        const uint32_t end   = ((uint32_t)data + size + CACHE_LINE_SIZE - 1) &
+                             ~(CACHE_LINE_SIZE - 1);
+
+        *out_address = start;
+        *out_size    = end - start;
+    }
+
+    void clean(const void* data, const size_t size) {
+        uint32_t address, bytes;
+        line_range(data, size, &address, &bytes);
+
+        DCACHE_CleanByRange(address, bytes);
+    }
+
+    void invalidate(const void* data, const size_t size) {
+        uint32_t address, bytes;
+        line_range(data, size, &address, &bytes);
+
+        DCACHE_InvalidateByRange(address, bytes);
+    }
+
+#else
+
+    void clean(__attribute__((unused)) const void* data,
+               __attribute__((unused)) const size_t size) {}
+
+    void invalidate(__attribute__((unused)) const void* data,
+                    __attribute__((unused)) const size_t size) {}
+
+#endif
+
+}
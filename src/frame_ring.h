@@ -0,0 +1,124 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Number of descriptors in a ring, has to be a power of two.
+ */
+#define FRAME_RING_CAPACITY (8)
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring of frame descriptors,
+ * used to hand frames between the cores without copying them.
+ *
+ * The ring itself only holds small descriptors which refer to a buffer in a
+ * pool that both sides know about, the data of the frames is never copied.
+ * On the target, the ring is placed in the shared memory of RPMsg
+ * (rpmsg_sh_mem), which is not cached by CORE0, while the frames can be in
+ * cached memory: the producer calls clean on a frame before it pushes its
+ * descriptor, and the consumer calls invalidate on it after it has read the
+ * descriptor. RPMsg is then only needed as a doorbell, see
+ * multicore::ring_doorbell.
+ *
+ * On the host, the same ring is used between threads or processes sharing
+ * memory, see main_ring_benchmark.cpp.
+ */
+namespace frame_ring {
+
+    struct Descriptor {
+        /**
+         * @brief Index of the buffer in the pool of the producer and consumer.
+         */
+        uint32_t slot;
+
+        /**
+         * @brief Number of bytes used in the buffer.
+         */
+        uint32_t size;
+
+        /**
+         * @brief Sequence number of the frame, e.g. the index in the dataset.
+         */
+        int32_t sequence;
+
+        /**
+         * @brief Free to use by the producer and consumer.
+         */
+        uint32_t user;
+    };
+
+    struct Ring {
+        /**
+         * @brief Number of descriptors pushed, only written by the producer.
+         */
+        __attribute__((aligned(32))) std::atomic<uint32_t> head;
+
+        /**
+         * @brief Number of descriptors popped, only written by the consumer.
+         * Kept on a separate cache line from the head.
+         */
+        __attribute__((aligned(32))) std::atomic<uint32_t> tail;
+
+        __attribute__((aligned(32)))
+        Descriptor descriptors[FRAME_RING_CAPACITY];
+    };
+
+    static_assert((FRAME_RING_CAPACITY & (FRAME_RING_CAPACITY - 1)) == 0,
+                  "FRAME_RING_CAPACITY has to be a power of two");
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free,
+                  "The ring requires lock-free atomics");
+
+    /**
+     * @brief Empties @p ring. Has to be called before either side starts.
+     */
+    void initialise(Ring& ring);
+
+    /**
+     * @return The number of descriptors pushed but not popped yet. Exact for
+     * the producer and consumer, an estimate for anyone else.
+     */
+    uint32_t size(const Ring& ring);
+
+    /**
+     * @brief Called by the producer to append @p descriptor to @p ring.
+     *
+     * @return False if the ring is full.
+     */
+    bool push(Ring& ring, const Descriptor& descriptor);
+
+    /**
+     * @brief Called by the consumer to peek at the oldest descriptor. The
+     * buffer it refers to stays with the consumer until the descriptor is
+     * popped.
+     *
+     * @return The descriptor, or NULL if the ring is empty.
+     */
+    const Descriptor* front(Ring& ring);
+
+    /**
+     * @brief Called by the consumer to remove the descriptor returned by
+     * front, after which the producer may reuse its buffer.
+     */
+    void pop(Ring& ring);
+
+    /**
+     * @brief Writes the cached contents of @p data back to memory, so that the
+     * other core sees them. Called by the producer before it pushes the
+     * descriptor of @p data. Does nothing on the host.
+     */
+    void clean(const void* data, const size_t size);
+
+    /**
+     * @brief Discards the cached contents of @p data, so that the next reads
+     * see what the other core wrote. Called by the consumer after front.
+     * As whole cache lines are discarded, @p data should not share a line
+     * with anything else the consumer writes. Does nothing on the host.
+     */
+    void invalidate(const void* data, const size_t size);
+}
+
+#endif
@@ -0,0 +1,1626 @@
+#include "benchmark.h"
+
+#include "dataset_loader.h"
+#include "feature_extraction.h"
+#include "feature_tracking.h"
+#include "frame_prefetcher.h"
+#include "logger.h"
+#include "pipeline.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace benchmark {
+
+    static const char* stage_names[NUMBER_OF_STAGES] =
+        {"load", "pyramid", "track", "extract", "patches", "total"};
+
+    /**
+     * @brief Buffer for the image data.
+     */
+    static __attribute__((aligned(32)))
+    uint8_t image_data[MAX_IMAGE_WIDTH * MAX_IMAGE_HEIGHT];
+
+    /**
+     * @brief Second buffer for the image read ahead when prefetching.
+     */
+    static __attribute__((aligned(32)))
+    uint8_t prefetch_image_data[MAX_IMAGE_WIDTH * MAX_IMAGE_HEIGHT];
+
+    /**
+     * @brief Buffer for the lower levels of the image pyramid.
+     */
+    static uint8_t image_pyramid_buffer[0x20000];
+
+    /**
+     * @brief Buffers for every other frame when the forward-backward check
+     * is enabled, which keep the image pyramid of the previous frame valid
+     * to track back into.
+     */
+    static __attribute__((aligned(32)))
+    uint8_t previous_image_data[MAX_IMAGE_WIDTH * MAX_IMAGE_HEIGHT];
+
+    static uint8_t previous_image_pyramid_buffer[0x20000];
+
+    /**
+     * @brief Buffer of the image pyramid when it is built lazily.
+     */
+    static uint8_t lazy_image_pyramid_buffer[LAZY_PYRAMID_BUFFER_SIZE];
+
+    static image::KeyPoint keypoints[MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL];
+
+    static image::KeyPoint
+        end_keypoints[MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL];
+
+    /**
+     * @brief The end keypoints tracked back to the previous frame, see
+     * frontend::check_forward_backward.
+     */
+    static image::KeyPoint
+        backward_keypoints[MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL];
+
+    /**
+     * @brief Number of frames each of the keypoints has been tracked over
+     * since it was detected.
+     */
+    static uint32_t track_lengths[MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL];
+
+    static frontend::TrackQuality
+        track_qualities[MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL];
+
+    /**
+     * @brief The corners ANMS selects from, sized by the configuration.
+     */
+    static std::vector<uint32_t> anms_candidates;
+
+    /**
+     * @brief Size of the grid the coverage of the keypoints is measured on.
+     */
+#define COVERAGE_COLUMNS (8)
+#define COVERAGE_ROWS    (6)
+
+    /**
+     * @brief The patch pyramids of a tracker configuration, see
+     * FOR_EACH_TRACKER_CONFIGURATION. Pooled pyramids take their patches from
+     * pools sized for the most features the benchmark tracks.
+     */
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    struct TrackerPatches {
+        static image::BasicPatchPyramid<Levels, Size, Capacity> patch_pyramid;
+
+        static image::BasicFixedPointPatchPyramid<Levels, Size, Capacity>
+            fixed_point_patch_pyramid;
+
+        static image::BasicPatch<Size>
+            patch_pool[MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL * Levels];
+
+        static image::BasicFixedPointPatch<Size> fixed_point_patch_pool
+            [MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL * Levels];
+
+        static void initialise() {
+            if constexpr (Capacity == POOLED_CAPACITY) {
+                patch_pyramid.initialise(patch_pool,
+                                         sizeof(patch_pool) /
+                                             sizeof(patch_pool[0]));
+                fixed_point_patch_pyramid.initialise(
+                    fixed_point_patch_pool,
+                    sizeof(fixed_point_patch_pool) /
+                        sizeof(fixed_point_patch_pool[0]));
+            }
+        }
+
+        static void construct(const bool fixed_point,
+                              image::ImagePyramid& image_pyramid,
+                              const image::KeyPoint* points,
+                              const size_t size) {
+            if (fixed_point) {
+                fixed_point_patch_pyramid.construct(image_pyramid,
+                                                    points,
+                                                    size);
+            } else {
+                patch_pyramid.construct(image_pyramid, points, size);
+            }
+        }
+
+        static void track(const bool fixed_point,
+                          image::ImagePyramid& image_pyramid,
+                          image::KeyPoint* previous_keypoints,
+                          image::KeyPoint* next_keypoints,
+                          const size_t size,
+                          const frontend::TrackingLimits& limits,
+                          frontend::TrackQuality* out_quality) {
+            if (fixed_point) {
+                frontend::track_features(fixed_point_patch_pyramid,
+                                         image_pyramid,
+                                         previous_keypoints,
+                                         next_keypoints,
+                                         size,
+                                         limits,
+                                         out_quality);
+            } else {
+                frontend::track_features(patch_pyramid,
+                                         image_pyramid,
+                                         previous_keypoints,
+                                         next_keypoints,
+                                         size,
+                                         limits,
+                                         out_quality);
+            }
+        }
+
+        static void check(const bool fixed_point,
+                          image::ImagePyramid& previous_image_pyramid,
+                          const image::KeyPoint* previous_keypoints,
+                          image::KeyPoint* next_keypoints,
+                          const size_t size,
+                          const float max_error,
+                          frontend::TrackQuality* out_quality) {
+            if (fixed_point) {
+                frontend::check_forward_backward(fixed_point_patch_pyramid,
+                                                 previous_image_pyramid,
+                                                 previous_keypoints,
+                                                 next_keypoints,
+                                                 backward_keypoints,
+                                                 size,
+                                                 max_error,
+                                                 out_quality);
+            } else {
+                frontend::check_forward_backward(patch_pyramid,
+                                                 previous_image_pyramid,
+                                                 previous_keypoints,
+                                                 next_keypoints,
+                                                 backward_keypoints,
+                                                 size,
+                                                 max_error,
+                                                 out_quality);
+            }
+        }
+    };
+
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    image::BasicPatchPyramid<Levels, Size, Capacity>
+        TrackerPatches<Levels, Size, Capacity>::patch_pyramid;
+
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    image::BasicFixedPointPatchPyramid<Levels, Size, Capacity>
+        TrackerPatches<Levels, Size, Capacity>::fixed_point_patch_pyramid;
+
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    image::BasicPatch<Size> TrackerPatches<Levels, Size, Capacity>::patch_pool
+        [MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL * Levels];
+
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    image::BasicFixedPointPatch<Size>
+        TrackerPatches<Levels, Size, Capacity>::fixed_point_patch_pool
+            [MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL * Levels];
+
+    struct TrackerConfiguration {
+        const char* name;
+        void (*initialise)();
+        void (*construct)(const bool,
+                          image::ImagePyramid&,
+                          const image::KeyPoint*,
+                          const size_t);
+        void (*track)(const bool,
+                      image::ImagePyramid&,
+                      image::KeyPoint*,
+                      image::KeyPoint*,
+                      const size_t,
+                      const frontend::TrackingLimits&,
+                      frontend::TrackQuality*);
+        void (*check)(const bool,
+                      image::ImagePyramid&,
+                      const image::KeyPoint*,
+                      image::KeyPoint*,
+                      const size_t,
+                      const float,
+                      frontend::TrackQuality*);
+    };
+
+#define TRACKER_CONFIGURATION(name, levels, size, capacity)                    \
+    {                                                                          \
+        name, TrackerPatches<levels, size, capacity>::initialise,              \
+            TrackerPatches<levels, size, capacity>::construct,                 \
+            TrackerPatches<levels, size, capacity>::track,                     \
+            TrackerPatches<levels, size, capacity>::check                      \
+    }
+
+    /**
+     * @brief The tracker configurations instantiated by
+     * FOR_EACH_TRACKER_CONFIGURATION.
+     */
+    static const TrackerConfiguration tracker_configurations[] = {
+        TRACKER_CONFIGURATION("default",
+                              PYRAMID_LEVELS,
+                              PATCH_SIZE,
+                              MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL),
+        TRACKER_CONFIGURATION("pooled",
+                              PYRAMID_LEVELS,
+                              PATCH_SIZE,
+                              POOLED_CAPACITY),
+        TRACKER_CONFIGURATION("3x5", 3, 5, POOLED_CAPACITY),
+    };
+
+    /**
+     * @brief Shared memory stand-in for the frames handed from the producer
+     * thread to the consumer when the pipeline is simulated.
+     */
+    static pipeline::Frame pipeline_frames[PIPELINE_FRAMES];
+    static frame_ring::Ring pipeline_ring;
+    static pipeline::Exchange exchange = {&pipeline_ring, pipeline_frames};
+
+    /**
+     * @brief Scratch memory of the FAST detector of the backend in use.
+     */
+    static __attribute__((aligned(4))) uint8_t
+        fast_scratch[frontend::FastDetector::scratch_size(MAX_IMAGE_WIDTH)];
+
+    /**
+     * @brief The FAST detector of a backend and segment test, set up once for
+     * the run.
+     */
+    template <typename Backend, typename Classifier> struct FastDetection {
+        static frontend::BasicFastDetector<Backend, Classifier> detector;
+
+        static bool initialise(const uint8_t threshold) {
+            return detector.initialise(MAX_IMAGE_WIDTH,
+                                       threshold,
+                                       fast_scratch,
+                                       sizeof(fast_scratch));
+        }
+
+        static void set_threshold(const uint8_t threshold) {
+            detector.set_threshold(threshold);
+        }
+
+        static void detect(const image::Image& image,
+                           image::KeyPoint* out_keypoints,
+                           uint32_t* out_keypoints_size,
+                           frontend::FastStatistics* out_statistics) {
+            detector.detect(image,
+                            out_keypoints,
+                            out_keypoints_size,
+                            out_statistics);
+        }
+
+        static void detect_in_grid(const image::Image& image,
+                                   const frontend::Grid& grid,
+                                   image::KeyPoint* out_keypoints,
+                                   uint32_t* out_keypoints_size,
+                                   frontend::FastStatistics* out_statistics) {
+            detector.detect(image,
+                            grid,
+                            out_keypoints,
+                            out_keypoints_size,
+                            out_statistics);
+        }
+
+        static void replenish(const image::Image& image,
+                              const frontend::Grid& grid,
+                              const float exclusion_radius,
+                              image::KeyPoint* points,
+                              uint32_t* points_size,
+                              const uint32_t max_number_of_points,
+                              frontend::FastStatistics* out_statistics) {
+            detector.replenish(image,
+                               grid,
+                               exclusion_radius,
+                               points,
+                               points_size,
+                               max_number_of_points,
+                               out_statistics);
+        }
+
+        static void detect_anms(const image::Image& image,
+                                const frontend::Anms& anms,
+                                image::KeyPoint* out_keypoints,
+                                uint32_t* out_keypoints_size,
+                                frontend::FastStatistics* out_statistics) {
+            detector.detect(image,
+                            anms,
+                            out_keypoints,
+                            out_keypoints_size,
+                            out_statistics);
+        }
+
+        static void detect_multi_scale(image::ImagePyramid& image_pyramid,
+                                       const frontend::Octaves& octaves,
+                                       image::KeyPoint* out_keypoints,
+                                       uint32_t* out_keypoints_size) {
+            detector.detect(image_pyramid,
+                            octaves,
+                            out_keypoints,
+                            out_keypoints_size);
+        }
+    };
+
+    template <typename Backend, typename Classifier>
+    frontend::BasicFastDetector<Backend, Classifier>
+        FastDetection<Backend, Classifier>::detector;
+
+    struct FastBackend {
+        const char* name;
+        const char* classifier;
+        bool (*initialise)(const uint8_t);
+        void (*set_threshold)(const uint8_t);
+        void (*detect)(const image::Image&,
+                       image::KeyPoint*,
+                       uint32_t*,
+                       frontend::FastStatistics*);
+        void (*detect_in_grid)(const image::Image&,
+                               const frontend::Grid&,
+                               image::KeyPoint*,
+                               uint32_t*,
+                               frontend::FastStatistics*);
+        void (*replenish)(const image::Image&,
+                          const frontend::Grid&,
+                          const float,
+                          image::KeyPoint*,
+                          uint32_t*,
+                          const uint32_t,
+                          frontend::FastStatistics*);
+        void (*detect_anms)(const image::Image&,
+                            const frontend::Anms&,
+                            image::KeyPoint*,
+                            uint32_t*,
+                            frontend::FastStatistics*);
+        void (*detect_multi_scale)(image::ImagePyramid&,
+                                   const frontend::Octaves&,
+                                   image::KeyPoint*,
+                                   uint32_t*);
+    };
+
+#define FAST_BACKEND(name, classifier, Backend, Classifier)                   \
+    {                                                                          \
+        name, classifier,                                                      \
+            FastDetection<Backend, Classifier>::initialise,                    \
+            FastDetection<Backend, Classifier>::set_threshold,                 \
+            FastDetection<Backend, Classifier>::detect,                        \
+            FastDetection<Backend, Classifier>::detect_in_grid,                \
+            FastDetection<Backend, Classifier>::replenish,                     \
+            FastDetection<Backend, Classifier>::detect_anms,                   \
+            FastDetection<Backend, Classifier>::detect_multi_scale             \
+    }
+
+#define FAST_BACKENDS(name, Backend)                                           \
+    FAST_BACKEND(name, "mask-chain", Backend, frontend::fast::MaskChain),      \
+        FAST_BACKEND(name, "segment-mask", Backend, frontend::fast::SegmentMask)
+
+    /**
+     * @brief The FAST backends compiled in for the host, each with both
+     * segment tests.
+     */
+    static const FastBackend fast_backends[] = {
+        FAST_BACKENDS("default", frontend::fast::DefaultBackend),
+        FAST_BACKENDS("armv7em", frontend::fast::Armv7em),
+#if defined(__SSE2__)
+        FAST_BACKENDS("sse2", frontend::fast::Sse2),
+#endif
+#if defined(__AVX2__)
+        FAST_BACKENDS("avx2", frontend::fast::Avx2),
+#endif
+#if defined(__ARM_NEON)
+        FAST_BACKENDS("neon", frontend::fast::Neon),
+#endif
+    };
+
+    /**
+     * @brief Fractional bits of the keypoint positions in a golden file,
+     * which is marked with a "positions q16" line.
+     */
+    constexpr int GOLDEN_POSITION_FRACTION_BITS = 16;
+
+    /**
+     * @brief The keypoints output for a frame, either after tracking or after
+     * detection.
+     */
+    struct Record {
+        /**
+         * @brief Either "track" or "detect".
+         */
+        char kind[8];
+
+        size_t index;
+
+        /**
+         * @brief Triplets of x, y and stale (0 or 1) for every keypoint,
+         * where the position is in GOLDEN_POSITION_FRACTION_BITS fixed
+         * point, so that sub-pixel changes of the tracks are caught.
+         */
+        std::vector<int> values;
+    };
+
+    struct Latency {
+        double p50 = 0, p99 = 0, max = 0;
+    };
+
+    /**
+     * @brief Sums of the frontend::TrackQuality of the tracked keypoints and
+     * the number of keypoints rejected by the limits.
+     */
+    struct QualitySum {
+        size_t count                  = 0;
+        double min_eigenvalue         = 0;
+        double iterations             = 0;
+        double residual               = 0;
+        size_t residual_count         = 0;
+        double forward_backward_error = 0;
+        size_t forward_backward_count = 0;
+        size_t rejected_min_eigenvalue = 0;
+        size_t rejected_residual       = 0;
+    };
+
+    /**
+     * @return The number of cells of a COVERAGE_COLUMNS by COVERAGE_ROWS grid
+     * over the image which contain any of the @p points.
+     */
+    static size_t count_covered_cells(const image::KeyPoint* points,
+                                      const size_t points_size,
+                                      const size_t width,
+                                      const size_t height) {
+
+        bool covered[COVERAGE_ROWS][COVERAGE_COLUMNS] = {};
+        size_t covered_cells                          = 0;
+
+        for (size_t i = 0; i < points_size; i++) {
+            const size_t column = std::min(
+                (size_t)(points[i].point.x * COVERAGE_COLUMNS / width),
+                (size_t)COVERAGE_COLUMNS - 1);
+            const size_t row = std::min(
+                (size_t)(points[i].point.y * COVERAGE_ROWS / height),
+                (size_t)COVERAGE_ROWS - 1);
+
+            if (!covered[row][column]) {
+                covered[row][column] = true;
+                covered_cells++;
+            }
+        }
+
+        return covered_cells;
+    }
+
+    static void add_quality(const frontend::TrackQuality& quality,
+                            const frontend::TrackingLimits& limits,
+                            QualitySum& sum) {
+        sum.count++;
+        sum.min_eigenvalue += quality.min_eigenvalue;
+        sum.iterations += quality.iterations;
+
+        if (quality.min_eigenvalue < limits.min_eigenvalue) {
+            sum.rejected_min_eigenvalue++;
+            return;
+        }
+
+        if (isfinite(quality.residual)) {
+            sum.residual += quality.residual;
+            sum.residual_count++;
+
+            if (limits.max_residual > 0 &&
+                quality.residual > limits.max_residual) {
+                sum.rejected_residual++;
+            }
+        }
+
+        if (quality.forward_backward_error >= 0 &&
+            isfinite(quality.forward_backward_error)) {
+            sum.forward_backward_error += quality.forward_backward_error;
+            sum.forward_backward_count++;
+        }
+    }
+
+    struct Golden {
+        bool has_latency[NUMBER_OF_STAGES] = {};
+        Latency latency[NUMBER_OF_STAGES];
+        std::vector<Record> records;
+    };
+
+    const char* stage_name(const Stage stage) { return stage_names[stage]; }
+
+    bool parse_stage(const char* name, Stage* out_stage) {
+        for (int stage = 0; stage < NUMBER_OF_STAGES; stage++) {
+            if (strcmp(name, stage_names[stage]) == 0) {
+                *out_stage = (Stage)stage;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static double
+    elapsed_ms(const std::chrono::steady_clock::time_point& start) {
+        return std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - start)
+            .count();
+    }
+
+    /**
+     * @brief Builds the pyramid of @p image into @p out_image_pyramid,
+     * eagerly or lazily depending on @p config.
+     */
+    static void build_pyramid(const Config& config,
+                              const image::Image& image,
+                              uint8_t* buffer,
+                              image::ImagePyramid& out_image_pyramid) {
+        if (config.lazy_pyramid) {
+            out_image_pyramid.construct_lazy(image, lazy_image_pyramid_buffer);
+        } else {
+            out_image_pyramid = image::ImagePyramid(image, buffer);
+        }
+    }
+
+    /**
+     * @return The nearest-rank percentile @p p (in [0, 1]) of @p samples.
+     */
+    static double percentile(std::vector<double> samples, const double p) {
+        if (samples.empty()) {
+            return 0;
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        size_t rank = (size_t)ceil(p * (double)samples.size());
+
+        if (rank > 0) {
+            rank--;
+        }
+
+        return samples[std::min(rank, samples.size() - 1)];
+    }
+
+    static Record make_record(const char* kind,
+                              const size_t index,
+                              const image::KeyPoint* keypoints_buffer,
+                              const size_t keypoints_size) {
+        Record record;
+
+        strncpy(record.kind, kind, sizeof(record.kind) - 1);
+        record.kind[sizeof(record.kind) - 1] = '\0';
+        record.index                         = index;
+
+        record.values.reserve(keypoints_size * 3);
+
+        for (size_t i = 0; i < keypoints_size; i++) {
+            record.values.push_back(
+                (int)lround(ldexp(keypoints_buffer[i].point.x,
+                                  GOLDEN_POSITION_FRACTION_BITS)));
+            record.values.push_back(
+                (int)lround(ldexp(keypoints_buffer[i].point.y,
+                                  GOLDEN_POSITION_FRACTION_BITS)));
+            record.values.push_back(keypoints_buffer[i].stale ? 1 : 0);
+        }
+
+        return record;
+    }
+
+    /**
+     * @brief Writes the @p latency and the @p records to a golden file at
+     * @p path.
+     */
+    static bool write_golden(const char* path,
+                             const Latency latency[NUMBER_OF_STAGES],
+                             const std::vector<Record>& records) {
+
+        FILE* file = fopen(path, "w");
+
+        if (file == NULL) {
+            logger::errorf("Failed to open %s for writing\r\n", path);
+            return false;
+        }
+
+        fprintf(file, "positions q%d\n", GOLDEN_POSITION_FRACTION_BITS);
+
+        for (int stage = 0; stage < NUMBER_OF_STAGES; stage++) {
+            fprintf(file,
+                    "latency %s %.6f %.6f %.6f\n",
+                    stage_names[stage],
+                    latency[stage].p50,
+                    latency[stage].p99,
+                    latency[stage].max);
+        }
+
+        for (const Record& record : records) {
+            fprintf(file,
+                    "%s %zu %zu",
+                    record.kind,
+                    record.index,
+                    record.values.size() / 3);
+
+            for (const int value : record.values) {
+                fprintf(file, " %d", value);
+            }
+
+            fprintf(file, "\n");
+        }
+
+        fclose(file);
+
+        return true;
+    }
+
+    static bool read_golden(const char* path, Golden& golden) {
+
+        FILE* file = fopen(path, "r");
+
+        if (file == NULL) {
+            logger::errorf("Failed to open golden file %s\r\n", path);
+            return false;
+        }
+
+        char word[16];
+        bool success       = true;
+        bool has_positions = false;
+
+        while (success && fscanf(file, "%15s", word) == 1) {
+
+            if (strcmp(word, "positions") == 0) {
+                char format[8];
+
+                if (fscanf(file, "%7s", format) != 1 || format[0] != 'q' ||
+                    atoi(format + 1) != GOLDEN_POSITION_FRACTION_BITS) {
+                    success = false;
+                    break;
+                }
+
+                has_positions = true;
+
+            } else if (strcmp(word, "latency") == 0) {
+                char name[16];
+                Latency latency;
+
+                Stage stage;
+
+                if (fscanf(file,
+                           "%15s %lf %lf %lf",
+                           name,
+                           &latency.p50,
+                           &latency.p99,
+                           &latency.max) != 4 ||
+                    !parse_stage(name, &stage)) {
+                    success = false;
+                    break;
+                }
+
+                golden.has_latency[stage] = true;
+                golden.latency[stage]     = latency;
+
+            } else if (has_positions && (strcmp(word, "track") == 0 ||
+                                         strcmp(word, "detect") == 0)) {
+
+                Record record;
+                size_t count = 0;
+
+                strcpy(record.kind, word);
+
+                if (fscanf(file, "%zu %zu", &record.index, &count) != 2) {
+                    success = false;
+                    break;
+                }
+
+                record.values.resize(count * 3);
+
+                for (size_t i = 0; i < count * 3; i++) {
+                    if (fscanf(file, "%d", &record.values[i]) != 1) {
+                        success = false;
+                        break;
+                    }
+                }
+
+                golden.records.push_back(record);
+            } else {
+                success = false;
+            }
+        }
+
+        fclose(file);
+
+        if (!success) {
+            logger::errorf("Malformed golden file: %s\r\n", path);
+
+            if (!has_positions) {
+                logger::errorf("Golden files recorded with whole pixel "
+                               "positions have to be recorded again\r\n");
+            }
+        }
+
+        return success;
+    }
+
+    /**
+     * @brief Distance between the keypoints which are alive in both a record
+     * and its golden record, in pixels.
+     */
+    struct Distance {
+        double mean = 0, max = 0;
+        size_t count = 0;
+    };
+
+    /**
+     * @brief Compares the @p records against the @p golden records.
+     *
+     * @return The fraction of keypoints matching exactly. Keypoints in records
+     * which are only present in one of the sets count as mismatches.
+     */
+    static double compare(const std::vector<Record>& records,
+                          const std::vector<Record>& golden_records,
+                          size_t* out_mismatched_records,
+                          Distance* out_distance) {
+
+        size_t matched = 0;
+        size_t total   = 0;
+
+        double distance_sum = 0;
+
+        *out_mismatched_records = 0;
+        *out_distance           = Distance();
+
+        std::vector<bool> golden_visited(golden_records.size(), false);
+
+        // Both sets of records are ordered by frame index, so the search for
+        // the golden record can continue from the last match
+        size_t golden_position = 0;
+
+        for (const Record& record : records) {
+
+            const Record* golden_record = NULL;
+
+            for (size_t i = golden_position; i < golden_records.size(); i++) {
+                if (golden_records[i].index == record.index &&
+                    strcmp(golden_records[i].kind, record.kind) == 0) {
+                    golden_record     = &golden_records[i];
+                    golden_visited[i] = true;
+                    golden_position   = i + 1;
+                    break;
+                }
+
+                if (golden_records[i].index > record.index) {
+                    break;
+                }
+            }
+
+            if (golden_record == NULL) {
+                total += record.values.size() / 3;
+                (*out_mismatched_records)++;
+                continue;
+            }
+
+            const size_t count = std::max(record.values.size(),
+                                          golden_record->values.size()) /
+                                 3;
+
+            size_t record_matched = 0;
+
+            for (size_t i = 0;
+                 i < std::min(record.values.size(),
+                              golden_record->values.size());
+                 i += 3) {
+                if (std::equal(&record.values[i],
+                               &record.values[i] + 3,
+                               &golden_record->values[i])) {
+                    record_matched++;
+                }
+
+                if (record.values[i + 2] == 0 &&
+                    golden_record->values[i + 2] == 0) {
+                    const double distance = ldexp(
+                        hypot(record.values[i] - golden_record->values[i],
+                              record.values[i + 1] -
+                                  golden_record->values[i + 1]),
+                        -GOLDEN_POSITION_FRACTION_BITS);
+
+                    distance_sum += distance;
+                    out_distance->max = std::max(out_distance->max, distance);
+                    out_distance->count++;
+                }
+            }
+
+            if (record_matched != count) {
+                (*out_mismatched_records)++;
+            }
+
+            matched += record_matched;
+            total += count;
+        }
+
+        for (size_t i = 0; i < golden_records.size(); i++) {
+            if (!golden_visited[i]) {
+                total += golden_records[i].values.size() / 3;
+                (*out_mismatched_records)++;
+            }
+        }
+
+        if (out_distance->count > 0) {
+            out_distance->mean = distance_sum / (double)out_distance->count;
+        }
+
+        return total == 0 ? 1.0 : (double)matched / (double)total;
+    }
+
+    bool run(const Config& config) {
+
+        char dataset_path[16] = "";
+        snprintf(dataset_path,
+                 sizeof(dataset_path),
+                 "/%s",
+                 config.dataset_name);
+
+        const FastBackend* fast_backend = NULL;
+
+        for (const FastBackend& backend : fast_backends) {
+            if (strcmp(config.fast_backend, backend.name) == 0 &&
+                strcmp(config.fast_classifier, backend.classifier) == 0) {
+                fast_backend = &backend;
+            }
+        }
+
+        if (fast_backend == NULL) {
+            logger::errorf("Unknown FAST backend: %s with %s, available:",
+                           config.fast_backend,
+                           config.fast_classifier);
+
+            for (const FastBackend& backend : fast_backends) {
+                logger::rawf(" %s/%s", backend.name, backend.classifier);
+            }
+
+            logger::rawf("\r\n");
+
+            return false;
+        }
+
+        logger::infof("FAST backend: %s, segment test: %s\r\n",
+                      fast_backend->name,
+                      fast_backend->classifier);
+
+        if (!fast_backend->initialise(config.threshold)) {
+            return false;
+        }
+
+        if (config.threshold_target > 0) {
+            logger::infof("Adaptive threshold: %u corners per detection, "
+                          "starting at %u\r\n",
+                          config.threshold_target,
+                          config.threshold);
+        }
+
+        const TrackerConfiguration* tracker = NULL;
+
+        for (const TrackerConfiguration& configuration :
+             tracker_configurations) {
+            if (strcmp(config.patch_pyramid, configuration.name) == 0) {
+                tracker = &configuration;
+            }
+        }
+
+        if (tracker == NULL) {
+            logger::errorf("Unknown patch pyramid: %s, available:",
+                           config.patch_pyramid);
+
+            for (const TrackerConfiguration& configuration :
+                 tracker_configurations) {
+                logger::rawf(" %s", configuration.name);
+            }
+
+            logger::rawf("\r\n");
+
+            return false;
+        }
+
+        tracker->initialise();
+
+        logger::infof("Tracker: %s, patch pyramid: %s\r\n",
+                      config.fixed_point_tracker ? "fixed" : "float",
+                      tracker->name);
+
+        if (config.replenish && config.grid.keypoints_per_cell == 0) {
+            logger::errorf("Replenishing requires a grid\r\n");
+            return false;
+        }
+
+        if (config.grid.keypoints_per_cell > 0) {
+            logger::infof("FAST grid: %ux%u cells, %u keypoints per cell\r\n",
+                          config.grid.columns,
+                          config.grid.rows,
+                          config.grid.keypoints_per_cell);
+        }
+
+        if (config.anms_candidates > 0) {
+            if (config.grid.keypoints_per_cell > 0 ||
+                config.octaves.levels > 0) {
+                logger::errorf("ANMS selects from the corners of the whole "
+                               "first level and does not support a grid or "
+                               "multi-scale FAST\r\n");
+                return false;
+            }
+
+            anms_candidates.resize(config.anms_candidates);
+
+            logger::infof("ANMS: up to %u candidates\r\n",
+                          config.anms_candidates);
+        }
+
+        if (config.octaves.levels > 0) {
+            if (config.grid.keypoints_per_cell > 0 ||
+                config.threshold_target > 0) {
+                logger::errorf("Multi-scale FAST has a threshold per level "
+                               "and does not support a grid or an adaptive "
+                               "threshold\r\n");
+                return false;
+            }
+
+            if (config.octaves.levels > PYRAMID_LEVELS) {
+                logger::errorf("Multi-scale FAST scans at most %u levels\r\n",
+                               PYRAMID_LEVELS);
+                return false;
+            }
+
+            logger::infof("Multi-scale FAST: %u levels, thresholds",
+                          config.octaves.levels);
+
+            for (size_t level = 0; level < config.octaves.levels; level++) {
+                logger::rawf(" %u", config.octaves.thresholds[level]);
+            }
+
+            logger::rawf("\r\n");
+        }
+
+        if (config.pipeline && config.prefetch) {
+            logger::errorf("Prefetching is part of the pipeline\r\n");
+            return false;
+        }
+
+        if (config.pipeline && config.lazy_pyramid) {
+            logger::errorf("The pipeline builds the pyramids eagerly\r\n");
+            return false;
+        }
+
+        if (config.forward_backward_error > 0 &&
+            (config.pipeline || config.prefetch || config.lazy_pyramid)) {
+            logger::errorf("The forward-backward check keeps the previous "
+                           "frame in its own buffers, which the pipeline, "
+                           "prefetching and lazy pyramids do not\r\n");
+            return false;
+        }
+
+        if (config.lazy_pyramid) {
+            logger::infof("Lazy pyramid: %ux%u tiles\r\n",
+                          PYRAMID_TILE_SIZE,
+                          PYRAMID_TILE_SIZE);
+        }
+
+        dataset_loader::initialise(dataset_path);
+
+        if (config.prefetch) {
+            logger::infof("Prefetching: loading on a second thread\r\n");
+
+            uint8_t* const buffers[PREFETCH_BUFFERS] = {image_data,
+                                                        prefetch_image_data};
+
+            frame_prefetcher::start(buffers,
+                                    sizeof(image_data),
+                                    config.start_index,
+                                    config.end_index);
+        }
+
+        // When pipelined, a second thread takes the role of CORE1 and loads
+        // the images and builds the pyramids ahead of the tracking
+        std::thread producer;
+
+        if (config.pipeline) {
+            logger::infof("Pipelined: loading and pyramids on a second "
+                          "thread\r\n");
+
+            pipeline::initialise(exchange);
+
+            producer = std::thread([&config]() {
+                for (size_t index = config.start_index;
+                     index <= config.end_index;
+                     index++) {
+                    pipeline::produce(exchange, index);
+                }
+
+                pipeline::produce_end(exchange);
+            });
+        }
+
+        const auto run_start = std::chrono::steady_clock::now();
+
+        std::vector<double> samples[NUMBER_OF_STAGES];
+        std::vector<Record> records;
+
+        uint32_t keypoints_size = 0;
+        size_t stale_features   = 0;
+
+        size_t frames                 = 0;
+        size_t detections             = 0;
+        size_t total_keypoints        = 0;
+        size_t total_detected         = 0;
+        size_t tracks                 = 0;
+        size_t total_track_length     = 0;
+        const size_t keypoints_buffer = MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL;
+
+        size_t detected_per_octave[PYRAMID_LEVELS] = {};
+
+        // Cells covered by the keypoints right after the detections
+        size_t total_covered_cells = 0;
+
+        const frontend::TrackingLimits limits = {config.min_eigenvalue,
+                                                 config.max_residual};
+
+        // The quality is only computed when it is used, as it costs a
+        // gradient pass per feature
+        frontend::TrackQuality* quality =
+            config.track_quality || config.min_eigenvalue > 0 ||
+                    config.max_residual > 0 ||
+                    config.forward_backward_error > 0
+                ? track_qualities
+                : NULL;
+
+        QualitySum quality_sum;
+        size_t rejected_forward_backward = 0;
+
+        // The statistics of the last detection, from which the threshold of
+        // the next one is chosen
+        frontend::FastStatistics fast_statistics;
+        frontend::FastStatistics* statistics =
+            config.threshold_target > 0 ? &fast_statistics : NULL;
+
+        frontend::ThresholdController threshold_controller;
+        threshold_controller.target = config.threshold_target;
+
+        uint8_t threshold         = config.threshold;
+        uint8_t minimum_threshold = threshold;
+        uint8_t maximum_threshold = threshold;
+        size_t total_threshold    = 0;
+
+        // The pyramid of the previous frame, which the forward-backward
+        // check tracks back into
+        image::ImagePyramid previous_image_pyramid;
+
+        for (size_t index = config.start_index; index <= config.end_index;
+             index++) {
+
+            double stage_ms[NUMBER_OF_STAGES] = {};
+
+            // Tracking and extraction do not run on every frame, so only the
+            // frames where a stage ran contribute to its latency statistics
+            bool stage_ran[NUMBER_OF_STAGES] = {};
+
+            image::Image image;
+            image::ImagePyramid image_pyramid;
+
+            pipeline::Frame* frame = NULL;
+
+            auto start = std::chrono::steady_clock::now();
+
+            if (config.pipeline) {
+                frame = pipeline::wait_filled(exchange);
+
+                if (!frame->valid) {
+                    pipeline::release(exchange);
+                    continue;
+                }
+
+                image         = frame->image;
+                image_pyramid = frame->image_pyramid;
+
+                stage_ms[STAGE_LOAD]    = frame->load_us / 1000.0;
+                stage_ms[STAGE_PYRAMID] = frame->pyramid_us / 1000.0;
+            } else if (config.prefetch) {
+                const frame_prefetcher::Frame* prefetched =
+                    frame_prefetcher::acquire();
+
+                // Only the time waiting for the image is on the critical path
+                stage_ms[STAGE_LOAD] = elapsed_ms(start);
+
+                if (prefetched == NULL || !prefetched->valid) {
+                    logger::errorf("Failed to retrieve image %zu\r\n", index);
+
+                    if (prefetched != NULL) {
+                        frame_prefetcher::release();
+                    }
+
+                    continue;
+                }
+
+                image = prefetched->image;
+
+                start = std::chrono::steady_clock::now();
+                build_pyramid(config,
+                              image,
+                              image_pyramid_buffer,
+                              image_pyramid);
+                stage_ms[STAGE_PYRAMID] = elapsed_ms(start);
+            } else {
+                // The buffers alternate with the ones of the previous frame
+                // when it is tracked back into
+                const bool alternate = config.forward_backward_error > 0 &&
+                                       frames % 2 == 1;
+
+                image.data = alternate ? previous_image_data : image_data;
+
+                if (!dataset_loader::retrieve_image_into(image,
+                                                         sizeof(image_data),
+                                                         index)) {
+                    logger::errorf("Failed to retrieve image %zu\r\n", index);
+                    continue;
+                }
+
+                stage_ms[STAGE_LOAD] = elapsed_ms(start);
+
+                start = std::chrono::steady_clock::now();
+                build_pyramid(config,
+                              image,
+                              alternate ? previous_image_pyramid_buffer
+                                        : image_pyramid_buffer,
+                              image_pyramid);
+                stage_ms[STAGE_PYRAMID] = elapsed_ms(start);
+            }
+
+            bool patches_constructed = false;
+
+            if (keypoints_size > 0) {
+                start = std::chrono::steady_clock::now();
+                tracker->track(config.fixed_point_tracker,
+                               image_pyramid,
+                               keypoints,
+                               end_keypoints,
+                               keypoints_size,
+                               limits,
+                               quality);
+                stage_ms[STAGE_TRACK]  = elapsed_ms(start);
+                stage_ran[STAGE_TRACK] = true;
+
+                // As the tracker did before keeping the sub-pixel positions,
+                // for comparison
+                if (config.integer_keypoints) {
+                    for (size_t i = 0; i < keypoints_size; i++) {
+                        end_keypoints[i].point.x =
+                            roundf(end_keypoints[i].point.x);
+                        end_keypoints[i].point.y =
+                            roundf(end_keypoints[i].point.y);
+                    }
+                }
+
+                if (config.forward_backward_error > 0 && frames > 0) {
+                    size_t tracked_before = 0, tracked_after = 0;
+
+                    for (size_t i = 0; i < keypoints_size; i++) {
+                        tracked_before += end_keypoints[i].stale ? 0 : 1;
+                    }
+
+                    // The patches of the next frame are the templates of
+                    // the backward track, so they are constructed here
+                    // instead of after a possible re-detection
+                    start = std::chrono::steady_clock::now();
+                    tracker->construct(config.fixed_point_tracker,
+                                       image_pyramid,
+                                       end_keypoints,
+                                       keypoints_size);
+                    stage_ms[STAGE_PATCHES] = elapsed_ms(start);
+                    patches_constructed     = true;
+
+                    start = std::chrono::steady_clock::now();
+                    tracker->check(config.fixed_point_tracker,
+                                   previous_image_pyramid,
+                                   keypoints,
+                                   end_keypoints,
+                                   keypoints_size,
+                                   config.forward_backward_error,
+                                   quality);
+                    stage_ms[STAGE_TRACK] += elapsed_ms(start);
+
+                    for (size_t i = 0; i < keypoints_size; i++) {
+                        tracked_after += end_keypoints[i].stale ? 0 : 1;
+                    }
+
+                    rejected_forward_backward += tracked_before -
+                                                 tracked_after;
+                }
+
+                stale_features = 0;
+                for (size_t i = 0; i < keypoints_size; i++) {
+                    if (quality != NULL && !keypoints[i].stale) {
+                        add_quality(quality[i], limits, quality_sum);
+                    }
+
+                    if (end_keypoints[i].stale) {
+                        stale_features++;
+
+                        if (!keypoints[i].stale) {
+                            tracks++;
+                            total_track_length += track_lengths[i];
+                        }
+                    } else {
+                        track_lengths[i]++;
+                    }
+                }
+
+                if (((int)keypoints_size - (int)stale_features) >=
+                    config.minimum_number_of_tracks) {
+                    records.push_back(make_record("track",
+                                                  index,
+                                                  end_keypoints,
+                                                  keypoints_size));
+                }
+
+                memcpy(keypoints,
+                       end_keypoints,
+                       sizeof(image::KeyPoint) * keypoints_size);
+            }
+
+            if (((int)keypoints_size - (int)stale_features) <
+                config.minimum_number_of_tracks) {
+                const uint32_t tracked_keypoints_size = keypoints_size -
+                                                        stale_features;
+
+                start = std::chrono::steady_clock::now();
+
+                // FAST scans the whole blurred first level, which a lazy
+                // pyramid computes completely here
+                const image::Image& first_level = *image_pyramid.at(0);
+
+                // The tracks which survive are the ones kept by
+                // replenish_features, in the same order, all others end here
+                uint32_t surviving_tracks = 0;
+
+                for (size_t i = 0; i < keypoints_size; i++) {
+                    if (keypoints[i].stale) {
+                        continue;
+                    }
+
+                    if (config.replenish) {
+                        track_lengths[surviving_tracks++] = track_lengths[i];
+                    } else {
+                        tracks++;
+                        total_track_length += track_lengths[i];
+                    }
+                }
+
+                if (config.replenish) {
+                    fast_backend->replenish(first_level,
+                                            config.grid,
+                                            config.exclusion_radius,
+                                            keypoints,
+                                            &keypoints_size,
+                                            keypoints_buffer,
+                                            statistics);
+                } else if (config.anms_candidates > 0) {
+                    const frontend::Anms anms = {anms_candidates.data(),
+                                                 config.anms_candidates};
+
+                    keypoints_size = keypoints_buffer;
+                    fast_backend->detect_anms(first_level,
+                                              anms,
+                                              keypoints,
+                                              &keypoints_size,
+                                              statistics);
+                } else if (config.octaves.levels > 0) {
+                    keypoints_size = keypoints_buffer;
+                    fast_backend->detect_multi_scale(image_pyramid,
+                                                     config.octaves,
+                                                     keypoints,
+                                                     &keypoints_size);
+                } else if (config.grid.keypoints_per_cell > 0) {
+                    keypoints_size = keypoints_buffer;
+                    fast_backend->detect_in_grid(first_level,
+                                                 config.grid,
+                                                 keypoints,
+                                                 &keypoints_size,
+                                                 statistics);
+                } else {
+                    keypoints_size = keypoints_buffer;
+                    fast_backend->detect(first_level,
+                                         keypoints,
+                                         &keypoints_size,
+                                         statistics);
+                }
+
+                total_threshold += threshold;
+                minimum_threshold = std::min(minimum_threshold, threshold);
+                maximum_threshold = std::max(maximum_threshold, threshold);
+
+                if (statistics != NULL) {
+                    threshold = frontend::adapt_threshold(threshold_controller,
+                                                          *statistics);
+                    fast_backend->set_threshold(threshold);
+                }
+
+                stage_ms[STAGE_EXTRACT]  = elapsed_ms(start);
+                stage_ran[STAGE_EXTRACT] = true;
+
+                patches_constructed = false;
+
+                for (size_t i = surviving_tracks; i < keypoints_size; i++) {
+                    track_lengths[i] = 0;
+                }
+
+                stale_features = 0;
+
+                detections++;
+                total_detected += config.replenish
+                                      ? keypoints_size - tracked_keypoints_size
+                                      : keypoints_size;
+
+                // Replenishing appends to the surviving tracks, which keep
+                // the octave they were detected on
+                for (size_t i = config.replenish ? tracked_keypoints_size : 0;
+                     i < keypoints_size;
+                     i++) {
+                    detected_per_octave[keypoints[i].octave]++;
+                }
+
+                total_covered_cells += count_covered_cells(keypoints,
+                                                           keypoints_size,
+                                                           first_level.width,
+                                                           first_level.height);
+
+                records.push_back(
+                    make_record("detect", index, keypoints, keypoints_size));
+            }
+
+            if (!patches_constructed) {
+                start = std::chrono::steady_clock::now();
+                tracker->construct(config.fixed_point_tracker,
+                                   image_pyramid,
+                                   keypoints,
+                                   keypoints_size);
+                stage_ms[STAGE_PATCHES] = elapsed_ms(start);
+            }
+
+            previous_image_pyramid = image_pyramid;
+
+            if (frame != NULL) {
+                pipeline::release(exchange);
+            }
+
+            if (config.prefetch) {
+                frame_prefetcher::release();
+            }
+
+            // When pipelined, the pyramid is built in parallel, so the total
+            // only covers the stages on the critical path of the consumer
+            for (int stage = config.pipeline ? STAGE_TRACK : STAGE_PYRAMID;
+                 stage < STAGE_TOTAL;
+                 stage++) {
+                stage_ms[STAGE_TOTAL] += stage_ms[stage];
+            }
+
+            stage_ran[STAGE_LOAD]    = true;
+            stage_ran[STAGE_PYRAMID] = true;
+            stage_ran[STAGE_PATCHES] = true;
+            stage_ran[STAGE_TOTAL]   = true;
+
+            for (int stage = 0; stage < NUMBER_OF_STAGES; stage++) {
+                if (stage_ran[stage]) {
+                    samples[stage].push_back(stage_ms[stage]);
+                }
+            }
+
+            total_keypoints += keypoints_size - stale_features;
+            frames++;
+        }
+
+        if (config.pipeline) {
+            // The end of the stream
+            pipeline::wait_filled(exchange);
+            pipeline::release(exchange);
+
+            producer.join();
+        }
+
+        if (config.prefetch) {
+            frame_prefetcher::stop();
+        }
+
+        const double wall_seconds = elapsed_ms(run_start) / 1000.0;
+
+        // The tracks still alive at the end count with their length so far
+        for (size_t i = 0; i < keypoints_size; i++) {
+            if (!keypoints[i].stale) {
+                tracks++;
+                total_track_length += track_lengths[i];
+            }
+        }
+
+        dataset_loader::deinitialise();
+
+        if (frames == 0) {
+            logger::errorf("No frames were processed\r\n");
+            return false;
+        }
+
+        // --- Report ---
+
+        Latency latency[NUMBER_OF_STAGES];
+        double total_seconds = 0;
+
+        for (int stage = 0; stage < NUMBER_OF_STAGES; stage++) {
+            latency[stage].p50 = percentile(samples[stage], 0.50);
+            latency[stage].p99 = percentile(samples[stage], 0.99);
+            latency[stage].max = percentile(samples[stage], 1.0);
+        }
+
+        for (const double sample : samples[STAGE_TOTAL]) {
+            total_seconds += sample / 1000.0;
+        }
+
+        logger::infof("Frames: %zu, re-detections: %zu, keypoints per frame: "
+                      "%.2f, detected per re-detection: %.2f, throughput: "
+                      "%.2f fps\r\n",
+                      frames,
+                      detections,
+                      (double)total_keypoints / (double)frames,
+                      detections == 0 ? 0.0
+                                      : (double)total_detected /
+                                            (double)detections,
+                      total_seconds > 0 ? (double)frames / total_seconds : 0.0);
+
+        logger::infof("Tracks: %zu, mean track length: %.2f frames, "
+                      "re-detections per 100 frames: %.2f\r\n",
+                      tracks,
+                      tracks == 0 ? 0.0
+                                  : (double)total_track_length /
+                                        (double)tracks,
+                      100.0 * (double)detections / (double)frames);
+
+        if (detections > 0) {
+            logger::infof("Coverage: %.1f%% of the %ux%u cells after a "
+                          "detection\r\n",
+                          100.0 * (double)total_covered_cells /
+                              (double)(detections * COVERAGE_COLUMNS *
+                                       COVERAGE_ROWS),
+                          COVERAGE_COLUMNS,
+                          COVERAGE_ROWS);
+        }
+
+        if (config.octaves.levels > 0) {
+            logger::infof("Detected per octave:");
+
+            for (size_t level = 0; level < config.octaves.levels; level++) {
+                logger::rawf(" %zu", detected_per_octave[level]);
+            }
+
+            logger::rawf("\r\n");
+        }
+
+        if (statistics != NULL && detections > 0) {
+            logger::infof("FAST threshold: mean %.1f, min %u, max %u\r\n",
+                          (double)total_threshold / (double)detections,
+                          minimum_threshold,
+                          maximum_threshold);
+        }
+
+        if (quality != NULL && quality_sum.count > 0) {
+            logger::infof(
+                "Track quality: min eigenvalue %.1f, iterations %.2f, "
+                "residual %.2f, forward-backward error %.3f px\r\n",
+                quality_sum.min_eigenvalue / (double)quality_sum.count,
+                quality_sum.iterations / (double)quality_sum.count,
+                quality_sum.residual_count == 0
+                    ? 0.0
+                    : quality_sum.residual /
+                          (double)quality_sum.residual_count,
+                quality_sum.forward_backward_count == 0
+                    ? 0.0
+                    : quality_sum.forward_backward_error /
+                          (double)quality_sum.forward_backward_count);
+
+            logger::infof("Rejected: %zu by min eigenvalue, %zu by residual, "
+                          "%zu by forward-backward error\r\n",
+                          quality_sum.rejected_min_eigenvalue,
+                          quality_sum.rejected_residual,
+                          rejected_forward_backward);
+        }
+
+        logger::infof("Wall clock, including loading: %.2f fps\r\n",
+                      wall_seconds > 0 ? (double)frames / wall_seconds : 0.0);
+
+        logger::rawf("%-10s %10s %10s %10s\r\n",
+                     "stage",
+                     "p50 (ms)",
+                     "p99 (ms)",
+                     "max (ms)");
+
+        for (int stage = 0; stage < NUMBER_OF_STAGES; stage++) {
+            logger::rawf("%-10s %10.4f %10.4f %10.4f\r\n",
+                         stage_names[stage],
+                         latency[stage].p50,
+                         latency[stage].p99,
+                         latency[stage].max);
+        }
+
+        bool passed = true;
+
+        // --- Latency budgets ---
+
+        for (int stage = 0; stage < NUMBER_OF_STAGES; stage++) {
+            if (config.p99_budget_ms[stage] > 0 &&
+                latency[stage].p99 > config.p99_budget_ms[stage]) {
+                logger::errorf("Stage %s p99 of %.4f ms exceeds budget of "
+                               "%.4f ms\r\n",
+                               stage_names[stage],
+                               latency[stage].p99,
+                               config.p99_budget_ms[stage]);
+                passed = false;
+            }
+        }
+
+        // --- Golden comparison ---
+
+        if (config.golden_path != NULL) {
+            Golden golden;
+
+            if (!read_golden(config.golden_path, golden)) {
+                return false;
+            }
+
+            size_t mismatched_records = 0;
+            Distance distance;
+            const double match_rate = compare(records,
+                                              golden.records,
+                                              &mismatched_records,
+                                              &distance);
+
+            logger::infof("Golden match rate: %.6f, mismatched frames: %zu\r\n",
+                          match_rate,
+                          mismatched_records);
+
+            logger::infof("Golden keypoint distance: mean %.4f px, max %.4f "
+                          "px over %zu keypoints\r\n",
+                          distance.mean,
+                          distance.max,
+                          distance.count);
+
+            if (match_rate < config.minimum_match_rate) {
+                logger::errorf("Match rate %.6f is below the minimum of "
+                               "%.6f\r\n",
+                               match_rate,
+                               config.minimum_match_rate);
+                passed = false;
+            }
+
+            if (config.latency_tolerance > 0) {
+                for (int stage = 0; stage < NUMBER_OF_STAGES; stage++) {
+
+                    // Loading is dominated by the file system and is not part
+                    // of the frontend
+                    if (stage == STAGE_LOAD || !golden.has_latency[stage]) {
+                        continue;
+                    }
+
+                    const double limit = golden.latency[stage].p99 *
+                                         (1.0 + config.latency_tolerance);
+
+                    if (latency[stage].p99 > limit) {
+                        logger::errorf("Stage %s p99 of %.4f ms regressed "
+                                       "beyond %.4f ms (golden: %.4f ms)\r\n",
+                                       stage_names[stage],
+                                       latency[stage].p99,
+                                       limit,
+                                       golden.latency[stage].p99);
+                        passed = false;
+                    }
+                }
+            }
+        }
+
+        if (config.record_path != NULL) {
+            if (!write_golden(config.record_path, latency, records)) {
+                return false;
+            }
+
+            logger::infof("Recorded golden file: %s\r\n", config.record_path);
+        }
+
+        logger::infof("%s\r\n", passed ? "PASSED" : "FAILED");
+
+        return passed;
+    }
+}
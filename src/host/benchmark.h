@@ -0,0 +1,232 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "feature_extraction.h"
+
+/**
+ * @brief Host benchmark and regression harness for the frontend. Replays a
+ * dataset directory through FAST + LK in the same way as
+ * test::lucas_kanade::test_with_dataset_without_references_with_resample,
+ * times every stage per frame and compares the output against a golden file.
+ */
+namespace benchmark {
+
+    /**
+     * @brief The stages of the frontend which are timed for every frame.
+     */
+    enum Stage {
+        STAGE_LOAD,
+        STAGE_PYRAMID,
+        STAGE_TRACK,
+        STAGE_EXTRACT,
+        STAGE_PATCHES,
+
+        /**
+         * @brief Sum of all the stages except loading, as the image would be
+         * written directly to the image buffer by the camera in a real
+         * pipeline.
+         */
+        STAGE_TOTAL,
+
+        NUMBER_OF_STAGES
+    };
+
+    /**
+     * @return The name of the @p stage, as used on the command line and in
+     * the golden file.
+     */
+    const char* stage_name(const Stage stage);
+
+    /**
+     * @brief Parses @p name into @p out_stage.
+     *
+     * @return true if @p name is the name of a stage.
+     */
+    bool parse_stage(const char* name, Stage* out_stage);
+
+    /**
+     * @brief Configuration for a benchmark run.
+     */
+    struct Config {
+        /**
+         * @brief Name of the dataset directory, relative to the root.
+         */
+        const char* dataset_name = "v23";
+
+        /**
+         * @brief Index of the first and last image in the dataset to replay.
+         */
+        size_t start_index = 1;
+        size_t end_index   = 1922;
+
+        /**
+         * @brief FAST threshold, the first one if it adapts.
+         */
+        uint8_t threshold = 70;
+
+        /**
+         * @brief If positive, the FAST threshold adapts after every detection
+         * to find this many corners, see frontend::adapt_threshold.
+         */
+        uint32_t threshold_target = 0;
+
+        /**
+         * @brief Name of the FAST backend, see frontend::fast. "default" is
+         * the backend selected at compile time.
+         */
+        const char* fast_backend = "default";
+
+        /**
+         * @brief Name of the segment test of FAST, "mask-chain" for
+         * frontend::fast::MaskChain or "segment-mask" for
+         * frontend::fast::SegmentMask.
+         */
+        const char* fast_classifier = "mask-chain";
+
+        /**
+         * @brief If true, features are tracked with the fixed-point tracker
+         * instead of the float one.
+         */
+        bool fixed_point_tracker = false;
+
+        /**
+         * @brief Name of the tracker configuration, i.e. the levels, patch
+         * size and capacity of the patch pyramids. "default" is
+         * image::PatchPyramid, "pooled" the same with pooled patches and
+         * "3x5" 3 levels of 5x5 patches.
+         */
+        const char* patch_pyramid = "default";
+
+        /**
+         * @brief If true, the tracked keypoints are rounded to whole pixels,
+         * as the trackers did before they kept sub-pixel positions, to
+         * compare the track lengths and re-detection rates.
+         */
+        bool integer_keypoints = false;
+
+        /**
+         * @brief Limits of frontend::TrackingLimits, 0 to disable.
+         */
+        float min_eigenvalue = 0;
+        float max_residual   = 0;
+
+        /**
+         * @brief If true, the quality of the tracks is computed and reported
+         * without any limits, e.g. to compare how well conditioned the
+         * features selected in different ways are.
+         */
+        bool track_quality = false;
+
+        /**
+         * @brief If positive, the tracked keypoints which do not track back
+         * to within this many pixels are rejected, see
+         * frontend::check_forward_backward.
+         */
+        float forward_backward_error = 0;
+
+        /**
+         * @brief If true, the images are loaded and the image pyramids built
+         * on a second thread, which simulates the pipeline between CORE1 and
+         * CORE0, see pipeline.h.
+         */
+        bool pipeline = false;
+
+        /**
+         * @brief If true, the next image is read on a second thread while the
+         * current one is processed, see frame_prefetcher.h. The pyramid is
+         * still built on the main thread.
+         */
+        bool prefetch = false;
+
+        /**
+         * @brief If true, the image pyramids are built lazily, only around
+         * the features, see image::ImagePyramid::construct_lazy. Not
+         * supported with the pipeline, which builds the pyramids eagerly
+         * ahead of the frame being tracked.
+         */
+        bool lazy_pyramid = false;
+
+        /**
+         * @brief If keypoints_per_cell is non-zero, FAST keeps the best
+         * keypoints in each cell of this grid instead of the first ones in
+         * raster order.
+         */
+        frontend::Grid grid = {0, 0, 0};
+
+        /**
+         * @brief If positive, FAST collects up to this many corners and keeps
+         * the ones spread evenly over the image, see frontend::Anms, instead
+         * of the first ones in raster order.
+         */
+        uint32_t anms_candidates = 0;
+
+        /**
+         * @brief If levels is non-zero, FAST scans this many levels of the
+         * image pyramid, each with its own threshold, instead of the first
+         * level only, see frontend::BasicFastDetector::detect.
+         */
+        frontend::Octaves octaves = {0, {}};
+
+        /**
+         * @brief If true, the tracks which survived are kept on re-detection
+         * and FAST only scans the cells of the grid without any of them, see
+         * frontend::replenish_features. Requires a grid.
+         */
+        bool replenish = false;
+
+        /**
+         * @brief New keypoints closer than this to a surviving track are
+         * rejected when replenishing.
+         */
+        float exclusion_radius = 10.0f;
+
+        /**
+         * @brief Re-detect features with FAST when fewer than this amount of
+         * tracks are alive.
+         */
+        int minimum_number_of_tracks = 5;
+
+        /**
+         * @brief Path on the host to a golden file to compare against, NULL if
+         * no comparison should be made.
+         */
+        const char* golden_path = NULL;
+
+        /**
+         * @brief Path on the host where the output of this run is recorded as
+         * a golden file, NULL if nothing should be recorded.
+         */
+        const char* record_path = NULL;
+
+        /**
+         * @brief The fraction of keypoints in the golden file which have to
+         * match exactly for the run to pass.
+         */
+        double minimum_match_rate = 1.0;
+
+        /**
+         * @brief If positive, the run fails if the p99 latency of a stage is
+         * greater than the p99 in the golden file by more than this fraction.
+         */
+        double latency_tolerance = -1.0;
+
+        /**
+         * @brief Absolute p99 latency budget in milliseconds per stage, zero or
+         * negative for no budget.
+         */
+        double p99_budget_ms[NUMBER_OF_STAGES] = {};
+    };
+
+    /**
+     * @brief Runs the benchmark with the current directory as the root of the
+     * dataset and prints the report.
+     *
+     * @return true if the run was within the accuracy and latency budgets.
+     */
+    bool run(const Config& config);
+}
+
+#endif
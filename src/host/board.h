@@ -0,0 +1,25 @@
+/**
+ * @brief Host stand-in for the board defines, used when building the frontend
+ * for a workstation.
+ */
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include "fsl_device_registers.h"
+
+/**
+ * @brief The host "cycle" counter counts nanoseconds, so that conversion from
+ * cycles to milliseconds done for the target works unchanged on the host.
+ */
+#define BOARD_BOOTCLOCKRUN_CORE_CLOCK 1000000000UL
+
+// There are no tightly coupled or on-chip memories on the host, so the section
+// attributes are left empty and the data ends up in regular memory
+#define SECTION_ITCM
+#define SECTION_OCRAM12
+#define SECTION_OCRAM3
+#define SECTION_SHMEM
+#define SECTION_SDRAM
+
+#endif
@@ -0,0 +1,348 @@
+#include "file_system.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logger.h"
+
+/**
+ * @brief Host backend for the file system. The working directory at the time
+ * of initialisation acts as the root of the SD card, so that absolute paths
+ * used on the target (e.g. "/v23") resolve within it.
+ */
+namespace file_system {
+
+    /**
+     * @brief Path to the directory acting as the root of the SD card.
+     */
+    static char root_path[PATH_MAX] = "";
+
+    /**
+     * @brief Current directory, relative to the root.
+     */
+    static char current_directory_path[64] = "";
+
+    /**
+     * @brief Resolves @p path against the root and the current directory and
+     * places the result in @p out_path.
+     */
+    static bool resolve(const char* path, char* out_path, size_t length) {
+
+        int written = 0;
+
+        if (path[0] == '/') {
+            written = snprintf(out_path, length, "%s%s", root_path, path);
+        } else {
+            written = snprintf(out_path,
+                               length,
+                               "%s%s/%s",
+                               root_path,
+                               current_directory_path,
+                               path);
+        }
+
+        return written > 0 && (size_t)written < length;
+    }
+
+    bool initialise() {
+
+        if (getcwd(root_path, sizeof(root_path)) == NULL) {
+            logger::errorf("Failed to retrieve working directory\r\n");
+            return false;
+        }
+
+        current_directory_path[0] = '\0';
+
+        return true;
+    }
+
+    bool deinitialise() { return true; }
+
+    bool cd(const char* path) {
+
+        if (strlen(path) > sizeof(current_directory_path) - 1) {
+            logger::errorf(
+                "Directory path is greater than maximum allowed size of %zu\r\n",
+                sizeof(current_directory_path) - 1);
+
+            return false;
+        }
+
+        logger::debugf("Changing current directory to: %s\r\n", path);
+
+        char resolved_path[PATH_MAX];
+        struct stat information;
+
+        if (!resolve(path, resolved_path, sizeof(resolved_path)) ||
+            stat(resolved_path, &information) != 0 ||
+            !S_ISDIR(information.st_mode)) {
+            logger::warnf("Failed to change current directory to: %s\r\n",
+                          path);
+            return false;
+        }
+
+        if (path[0] == '/') {
+            strcpy(current_directory_path, path);
+        } else {
+            const size_t current_length = strlen(current_directory_path);
+
+            if (current_length + strlen(path) + 1 >
+                sizeof(current_directory_path) - 1) {
+                logger::errorf("Directory path is too long\r\n");
+                return false;
+            }
+
+            current_directory_path[current_length] = '/';
+            strcpy(current_directory_path + current_length + 1, path);
+        }
+
+        // Keep the root as an empty path, so that resolving does not produce
+        // a double slash
+        if (strcmp(current_directory_path, "/") == 0) {
+            current_directory_path[0] = '\0';
+        }
+
+        return true;
+    }
+
+    bool ls(char*** out_file_names, size_t* out_number_of_files) {
+
+        *out_number_of_files = 0;
+
+        char resolved_path[PATH_MAX];
+
+        if (!resolve(".", resolved_path, sizeof(resolved_path))) {
+            return false;
+        }
+
+        DIR* directory = opendir(resolved_path);
+
+        if (directory == NULL) {
+            return false;
+        }
+
+        size_t allocated_size = 16;
+
+        *out_file_names = (char**)malloc(allocated_size * sizeof(char*));
+
+        struct dirent* entry;
+
+        while ((entry = readdir(directory)) != NULL) {
+
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+
+            (*out_file_names)[(*out_number_of_files)++] = strdup(
+                entry->d_name);
+
+            if (*out_number_of_files == allocated_size) {
+
+                allocated_size *= 2;
+
+                *out_file_names = (char**)realloc(*out_file_names,
+                                                  allocated_size *
+                                                      sizeof(char*));
+            }
+        }
+
+        closedir(directory);
+
+        return true;
+    }
+
+    bool size(const char* path, uint32_t* out_file_size_ptr) {
+
+        char resolved_path[PATH_MAX];
+        struct stat information;
+
+        if (!resolve(path, resolved_path, sizeof(resolved_path)) ||
+            stat(resolved_path, &information) != 0) {
+            logger::errorf("Failed to open file for examining size: %s\r\n",
+                           path);
+            return false;
+        }
+
+        *out_file_size_ptr = (uint32_t)information.st_size;
+
+        return true;
+    }
+
+    bool
+    read(const char* path, uint8_t* out_buffer, const uint32_t bytes_to_read) {
+
+        logger::debugf("Reading %u bytes from: %s\r\n", bytes_to_read, path);
+
+        char resolved_path[PATH_MAX];
+
+        FILE* file = NULL;
+
+        if (resolve(path, resolved_path, sizeof(resolved_path))) {
+            file = fopen(resolved_path, "rb");
+        }
+
+        if (file == NULL) {
+            logger::errorf("Failed to open file: %s\r\n", path);
+            return false;
+        }
+
+        const size_t bytes_read = fread(out_buffer, 1, bytes_to_read, file);
+
+        fclose(file);
+
+        if (bytes_read != bytes_to_read) {
+            logger::errorf("Bytes read does not match the requested amount of "
+                           "bytes to read\r\n");
+            return false;
+        }
+
+        return true;
+    }
+
+    bool open(const char* path, File& file) {
+
+        char resolved_path[PATH_MAX];
+
+        file.handle = NULL;
+
+        if (resolve(path, resolved_path, sizeof(resolved_path))) {
+            file.handle = fopen(resolved_path, "rb");
+        }
+
+        if (file.handle == NULL) {
+            logger::errorf("Failed to open file: %s\r\n", path);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool read(File& file,
+              uint8_t* out_buffer,
+              const uint32_t bytes_to_read,
+              uint32_t* out_bytes_read) {
+
+        *out_bytes_read = (uint32_t)fread(out_buffer,
+                                          1,
+                                          bytes_to_read,
+                                          file.handle);
+
+        if (ferror(file.handle)) {
+            logger::errorf("Reading file failed\r\n");
+            return false;
+        }
+
+        return true;
+    }
+
+    bool seek(File& file, const uint32_t offset) {
+
+        if (fseek(file.handle, (long)offset, SEEK_SET) != 0) {
+            logger::errorf("Seeking file failed\r\n");
+            return false;
+        }
+
+        return true;
+    }
+
+    void close(File& file) {
+        if (file.handle != NULL) {
+            fclose(file.handle);
+            file.handle = NULL;
+        }
+    }
+
+    bool exists(const char* path) {
+
+        char resolved_path[PATH_MAX];
+        struct stat information;
+
+        return resolve(path, resolved_path, sizeof(resolved_path)) &&
+               stat(resolved_path, &information) == 0;
+    }
+
+    const uint8_t* map(const char* path, size_t* out_size) {
+
+        char resolved_path[PATH_MAX];
+
+        int descriptor = -1;
+
+        if (resolve(path, resolved_path, sizeof(resolved_path))) {
+            descriptor = ::open(resolved_path, O_RDONLY);
+        }
+
+        if (descriptor < 0) {
+            logger::errorf("Failed to open file: %s\r\n", path);
+            return NULL;
+        }
+
+        struct stat information;
+        void* data = MAP_FAILED;
+
+        if (fstat(descriptor, &information) == 0 && information.st_size > 0) {
+            data = mmap(NULL,
+                        (size_t)information.st_size,
+                        PROT_READ,
+                        MAP_PRIVATE,
+                        descriptor,
+                        0);
+        }
+
+        // The mapping stays valid after the descriptor is closed
+        ::close(descriptor);
+
+        if (data == MAP_FAILED) {
+            logger::errorf("Failed to map file: %s\r\n", path);
+            return NULL;
+        }
+
+        *out_size = (size_t)information.st_size;
+
+        return (const uint8_t*)data;
+    }
+
+    void unmap(const uint8_t* data, const size_t size) {
+        if (data != NULL) {
+            munmap((void*)data, size);
+        }
+    }
+
+    bool write(const char* path,
+               const uint8_t* buffer,
+               const uint32_t buffer_length) {
+
+        logger::debugf("Writing %u bytes to: %s\r\n", buffer_length, path);
+
+        char resolved_path[PATH_MAX];
+
+        FILE* file = NULL;
+
+        if (resolve(path, resolved_path, sizeof(resolved_path))) {
+            file = fopen(resolved_path, "wb");
+        }
+
+        if (file == NULL) {
+            logger::errorf("Failed to open file for writing: %s\r\n", path);
+            return false;
+        }
+
+        const size_t bytes_written = fwrite(buffer, 1, buffer_length, file);
+
+        fclose(file);
+
+        if (bytes_written != buffer_length) {
+            logger::errorf("Bytes written does not match the requested amount "
+                           "of bytes to write\r\n");
+            return false;
+        }
+
+        return true;
+    }
+}
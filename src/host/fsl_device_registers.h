@@ -0,0 +1,113 @@
+/**
+ * @brief Host stand-in for the device register header.
+ *
+ * On the target, this header pulls in the CMSIS core header which provides the
+ * ARMv7E-M DSP (SIMD) intrinsics used by the frontend. On the host we only
+ * provide portable, bit-exact implementations of the intrinsics in use, so that
+ * e.g. FAST yields the same keypoints on the host as on the board.
+ *
+ * The intrinsics operate on four unsigned 8 bit lanes packed into a 32 bit
+ * integer, where lane n is bits [8n + 7:8n].
+ */
+
+#ifndef __FSL_DEVICE_REGISTERS_H__
+#define __FSL_DEVICE_REGISTERS_H__
+
+#include <stdint.h>
+
+namespace host {
+
+    /**
+     * @brief Emulated APSR.GE flags. Bit n is set if lane n of the last
+     * __USUB8 did not underflow. Thread local so that each host thread sees
+     * its own "core" state.
+     */
+    inline uint32_t& apsr_ge() {
+        static thread_local uint32_t ge = 0;
+        return ge;
+    }
+}
+
+/**
+ * @brief Per lane unsigned saturating addition.
+ */
+static inline uint32_t __UQADD8(uint32_t op1, uint32_t op2) {
+    uint32_t result = 0;
+
+    for (uint32_t lane = 0; lane < 32; lane += 8) {
+        const uint32_t sum = ((op1 >> lane) & 0xFF) + ((op2 >> lane) & 0xFF);
+        result |= (sum > 0xFF ? 0xFF : sum) << lane;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Per lane unsigned halving addition, (op1 + op2) >> 1 without
+ * overflow.
+ */
+static inline uint32_t __UHADD8(uint32_t op1, uint32_t op2) {
+    uint32_t result = 0;
+
+    for (uint32_t lane = 0; lane < 32; lane += 8) {
+        const uint32_t sum = ((op1 >> lane) & 0xFF) + ((op2 >> lane) & 0xFF);
+        result |= (sum >> 1) << lane;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Per lane unsigned saturating subtraction.
+ */
+static inline uint32_t __UQSUB8(uint32_t op1, uint32_t op2) {
+    uint32_t result = 0;
+
+    for (uint32_t lane = 0; lane < 32; lane += 8) {
+        const uint32_t a = (op1 >> lane) & 0xFF;
+        const uint32_t b = (op2 >> lane) & 0xFF;
+        result |= (a > b ? a - b : 0) << lane;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Per lane unsigned subtraction. Sets the emulated APSR.GE bit for
+ * every lane where @p op1 >= @p op2.
+ */
+static inline uint32_t __USUB8(uint32_t op1, uint32_t op2) {
+    uint32_t result = 0;
+    uint32_t ge     = 0;
+
+    for (uint32_t lane = 0; lane < 4; lane++) {
+        const uint32_t a = (op1 >> (lane * 8)) & 0xFF;
+        const uint32_t b = (op2 >> (lane * 8)) & 0xFF;
+
+        result |= ((a - b) & 0xFF) << (lane * 8);
+        ge |= (a >= b ? 1U : 0U) << lane;
+    }
+
+    host::apsr_ge() = ge;
+
+    return result;
+}
+
+/**
+ * @brief Per lane select. Picks the lane from @p op1 if the emulated APSR.GE
+ * bit for that lane is set, otherwise from @p op2.
+ */
+static inline uint32_t __SEL(uint32_t op1, uint32_t op2) {
+    const uint32_t ge = host::apsr_ge();
+    uint32_t mask     = 0;
+
+    for (uint32_t lane = 0; lane < 4; lane++) {
+        if (ge & (1U << lane)) {
+            mask |= 0xFFU << (lane * 8);
+        }
+    }
+
+    return (op1 & mask) | (op2 & ~mask);
+}
+
+#endif
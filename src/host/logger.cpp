@@ -0,0 +1,245 @@
+#include "logger.h"
+
+#include "log_buffer.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+
+#define INFO_LEVEL_FMT  "[ INFO  ] "
+#define DEBUG_LEVEL_FMT "[ DEBUG ] "
+#define WARN_LEVEL_FMT  "[ WARN  ] "
+#define ERROR_LEVEL_FMT "[ ERROR ] "
+
+/**
+ * @brief Size of the ring buffer the messages are written to.
+ */
+#define LOG_BUFFER_SIZE (0x10000)
+
+/**
+ * @brief Largest formatted message, including the level and prefix.
+ */
+#define MESSAGE_SIZE (512)
+
+/**
+ * @brief Host backend for the logger, which writes to stdout instead of the
+ * LPUART. A thread takes the place of the DMA. Unlike on the target, a full
+ * buffer makes the logger wait for the thread instead of dropping messages,
+ * as the output of the host build is compared against references.
+ */
+namespace logger {
+
+    static Level log_level = Level::LOG_INFO;
+
+    static char prefix_buffer[16] = "";
+
+    static bool initialised = false;
+
+    static uint8_t log_data[LOG_BUFFER_SIZE];
+
+    static log_buffer::Buffer buffer;
+
+    static std::thread drain_thread;
+
+    static std::atomic<bool> running(false);
+
+    /**
+     * @brief Writes the buffer to stdout until the logger is stopped.
+     */
+    static void drain() {
+        while (true) {
+            const bool stopping = !running.load(std::memory_order_acquire);
+
+            const uint8_t* data = NULL;
+            size_t size         = 0;
+
+            while ((size = log_buffer::peek(buffer, &data)) > 0) {
+                fwrite(data, 1, size, stdout);
+                log_buffer::consume(buffer, size);
+            }
+
+            fflush(stdout);
+
+            if (stopping) {
+                return;
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * @brief Sends out the rest of the log at exit.
+     */
+    static void stop() {
+        running.store(false, std::memory_order_release);
+
+        if (drain_thread.joinable()) {
+            drain_thread.join();
+        }
+    }
+
+    static void write(const char* level_format,
+                      const char* format,
+                      va_list args) {
+
+        char* message = (char*)begin_record(MESSAGE_SIZE);
+
+        if (message == NULL) {
+            return;
+        }
+
+        size_t length = 0;
+
+        if (level_format != NULL) {
+            const size_t level_length  = strlen(level_format);
+            const size_t prefix_length = strlen(prefix_buffer);
+
+            memcpy(message, level_format, level_length);
+            memcpy(message + level_length, prefix_buffer, prefix_length);
+
+            length = level_length + prefix_length;
+        }
+
+        const int formatted =
+            vsnprintf(message + length, MESSAGE_SIZE - length, format, args);
+
+        if (formatted > 0) {
+            length += (size_t)formatted < MESSAGE_SIZE - length
+                          ? (size_t)formatted
+                          : MESSAGE_SIZE - length - 1;
+        }
+
+        end_record(length);
+    }
+
+    void initialise() {
+        if (initialised) {
+            return;
+        }
+
+        log_buffer::initialise(buffer, log_data, sizeof(log_data));
+
+        running.store(true, std::memory_order_release);
+        drain_thread = std::thread(drain);
+
+        atexit(stop);
+
+        initialised = true;
+    }
+
+    void set_level(const Level level) { log_level = level; }
+
+    Level get_level() { return log_level; }
+
+    void set_prefix(const char* prefix) {
+
+        const size_t prefix_buffer_character_length = sizeof(prefix_buffer) - 1;
+
+        if (strlen(prefix) > prefix_buffer_character_length) {
+            logger::errorf("Prefix cannot be greater than %zu\r\n",
+                           prefix_buffer_character_length);
+            return;
+        }
+
+        strncpy(prefix_buffer, prefix, prefix_buffer_character_length);
+    }
+
+    void infof(const char* format, ...) {
+        if (!initialised) {
+            return;
+        }
+
+        va_list args;
+        va_start(args, format);
+        write(INFO_LEVEL_FMT, format, args);
+        va_end(args);
+    }
+
+    void debugf(const char* format, ...) {
+        if (!initialised || log_level == Level::LOG_INFO) {
+            return;
+        }
+
+        va_list args;
+        va_start(args, format);
+        write(DEBUG_LEVEL_FMT, format, args);
+        va_end(args);
+    }
+
+    void warnf(const char* format, ...) {
+        if (!initialised) {
+            return;
+        }
+
+        va_list args;
+        va_start(args, format);
+        write(WARN_LEVEL_FMT, format, args);
+        va_end(args);
+    }
+
+    void errorf(const char* format, ...) {
+        if (!initialised) {
+            return;
+        }
+
+        va_list args;
+        va_start(args, format);
+        write(ERROR_LEVEL_FMT, format, args);
+        va_end(args);
+    }
+
+    void rawf(const char* format, ...) {
+        if (!initialised) {
+            return;
+        }
+
+        va_list args;
+        va_start(args, format);
+        write(NULL, format, args);
+        va_end(args);
+    }
+
+    void debugrawf(const char* format, ...) {
+        if (!initialised || log_level == Level::LOG_INFO) {
+            return;
+        }
+
+        va_list args;
+        va_start(args, format);
+        write(NULL, format, args);
+        va_end(args);
+    }
+
+    uint8_t* begin_record(const size_t size) {
+        if (!initialised || size >= sizeof(log_data)) {
+            return NULL;
+        }
+
+        uint8_t* record = NULL;
+
+        while ((record = log_buffer::reserve(buffer, size)) == NULL) {
+            std::this_thread::yield();
+        }
+
+        return record;
+    }
+
+    void end_record(const size_t size) { log_buffer::commit(buffer, size); }
+
+    void flush() {
+        if (!initialised) {
+            return;
+        }
+
+        while (!log_buffer::empty(buffer)) {
+            std::this_thread::yield();
+        }
+
+        fflush(stdout);
+    }
+}
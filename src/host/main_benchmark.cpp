@@ -0,0 +1,300 @@
+#include "benchmark.h"
+#include "file_system.h"
+#include "logger.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s <sd card root> [options]\n"
+            "\n"
+            "Options:\n"
+            "  --dataset <name>             Dataset directory (default: v23)\n"
+            "  --start <index>              First image index (default: 1)\n"
+            "  --end <index>                Last image index (default: 1922)\n"
+            "  --threshold <value>          FAST threshold (default: 70)\n"
+            "  --adaptive-threshold <n>     Adapt the FAST threshold to find "
+            "n\n"
+            "                               corners per detection\n"
+            "  --fast-backend <name>        FAST backend: default, armv7em, "
+            "sse2,\n"
+            "                               avx2 or neon, depending on the "
+            "host\n"
+            "  --fast-classifier <name>     FAST segment test: mask-chain "
+            "(default)\n"
+            "                               or segment-mask\n"
+            "  --tracker <name>             Tracker: float (default) or "
+            "fixed\n"
+            "  --patch-pyramid <name>       Tracker configuration: default, "
+            "pooled\n"
+            "                               or 3x5 (3 levels of 5x5 "
+            "patches)\n"
+            "  --integer-keypoints          Round the tracked keypoints to "
+            "whole\n"
+            "                               pixels, as the tracker did "
+            "before\n"
+            "  --min-eigenvalue <value>     Reject features with a smaller "
+            "minimum\n"
+            "                               eigenvalue per pixel before "
+            "tracking\n"
+            "  --max-residual <value>       Reject tracks with a larger mean "
+            "absolute\n"
+            "                               intensity difference per pixel\n"
+            "  --track-quality              Report the track quality without "
+            "limits\n"
+            "  --forward-backward <px>      Reject tracks which do not track "
+            "back to\n"
+            "                               within px of where they started\n"
+            "  --pipeline                   Load images and build pyramids on "
+            "a\n"
+            "                               second thread, as CORE1 on the "
+            "target\n"
+            "  --prefetch                   Read the next image on a second "
+            "thread\n"
+            "                               while the current one is "
+            "processed\n"
+            "  --lazy-pyramid               Only compute the image pyramid "
+            "around\n"
+            "                               the tracked features\n"
+            "  --grid <c>x<r>x<k>           Keep the best k keypoints in each "
+            "cell\n"
+            "                               of a c by r grid\n"
+            "  --anms <candidates>          Keep the keypoints spread evenly "
+            "over the\n"
+            "                               image out of up to candidates "
+            "corners\n"
+            "  --multi-scale <t0,t1,...>    Scan a pyramid level per "
+            "threshold,\n"
+            "                               from the first level\n"
+            "  --replenish <radius>         Keep surviving tracks on "
+            "re-detection and\n"
+            "                               only scan uncovered grid cells, "
+            "rejecting\n"
+            "                               corners within radius of a "
+            "track\n"
+            "  --golden <path>              Golden file to compare against\n"
+            "  --record <path>              Record the output as a golden "
+            "file\n"
+            "  --min-match <fraction>       Minimum fraction of golden "
+            "keypoints\n"
+            "                               which must match (default: 1.0)\n"
+            "  --latency-tolerance <frac>   Fail if a stage p99 exceeds the "
+            "golden\n"
+            "                               p99 by more than this fraction\n"
+            "  --budget <stage>=<ms>        Absolute p99 budget for a stage, "
+            "can be\n"
+            "                               repeated. Stages: load, pyramid, "
+            "track,\n"
+            "                               extract, patches, total\n",
+            program);
+}
+
+/**
+ * @brief Makes @p path absolute with respect to the current working directory,
+ * as the working directory is changed to the root of the dataset before the
+ * benchmark is run.
+ */
+static const char* absolute_path(const char* path, char* buffer, size_t size) {
+    if (path[0] == '/') {
+        return path;
+    }
+
+    char working_directory[PATH_MAX];
+
+    if (getcwd(working_directory, sizeof(working_directory)) == NULL) {
+        return path;
+    }
+
+    snprintf(buffer, size, "%s/%s", working_directory, path);
+
+    return buffer;
+}
+
+int main(int argc, char** argv) {
+
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    benchmark::Config config;
+
+    char golden_path[PATH_MAX * 2];
+    char record_path[PATH_MAX * 2];
+
+    for (int i = 2; i < argc; i++) {
+
+        const char* option = argv[i];
+
+        // Flags without a value
+        if (strcmp(option, "--pipeline") == 0) {
+            config.pipeline = true;
+            continue;
+        }
+
+        if (strcmp(option, "--prefetch") == 0) {
+            config.prefetch = true;
+            continue;
+        }
+
+        if (strcmp(option, "--lazy-pyramid") == 0) {
+            config.lazy_pyramid = true;
+            continue;
+        }
+
+        if (strcmp(option, "--track-quality") == 0) {
+            config.track_quality = true;
+            continue;
+        }
+
+        if (strcmp(option, "--integer-keypoints") == 0) {
+            config.integer_keypoints = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", option);
+            print_usage(argv[0]);
+            return 2;
+        }
+
+        const char* value = argv[++i];
+
+        if (strcmp(option, "--dataset") == 0) {
+            config.dataset_name = value;
+        } else if (strcmp(option, "--start") == 0) {
+            config.start_index = strtoul(value, NULL, 10);
+        } else if (strcmp(option, "--end") == 0) {
+            config.end_index = strtoul(value, NULL, 10);
+        } else if (strcmp(option, "--threshold") == 0) {
+            config.threshold = (uint8_t)strtoul(value, NULL, 10);
+        } else if (strcmp(option, "--adaptive-threshold") == 0) {
+            config.threshold_target = strtoul(value, NULL, 10);
+        } else if (strcmp(option, "--fast-backend") == 0) {
+            config.fast_backend = value;
+        } else if (strcmp(option, "--fast-classifier") == 0) {
+            config.fast_classifier = value;
+        } else if (strcmp(option, "--tracker") == 0) {
+            if (strcmp(value, "float") == 0) {
+                config.fixed_point_tracker = false;
+            } else if (strcmp(value, "fixed") == 0) {
+                config.fixed_point_tracker = true;
+            } else {
+                fprintf(stderr, "Unknown tracker: %s\n", value);
+                return 2;
+            }
+        } else if (strcmp(option, "--patch-pyramid") == 0) {
+            config.patch_pyramid = value;
+        } else if (strcmp(option, "--min-eigenvalue") == 0) {
+            config.min_eigenvalue = strtof(value, NULL);
+        } else if (strcmp(option, "--max-residual") == 0) {
+            config.max_residual = strtof(value, NULL);
+        } else if (strcmp(option, "--forward-backward") == 0) {
+            config.forward_backward_error = strtof(value, NULL);
+        } else if (strcmp(option, "--anms") == 0) {
+            config.anms_candidates = strtoul(value, NULL, 10);
+        } else if (strcmp(option, "--multi-scale") == 0) {
+            const char* threshold = value;
+            char* end             = NULL;
+
+            config.octaves.levels = 0;
+
+            while (config.octaves.levels < PYRAMID_LEVELS) {
+                const unsigned long parsed = strtoul(threshold, &end, 10);
+
+                if (end == threshold || parsed > 255) {
+                    break;
+                }
+
+                config.octaves.thresholds[config.octaves.levels++] =
+                    (uint8_t)parsed;
+
+                if (*end != ',') {
+                    break;
+                }
+
+                threshold = end + 1;
+            }
+
+            if (end == threshold || *end != '\0') {
+                fprintf(stderr, "Invalid thresholds: %s\n", value);
+                return 2;
+            }
+        } else if (strcmp(option, "--grid") == 0) {
+            unsigned int columns = 0, rows = 0, keypoints_per_cell = 0;
+
+            if (sscanf(value,
+                       "%ux%ux%u",
+                       &columns,
+                       &rows,
+                       &keypoints_per_cell) != 3 ||
+                columns == 0 || rows == 0 || keypoints_per_cell == 0 ||
+                columns > 255 || rows > 255 || keypoints_per_cell > 255 ||
+                columns * rows > frontend::MAX_GRID_CELLS ||
+                columns * rows * keypoints_per_cell >
+                    frontend::MAX_GRID_CORNERS) {
+                fprintf(stderr, "Invalid grid: %s\n", value);
+                return 2;
+            }
+
+            config.grid.columns            = (uint8_t)columns;
+            config.grid.rows               = (uint8_t)rows;
+            config.grid.keypoints_per_cell = (uint8_t)keypoints_per_cell;
+        } else if (strcmp(option, "--replenish") == 0) {
+            config.replenish        = true;
+            config.exclusion_radius = strtof(value, NULL);
+        } else if (strcmp(option, "--golden") == 0) {
+            config.golden_path = absolute_path(value,
+                                               golden_path,
+                                               sizeof(golden_path));
+        } else if (strcmp(option, "--record") == 0) {
+            config.record_path = absolute_path(value,
+                                               record_path,
+                                               sizeof(record_path));
+        } else if (strcmp(option, "--min-match") == 0) {
+            config.minimum_match_rate = strtod(value, NULL);
+        } else if (strcmp(option, "--latency-tolerance") == 0) {
+            config.latency_tolerance = strtod(value, NULL);
+        } else if (strcmp(option, "--budget") == 0) {
+            char name[16] = "";
+            double budget = 0;
+            benchmark::Stage stage;
+
+            if (sscanf(value, "%15[^=]=%lf", name, &budget) != 2 ||
+                !benchmark::parse_stage(name, &stage)) {
+                fprintf(stderr, "Invalid budget: %s\n", value);
+                return 2;
+            }
+
+            config.p99_budget_ms[stage] = budget;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", option);
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    logger::initialise();
+    logger::set_level(logger::Level::LOG_INFO);
+    logger::set_prefix("(BENCH) ");
+
+    if (chdir(argv[1]) != 0) {
+        logger::errorf("Failed to change directory to %s\r\n", argv[1]);
+        return 2;
+    }
+
+    if (!file_system::initialise()) {
+        logger::errorf("Failed to initialise file system\r\n");
+        return 2;
+    }
+
+    const bool passed = benchmark::run(config);
+
+    file_system::deinitialise();
+
+    return passed ? 0 : 1;
+}
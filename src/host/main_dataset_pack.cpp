@@ -0,0 +1,299 @@
+#include "dataset_container.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "lodepng.h"
+
+/**
+ * @brief Reads the file at @p path into @p out_content.
+ */
+static bool read_file(const char* path, std::vector<uint8_t>& out_content) {
+
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    out_content.resize(size > 0 ? (size_t)size : 0);
+
+    const bool read = size > 0 && fread(out_content.data(),
+                                        1,
+                                        out_content.size(),
+                                        file) == out_content.size();
+
+    fclose(file);
+
+    return read;
+}
+
+/**
+ * @brief Parses the file name of a frame, which is its index followed by
+ * @p extension (e.g. 12.png).
+ *
+ * @return false if the file name is not a frame.
+ */
+static bool parse_frame_index(const char* file_name,
+                              const char* extension,
+                              uint32_t* out_index) {
+
+    char* end                 = NULL;
+    const unsigned long index = strtoul(file_name, &end, 10);
+
+    if (end == file_name || strcmp(end, extension) != 0 || index == 0 ||
+        index > UINT32_MAX) {
+        return false;
+    }
+
+    *out_index = (uint32_t)index;
+
+    return true;
+}
+
+/**
+ * @brief Reads the timestamps of an EuRoC data.csv (timestamp [ns],filename)
+ * into the entries. A row is matched to the frame with the index in its file
+ * name if there is one, otherwise to the frame at the row number, as the
+ * frames of the datasets are numbered in the order of the rows.
+ */
+static bool read_timestamps(const char* path,
+                            std::vector<dataset_container::Entry>& entries) {
+
+    FILE* file = fopen(path, "r");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    char line[256];
+    uint32_t row = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+            continue;
+        }
+
+        row++;
+
+        char* end                = NULL;
+        const uint64_t timestamp = strtoull(line, &end, 10);
+
+        if (end == line) {
+            continue;
+        }
+
+        uint32_t index = row;
+
+        if (*end == ',') {
+            char* file_name = end + 1;
+            file_name[strcspn(file_name, "\r\n")] = '\0';
+
+            uint32_t file_index = 0;
+            if (parse_frame_index(file_name, ".png", &file_index)) {
+                index = file_index;
+            }
+        }
+
+        for (dataset_container::Entry& entry : entries) {
+            if (entry.index == index) {
+                entry.timestamp = timestamp;
+                break;
+            }
+        }
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+/**
+ * @brief Packs a dataset directory of PNGs (1.png to N.png) into a single
+ * container file (see dataset_container.h), which dataset_loader reads
+ * instead of the directory when it is placed next to it with the extension
+ * .vds.
+ *
+ * Usage: vio_dataset_pack <dataset directory> <container file>
+ * [--timestamps <EuRoC data.csv>]
+ */
+int main(int argc, char** argv) {
+
+    const char* dataset_path    = NULL;
+    const char* output_path     = NULL;
+    const char* timestamps_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--timestamps") == 0 && i + 1 < argc) {
+            timestamps_path = argv[++i];
+        } else if (argv[i][0] != '-' && dataset_path == NULL) {
+            dataset_path = argv[i];
+        } else if (argv[i][0] != '-' && output_path == NULL) {
+            output_path = argv[i];
+        } else {
+            dataset_path = NULL;
+            break;
+        }
+    }
+
+    if (dataset_path == NULL || output_path == NULL) {
+        fprintf(stderr,
+                "Usage: %s <dataset directory> <container file> "
+                "[--timestamps <data.csv>]\n",
+                argv[0]);
+        return 2;
+    }
+
+    DIR* directory = opendir(dataset_path);
+
+    if (directory == NULL) {
+        fprintf(stderr, "Failed to open %s\n", dataset_path);
+        return 1;
+    }
+
+    std::vector<dataset_container::Entry> entries;
+    struct dirent* directory_entry;
+
+    while ((directory_entry = readdir(directory)) != NULL) {
+        dataset_container::Entry entry = {};
+        uint32_t index                 = 0;
+
+        if (parse_frame_index(directory_entry->d_name, ".png", &index)) {
+            entry.index = index;
+            entries.push_back(entry);
+        }
+    }
+
+    closedir(directory);
+
+    if (entries.empty()) {
+        fprintf(stderr, "No frames found in %s\n", dataset_path);
+        return 1;
+    }
+
+    std::sort(entries.begin(),
+              entries.end(),
+              [](const dataset_container::Entry& a,
+                 const dataset_container::Entry& b) {
+                  return a.index < b.index;
+              });
+
+    if (timestamps_path != NULL && !read_timestamps(timestamps_path, entries)) {
+        fprintf(stderr, "Failed to read %s\n", timestamps_path);
+        return 1;
+    }
+
+    const uint32_t index_size = entries.size() *
+                                sizeof(dataset_container::Entry);
+
+    dataset_container::Header header = {};
+    memcpy(header.magic, dataset_container::MAGIC, sizeof(header.magic));
+    header.version      = DATASET_CONTAINER_VERSION;
+    header.frame_count  = entries.size();
+    header.index_offset = dataset_container::align(sizeof(header));
+
+    FILE* output = fopen(output_path, "wb");
+
+    if (output == NULL) {
+        fprintf(stderr, "Failed to open %s\n", output_path);
+        return 1;
+    }
+
+    // The frames are written first, as their offsets and sizes are only known
+    // once decoded, and the header and the index last
+    uint32_t offset = dataset_container::align(header.index_offset +
+                                               index_size);
+
+    std::vector<uint8_t> file_content;
+    const std::vector<uint8_t> padding(DATASET_CONTAINER_ALIGNMENT, 0);
+
+    for (dataset_container::Entry& entry : entries) {
+
+        char file_path[4096];
+        snprintf(file_path,
+                 sizeof(file_path),
+                 "%s/%lu.png",
+                 dataset_path,
+                 (unsigned long)entry.index);
+
+        unsigned char* frame = NULL;
+        unsigned int width = 0, height = 0;
+
+        if (!read_file(file_path, file_content) ||
+            lodepng_decode_memory(&frame,
+                                  &width,
+                                  &height,
+                                  file_content.data(),
+                                  file_content.size(),
+                                  LCT_GREY,
+                                  8) != 0) {
+            fprintf(stderr, "Failed to decode %s\n", file_path);
+            fclose(output);
+            return 1;
+        }
+
+        const uint32_t size = width * height;
+
+        if (width > UINT16_MAX || height > UINT16_MAX ||
+            dataset_container::align(offset + size) < offset) {
+            fprintf(stderr, "%s is too large\n", file_path);
+            free(frame);
+            fclose(output);
+            return 1;
+        }
+
+        entry.offset = offset;
+        entry.width  = width;
+        entry.height = height;
+
+        const uint32_t padded_size = dataset_container::align(size);
+
+        fseek(output, offset, SEEK_SET);
+
+        const bool written = fwrite(frame, 1, size, output) == size &&
+                             fwrite(padding.data(),
+                                    1,
+                                    padded_size - size,
+                                    output) == padded_size - size;
+
+        free(frame);
+
+        if (!written) {
+            fprintf(stderr, "Failed to write %s\n", output_path);
+            fclose(output);
+            return 1;
+        }
+
+        offset += padded_size;
+    }
+
+    fseek(output, 0, SEEK_SET);
+
+    const bool written = fwrite(&header, 1, sizeof(header), output) ==
+                             sizeof(header) &&
+                         fseek(output, header.index_offset, SEEK_SET) == 0 &&
+                         fwrite(entries.data(), 1, index_size, output) ==
+                             index_size;
+
+    if (fclose(output) != 0 || !written) {
+        fprintf(stderr, "Failed to write %s\n", output_path);
+        return 1;
+    }
+
+    printf("Packed %zu frames into %s (%lu bytes)\n",
+           entries.size(),
+           output_path,
+           (unsigned long)offset);
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include "dataset_loader.h"
+#include "file_system.h"
+#include "logger.h"
+#include "trace.h"
+
+#include "test_lucas_kanade.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_NUMBER_OF_FEATURES_FOR_FAST (800)
+
+/**
+ * @brief Buffers for the image data, one of which is read ahead.
+ */
+static __attribute__((aligned(32)))
+uint8_t image_data[PREFETCH_BUFFERS][MAX_IMAGE_SIZE];
+
+/**
+ * @brief Buffer for the lower levels of the image pyramid.
+ */
+static uint8_t lower_levels_image_pyramid_buffer[0x20000];
+
+/**
+ * @brief Start keypoints for Lucas-Kanade/keypoints extracted with fast.
+ */
+static image::KeyPoint keypoints[MAX_NUMBER_OF_FEATURES_FOR_FAST];
+
+/**
+ * @brief End position of the keypoints after a Lucas-Kanade track.
+ */
+static image::KeyPoint end_keypoints[MAX_NUMBER_OF_FEATURES_FOR_FAST];
+
+/**
+ * @brief Patch pyramid of the keypoints tracked.
+ */
+static image::PatchPyramid patch_pyramid;
+
+/**
+ * @brief Patch pyramid of the fixed-point tracker, for the check of the
+ * forward-backward rejection.
+ */
+static image::FixedPointPatchPyramid fixed_point_patch_pyramid;
+
+/**
+ * @brief Scratch memory of fast_detector.
+ */
+static __attribute__((aligned(4))) uint8_t
+    fast_scratch[frontend::FastDetector::scratch_size(MAX_IMAGE_WIDTH)];
+
+/**
+ * @brief FAST for the re-detections, set up once.
+ */
+static frontend::FastDetector fast_detector;
+
+/**
+ * @brief Host entry point, mirrors main_cm7.cpp. The directory passed acts as
+ * the root of the SD card. With --trace, the trace of every frame is logged
+ * (see trace.h).
+ *
+ * Usage: vio_host [--trace] <sd card root> [dataset] [start index] [end index]
+ */
+int main(int argc, char** argv) {
+
+    const bool use_trace = argc > 1 && strcmp(argv[1], "--trace") == 0;
+
+    if (use_trace) {
+        argc--;
+        argv++;
+    }
+
+    if (argc < 2) {
+        fprintf(stderr,
+                "Usage: %s [--trace] <sd card root> [dataset] [start index] "
+                "[end index]\n",
+                argv[0]);
+        return 1;
+    }
+
+    const char* dataset_name = argc > 2 ? argv[2] : "v23";
+    const size_t start_index = argc > 3 ? strtoul(argv[3], NULL, 10) : 1;
+    const size_t end_index   = argc > 4 ? strtoul(argv[4], NULL, 10) : 1922;
+
+    logger::initialise();
+    logger::set_level(logger::Level::LOG_INFO);
+    logger::set_prefix("(HOST) ");
+
+    trace::set_enabled(use_trace);
+
+    uint8_t* const image_data_buffers[PREFETCH_BUFFERS] = {image_data[0],
+                                                           image_data[1]};
+
+    // The rejection of diverged tracks does not depend on the dataset, so it
+    // is checked on synthetic images first, with the pyramid buffer split
+    // between the two images
+    uint8_t* const image_pyramid_buffers[2] = {
+        lower_levels_image_pyramid_buffer,
+        lower_levels_image_pyramid_buffer +
+            sizeof(lower_levels_image_pyramid_buffer) / 2};
+
+    if (!test::lucas_kanade::test_forward_backward_with_divergent_track(
+            image_data_buffers,
+            image_pyramid_buffers,
+            &patch_pyramid,
+            &fixed_point_patch_pyramid)) {
+        logger::errorf("Forward-backward check of a diverged track failed\r\n");
+        return 1;
+    }
+
+    if (chdir(argv[1]) != 0) {
+        logger::errorf("Failed to change directory to %s\r\n", argv[1]);
+        return 1;
+    }
+
+    if (!file_system::initialise()) {
+        logger::errorf("Failed to initialise file system\r\n");
+        return 1;
+    }
+
+    fast_detector.initialise(MAX_IMAGE_WIDTH,
+                             RESAMPLE_FAST_THRESHOLD,
+                             fast_scratch,
+                             sizeof(fast_scratch));
+
+    logger::infof("%s FAST + LK\r\n", dataset_name);
+    test::lucas_kanade::test_with_dataset_without_references_with_resample(
+        image_data_buffers,
+        lower_levels_image_pyramid_buffer,
+        &patch_pyramid,
+        &fast_detector,
+        keypoints,
+        end_keypoints,
+        MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL,
+        dataset_name,
+        start_index,
+        end_index);
+
+    if (!file_system::deinitialise()) {
+        logger::errorf("Failed to de-initialise file system\r\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "log_record.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+/**
+ * @brief Decodes a log captured from the LPUART (or the output of vio_host):
+ * the text is passed through and the binary records (see log_record.h) are
+ * printed as text.
+ *
+ * With --chrome, the trace records (see trace.h) are written as Chrome trace
+ * JSON to the given file, which can be opened in chrome://tracing or
+ * Perfetto.
+ *
+ * Usage: vio_log_decode [--chrome <json file>] [log file], reads stdin
+ * without a file.
+ */
+int main(int argc, char** argv) {
+
+    const char* input_path  = NULL;
+    const char* chrome_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--chrome") == 0 && i + 1 < argc) {
+            chrome_path = argv[++i];
+        } else if (argv[i][0] != '-' && input_path == NULL) {
+            input_path = argv[i];
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [--chrome <json file>] [log file]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    FILE* input = input_path != NULL ? fopen(input_path, "rb") : stdin;
+
+    if (input == NULL) {
+        fprintf(stderr, "Failed to open %s\n", input_path);
+        return 1;
+    }
+
+    FILE* chrome = NULL;
+    trace::ChromeWriter chrome_writer;
+
+    if (chrome_path != NULL) {
+        chrome = fopen(chrome_path, "w");
+
+        if (chrome == NULL) {
+            fprintf(stderr, "Failed to open %s\n", chrome_path);
+            return 1;
+        }
+
+        trace::begin_chrome(chrome_writer, chrome);
+    }
+
+    std::vector<uint8_t> record;
+    size_t malformed = 0;
+    int character    = 0;
+
+    while ((character = fgetc(input)) != EOF) {
+
+        if (character != LOG_RECORD_MARKER) {
+            fputc(character, stdout);
+            continue;
+        }
+
+        log_record::Header header;
+        record.resize(sizeof(header));
+        record[0] = (uint8_t)character;
+
+        if (fread(&record[1], 1, sizeof(header) - 1, input) !=
+            sizeof(header) - 1) {
+            malformed++;
+            break;
+        }
+
+        memcpy(&header, record.data(), sizeof(header));
+
+        record.resize(sizeof(header) + header.size);
+
+        if (fread(&record[sizeof(header)], 1, header.size, input) !=
+            header.size) {
+            malformed++;
+            break;
+        }
+
+        if (!log_record::decode(record.data(), record.size(), stdout)) {
+            malformed++;
+        } else if (chrome != NULL && header.type == log_record::TYPE_TRACE &&
+                   !trace::write_chrome(chrome_writer,
+                                        &record[sizeof(header)],
+                                        header.size)) {
+            malformed++;
+        }
+    }
+
+    if (input != stdin) {
+        fclose(input);
+    }
+
+    if (chrome != NULL) {
+        trace::end_chrome(chrome_writer);
+        fclose(chrome);
+    }
+
+    if (malformed > 0) {
+        fprintf(stderr, "%zu malformed records\n", malformed);
+        return 1;
+    }
+
+    return 0;
+}
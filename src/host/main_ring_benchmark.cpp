@@ -0,0 +1,279 @@
+#include "frame_ring.h"
+#include "logger.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Memory shared between the producer and the consumer process, as
+ * rpmsg_sh_mem and SDRAM are between the cores. The buffers of the frames
+ * follow directly after it.
+ */
+struct Shared {
+    frame_ring::Ring ring;
+
+    /**
+     * @brief Time at which each frame was pushed, in nanoseconds.
+     */
+    int64_t pushed_ns[FRAME_RING_CAPACITY];
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "\n"
+            "Passes frames from a producer process to a consumer process\n"
+            "through a frame_ring::Ring in shared memory and reports the\n"
+            "throughput and the latency from push to front.\n"
+            "\n"
+            "Options:\n"
+            "  --frames <count>             Frames to pass (default: 10000)\n"
+            "  --size <bytes>               Size of a frame (default: "
+            "360960)\n"
+            "  --copy                       Copy the frames in and out of the "
+            "shared\n"
+            "                               memory, as with RPMsg messages\n",
+            program);
+}
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * @return The nearest-rank percentile @p p (in [0, 1]) of @p samples.
+ */
+static double percentile(std::vector<double> samples, const double p) {
+    if (samples.empty()) {
+        return 0;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    size_t rank = (size_t)ceil(p * (double)samples.size());
+
+    if (rank > 0) {
+        rank--;
+    }
+
+    return samples[std::min(rank, samples.size() - 1)];
+}
+
+/**
+ * @brief Fills the frames with their sequence number. With @p copy, the frame
+ * is written to a private buffer first and then copied into the slot.
+ */
+static void produce(Shared* shared,
+                    uint8_t* buffers,
+                    const size_t frames,
+                    const size_t size,
+                    const bool copy) {
+
+    std::vector<uint8_t> private_buffer(copy ? size : 0);
+
+    for (size_t i = 0; i < frames; i++) {
+
+        while (frame_ring::size(shared->ring) >= FRAME_RING_CAPACITY) {
+            std::this_thread::yield();
+        }
+
+        const uint32_t slot = i % FRAME_RING_CAPACITY;
+        uint8_t* buffer     = &buffers[slot * size];
+
+        if (copy) {
+            memset(private_buffer.data(), (uint8_t)i, size);
+            memcpy(buffer, private_buffer.data(), size);
+        } else {
+            memset(buffer, (uint8_t)i, size);
+        }
+
+        frame_ring::clean(buffer, size);
+
+        frame_ring::Descriptor descriptor = {};
+
+        descriptor.slot     = slot;
+        descriptor.size     = (uint32_t)size;
+        descriptor.sequence = (int32_t)i;
+
+        shared->pushed_ns[slot] = now_ns();
+
+        frame_ring::push(shared->ring, descriptor);
+    }
+}
+
+/**
+ * @brief Takes the frames and checks their contents.
+ *
+ * @return The number of frames with unexpected contents.
+ */
+static size_t consume(Shared* shared,
+                      const uint8_t* buffers,
+                      const size_t frames,
+                      const size_t size,
+                      const bool copy,
+                      std::vector<double>& latencies_us) {
+
+    std::vector<uint8_t> private_buffer(copy ? size : 0);
+
+    size_t corrupted = 0;
+
+    for (size_t i = 0; i < frames; i++) {
+
+        const frame_ring::Descriptor* descriptor = NULL;
+
+        while ((descriptor = frame_ring::front(shared->ring)) == NULL) {
+            std::this_thread::yield();
+        }
+
+        latencies_us.push_back(
+            (double)(now_ns() - shared->pushed_ns[descriptor->slot]) / 1000.0);
+
+        const uint8_t* buffer = &buffers[descriptor->slot * size];
+
+        frame_ring::invalidate(buffer, descriptor->size);
+
+        if (copy) {
+            memcpy(private_buffer.data(), buffer, descriptor->size);
+            buffer = private_buffer.data();
+        }
+
+        const uint8_t expected = (uint8_t)descriptor->sequence;
+
+        if (descriptor->sequence != (int32_t)i || buffer[0] != expected ||
+            buffer[descriptor->size - 1] != expected) {
+            corrupted++;
+        }
+
+        frame_ring::pop(shared->ring);
+    }
+
+    return corrupted;
+}
+
+int main(int argc, char** argv) {
+
+    size_t frames = 10000;
+    size_t size   = 752 * 480;
+    bool copy     = false;
+
+    for (int i = 1; i < argc; i++) {
+
+        const char* option = argv[i];
+
+        // Flags without a value
+        if (strcmp(option, "--copy") == 0) {
+            copy = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", option);
+            print_usage(argv[0]);
+            return 2;
+        }
+
+        const char* value = argv[++i];
+
+        if (strcmp(option, "--frames") == 0) {
+            frames = strtoul(value, NULL, 10);
+        } else if (strcmp(option, "--size") == 0) {
+            size = strtoul(value, NULL, 10);
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", option);
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (frames == 0 || size == 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    logger::initialise();
+    logger::set_level(logger::Level::LOG_INFO);
+    logger::set_prefix("(RING) ");
+
+    const size_t shared_size =
+        sizeof(Shared) + (size_t)FRAME_RING_CAPACITY * size;
+
+    void* memory = mmap(NULL,
+                        shared_size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS,
+                        -1,
+                        0);
+
+    if (memory == MAP_FAILED) {
+        logger::errorf("Failed to map %zu bytes of shared memory\r\n",
+                       shared_size);
+        return 1;
+    }
+
+    Shared* shared   = (Shared*)memory;
+    uint8_t* buffers = (uint8_t*)memory + sizeof(Shared);
+
+    frame_ring::initialise(shared->ring);
+
+    logger::infof("Passing %zu frames of %zu bytes (%s)\r\n",
+                  frames,
+                  size,
+                  copy ? "copied" : "zero-copy");
+
+    const int64_t start = now_ns();
+
+    const pid_t producer = fork();
+
+    if (producer < 0) {
+        logger::errorf("Failed to start the producer\r\n");
+        return 1;
+    }
+
+    if (producer == 0) {
+        produce(shared, buffers, frames, size, copy);
+        _exit(0);
+    }
+
+    std::vector<double> latencies_us;
+    latencies_us.reserve(frames);
+
+    const size_t corrupted =
+        consume(shared, buffers, frames, size, copy, latencies_us);
+
+    const double seconds = (double)(now_ns() - start) / 1e9;
+
+    int status = 0;
+    waitpid(producer, &status, 0);
+
+    munmap(memory, shared_size);
+
+    logger::infof("Throughput: %.0f frames/s, %.2f GB/s\r\n",
+                  (double)frames / seconds,
+                  (double)frames * (double)size / seconds / 1e9);
+    logger::infof("Latency (us): p50 %.2f, p99 %.2f, max %.2f\r\n",
+                  percentile(latencies_us, 0.50),
+                  percentile(latencies_us, 0.99),
+                  percentile(latencies_us, 1.0));
+
+    if (corrupted > 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        logger::errorf("FAILED: %zu frames with unexpected contents\r\n",
+                       corrupted);
+        return 1;
+    }
+
+    logger::infof("PASSED\r\n");
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "log_buffer.h"
+
+namespace log_buffer {
+
+    void initialise(Buffer& buffer, uint8_t* data, const size_t capacity) {
+        buffer.data     = data;
+        buffer.capacity = capacity;
+        buffer.wrapped  = false;
+
+        buffer.limit.store(capacity, std::memory_order_relaxed);
+        buffer.tail.store(0, std::memory_order_relaxed);
+        buffer.head.store(0, std::memory_order_release);
+    }
+
+    uint8_t* reserve(Buffer& buffer, const size_t size) {
+        const size_t head = buffer.head.load(std::memory_order_relaxed);
+        const size_t tail = buffer.tail.load(std::memory_order_acquire);
+
+        // The head never catches up with the tail, as the buffer would then
+        // look empty
+        if (head >= tail) {
+            const size_t end = tail == 0 ? buffer.capacity - 1
+                                         : buffer.capacity;
+
+            if (size <= end - head) {
+                buffer.wrapped = false;
+                return &buffer.data[head];
+            }
+
+            if (size < tail) {
+                buffer.wrapped = true;
+                return &buffer.data[0];
+            }
+
+            return NULL;
+        }
+
+        if (size < tail - head) {
+            buffer.wrapped = false;
+            return &buffer.data[head];
+        }
+
+        return NULL;
+    }
+
+    void commit(Buffer& buffer, const size_t size) {
+        size_t head = buffer.head.load(std::memory_order_relaxed);
+
+        if (buffer.wrapped) {
+            // The limit has to be visible before the head moves behind the
+            // tail
+            buffer.limit.store(head, std::memory_order_relaxed);
+            head = 0;
+        } else if (head + size == buffer.capacity) {
+            buffer.limit.store(buffer.capacity, std::memory_order_relaxed);
+            buffer.head.store(0, std::memory_order_release);
+            return;
+        }
+
+        buffer.head.store(head + size, std::memory_order_release);
+    }
+
+    size_t peek(Buffer& buffer, const uint8_t** out_data) {
+        size_t tail       = buffer.tail.load(std::memory_order_relaxed);
+        const size_t head = buffer.head.load(std::memory_order_acquire);
+
+        if (tail > head) {
+            const size_t limit = buffer.limit.load(std::memory_order_relaxed);
+
+            if (tail < limit) {
+                *out_data = &buffer.data[tail];
+                return limit - tail;
+            }
+
+            // Everything up to the limit has been taken, so continue at the
+            // start
+            tail = 0;
+            buffer.tail.store(0, std::memory_order_release);
+        }
+
+        *out_data = &buffer.data[tail];
+
+        return head - tail;
+    }
+
+    void consume(Buffer& buffer, const size_t size) {
+        const size_t tail = buffer.tail.load(std::memory_order_relaxed);
+
+        buffer.tail.store(tail + size, std::memory_order_release);
+    }
+
+    bool empty(const Buffer& buffer) {
+        const size_t head = buffer.head.load(std::memory_order_acquire);
+        size_t tail       = buffer.tail.load(std::memory_order_acquire);
+
+        if (tail > head &&
+            tail == buffer.limit.load(std::memory_order_relaxed)) {
+            tail = 0;
+        }
+
+        return head == tail;
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef LOG_BUFFER_H
+#define LOG_BUFFER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Lock-free single-producer/single-consumer byte ring for the logger.
+ *
+ * The producer reserves a contiguous block, writes a record straight into it
+ * and commits it. The consumer (the DMA transfer complete interrupt on the
+ * target, a thread on the host) takes the committed bytes in contiguous
+ * chunks, so that each chunk can be handed to a single transfer. A
+ * reservation which does not fit at the end of the buffer starts at the
+ * beginning instead, and the end of the data is marked by the limit.
+ */
+namespace log_buffer {
+
+    struct Buffer {
+        uint8_t* data;
+        size_t capacity;
+
+        /**
+         * @brief Position after the last committed byte, only written by the
+         * producer.
+         */
+        std::atomic<size_t> head;
+
+        /**
+         * @brief Position of the next byte to take, only written by the
+         * consumer.
+         */
+        std::atomic<size_t> tail;
+
+        /**
+         * @brief End of the data before the producer continued at the start of
+         * the buffer. Only valid while the head is behind the tail.
+         */
+        std::atomic<size_t> limit;
+
+        /**
+         * @brief Set by reserve if the reservation starts at the beginning.
+         */
+        bool wrapped;
+    };
+
+    /**
+     * @brief Sets up @p buffer to use the @p capacity bytes in @p data.
+     */
+    void initialise(Buffer& buffer, uint8_t* data, const size_t capacity);
+
+    /**
+     * @brief Called by the producer to reserve @p size contiguous bytes.
+     *
+     * @return The bytes to write the record to, or NULL if there is no space.
+     */
+    uint8_t* reserve(Buffer& buffer, const size_t size);
+
+    /**
+     * @brief Called by the producer to pass the first @p size bytes of the
+     * last reservation on to the consumer.
+     */
+    void commit(Buffer& buffer, const size_t size);
+
+    /**
+     * @brief Called by the consumer to get the oldest committed bytes which
+     * are contiguous.
+     *
+     * @return The number of bytes at @p out_data, 0 if there are none.
+     */
+    size_t peek(Buffer& buffer, const uint8_t** out_data);
+
+    /**
+     * @brief Called by the consumer to release @p size bytes returned by
+     * peek.
+     */
+    void consume(Buffer& buffer, const size_t size);
+
+    /**
+     * @return True if the consumer has taken all committed bytes.
+     */
+    bool empty(const Buffer& buffer);
+}
+
+#endif
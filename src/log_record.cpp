@@ -0,0 +1,157 @@
+#include "log_record.h"
+
+#include "logger.h"
+
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+/**
+ * @brief Stored instead of a position which is not finite or does not fit, as
+ * for keypoints which were lost while tracking.
+ */
+#define INVALID_POSITION (INT16_MIN)
+
+namespace log_record {
+
+    /**
+     * @return Size of the payload of a keypoint record with @p count
+     * keypoints.
+     */
+    static size_t keypoints_payload_size(const size_t count) {
+        return sizeof(KeyPointsHeader) + count * 2 * sizeof(int16_t) +
+               (count + 7) / 8;
+    }
+
+    /**
+     * @return @p position rounded to the nearest pixel.
+     */
+    static int16_t encode_position(const float position) {
+        if (!(fabsf(position) < (float)INT16_MAX)) {
+            return INVALID_POSITION;
+        }
+
+        return (int16_t)roundf(position);
+    }
+
+    /**
+     * @brief The text dumps printed (int)round() of the position, which is
+     * INT_MIN for the invalid positions on the host.
+     */
+    static int decode_position(const int16_t position) {
+        return position == INVALID_POSITION ? INT_MIN : position;
+    }
+
+    bool write_keypoints(const Type type,
+                         const uint32_t index,
+                         const image::KeyPoint* keypoints,
+                         const size_t size) {
+
+        const size_t payload_size = keypoints_payload_size(size);
+
+        if (payload_size > UINT16_MAX) {
+            return false;
+        }
+
+        uint8_t* record = logger::begin_record(sizeof(Header) + payload_size);
+
+        if (record == NULL) {
+            return false;
+        }
+
+        const Header header = {LOG_RECORD_MARKER,
+                               (uint8_t)type,
+                               (uint16_t)payload_size};
+        memcpy(record, &header, sizeof(Header));
+        record += sizeof(Header);
+
+        const KeyPointsHeader keypoints_header = {index, (uint16_t)size};
+        memcpy(record, &keypoints_header, sizeof(KeyPointsHeader));
+        record += sizeof(KeyPointsHeader);
+
+        uint8_t* stale = record + size * 2 * sizeof(int16_t);
+        memset(stale, 0, (size + 7) / 8);
+
+        for (size_t i = 0; i < size; i++) {
+            const int16_t position[2] = {
+                encode_position(keypoints[i].point.x),
+                encode_position(keypoints[i].point.y)};
+
+            memcpy(record, position, sizeof(position));
+            record += sizeof(position);
+
+            if (keypoints[i].stale) {
+                stale[i / 8] |= (uint8_t)(1U << (i % 8));
+            }
+        }
+
+        logger::end_record(sizeof(Header) + payload_size);
+
+        return true;
+    }
+
+    bool decode(const uint8_t* data, const size_t size, FILE* output) {
+        Header header;
+
+        if (size < sizeof(Header)) {
+            return false;
+        }
+
+        memcpy(&header, data, sizeof(Header));
+
+        if (header.marker != LOG_RECORD_MARKER ||
+            size != sizeof(Header) + header.size) {
+            return false;
+        }
+
+        const uint8_t* payload = data + sizeof(Header);
+
+        switch (header.type) {
+            case TYPE_KEYPOINTS:
+            case TYPE_TRACKS: {
+                KeyPointsHeader keypoints_header;
+
+                if (header.size < sizeof(KeyPointsHeader)) {
+                    return false;
+                }
+
+                memcpy(&keypoints_header, payload, sizeof(KeyPointsHeader));
+
+                const size_t count = keypoints_header.count;
+
+                if (header.size != keypoints_payload_size(count)) {
+                    return false;
+                }
+
+                const uint8_t* positions = payload + sizeof(KeyPointsHeader);
+                const uint8_t* stale = positions + count * 2 * sizeof(int16_t);
+
+                // Same format as the text dumps in test_lucas_kanade.cpp
+                fprintf(output, "%lu: ", (unsigned long)keypoints_header.index);
+
+                for (size_t i = 0; i < count; i++) {
+                    int16_t position[2];
+                    memcpy(position,
+                           positions + i * sizeof(position),
+                           sizeof(position));
+
+                    fprintf(output,
+                            i == count - 1 ? "%d, %d, %d" : "%d, %d, %d, ",
+                            decode_position(position[0]),
+                            decode_position(position[1]),
+                            (stale[i / 8] >> (i % 8)) & 1);
+                }
+
+                fprintf(output, "\r\n");
+
+                return true;
+            }
+
+            case TYPE_TRACE:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef LOG_RECORD_H
+#define LOG_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "image.h"
+
+/**
+ * @brief Marks the start of a binary record in the log. The text messages of
+ * the logger never contain it, so the log stays readable in a terminal apart
+ * from the binary records.
+ */
+#define LOG_RECORD_MARKER (0x00U)
+
+/**
+ * @brief Compact binary records for the logger, used for the keypoint and
+ * track dumps, which are too large to be formatted as text on the hot path.
+ *
+ * A record is a Header followed by the payload. For the keypoint records,
+ * the payload is a KeyPointsHeader, the rounded positions as pairs of int16
+ * and a bitmap of the stale flags, one bit per keypoint. They are decoded
+ * with vio_log_decode on the host into the same text as the logger would
+ * have printed, which is compared against the reference dumps, so the
+ * positions stay rounded although the tracker is sub-pixel. The golden files
+ * of vio_benchmark keep the sub-pixel positions. The trace records are
+ * written by trace.h.
+ */
+namespace log_record {
+
+    enum Type : uint8_t {
+        /**
+         * @brief Keypoints extracted with FAST.
+         */
+        TYPE_KEYPOINTS = 1,
+
+        /**
+         * @brief Keypoints tracked with Lucas-Kanade.
+         */
+        TYPE_TRACKS = 2,
+
+        /**
+         * @brief Trace of a frame, see trace.h.
+         */
+        TYPE_TRACE = 3
+    };
+
+    struct __attribute__((packed)) Header {
+        uint8_t marker;
+        uint8_t type;
+
+        /**
+         * @brief Size of the payload in bytes.
+         */
+        uint16_t size;
+    };
+
+    struct __attribute__((packed)) KeyPointsHeader {
+        uint32_t index;
+        uint16_t count;
+    };
+
+    /**
+     * @brief Logs the rounded positions and stale flags of @p size
+     * @p keypoints of the frame at @p index.
+     *
+     * @return False if the record did not fit in the log buffer and was
+     * dropped.
+     */
+    bool write_keypoints(const Type type,
+                         const uint32_t index,
+                         const image::KeyPoint* keypoints,
+                         const size_t size);
+
+    /**
+     * @brief Decodes the record of @p size bytes at @p data (header included)
+     * and prints it as text to @p output. Trace records are skipped, they
+     * are converted with trace::write_chrome instead.
+     *
+     * @return False if the record is malformed.
+     */
+    bool decode(const uint8_t* data, const size_t size, FILE* output);
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include "logger.h"
 
+#include "log_buffer.h"
+
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -7,6 +9,11 @@
 #include "fsl_common.h"
 #include "fsl_lpuart.h"
 
+#if __CORTEX_M == 7
+    #include "fsl_dmamux.h"
+    #include "fsl_lpuart_edma.h"
+#endif
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 #include "fsl_iomuxc.h"
@@ -17,18 +24,168 @@
 #define WARN_LEVEL_FMT  "[ WARN  ] "
 #define ERROR_LEVEL_FMT "[ ERROR ] "
 
+/**
+ * @brief Size of the ring buffer the messages are written to.
+ */
+#define LOG_BUFFER_SIZE (0x4000)
+
+/**
+ * @brief Largest formatted message, including the level and prefix.
+ */
+#define MESSAGE_SIZE (256)
+
+/**
+ * @brief The eDMA channel which feeds LPUART1 on CORE0.
+ */
+#define LOG_DMA_CHANNEL (0U)
+
 namespace logger {
 
     static Level log_level = Level::LOG_INFO;
 
-    static char message_buffer[256] = "";
-
     static size_t prefix_buffer_length = 0;
 
     static char prefix_buffer[16] = "";
 
     static bool initialised = false;
 
+    /**
+     * @brief Data of the log buffer, placed in DTCM. DTCM is not cached, so
+     * the DMA reads what was written without cache maintenance.
+     */
+    static uint8_t log_data[LOG_BUFFER_SIZE];
+
+    static log_buffer::Buffer buffer;
+
+    /**
+     * @brief Number of messages and records dropped as the buffer was full.
+     */
+    static uint32_t dropped = 0;
+
+#if __CORTEX_M == 7
+
+    static edma_handle_t tx_edma_handle;
+
+    static lpuart_edma_handle_t lpuart_edma_handle;
+
+    /**
+     * @brief Number of bytes in the running DMA transfer, 0 if there is none.
+     */
+    static volatile size_t transfer_size = 0;
+
+    /**
+     * @brief Starts a DMA transfer of the oldest bytes in the buffer, unless
+     * one is running already. Called with interrupts disabled or from the
+     * interrupt which completes a transfer.
+     */
+    static void start_transfer() {
+        if (transfer_size != 0) {
+            return;
+        }
+
+        const uint8_t* data = NULL;
+        const size_t size   = log_buffer::peek(buffer, &data);
+
+        if (size == 0) {
+            return;
+        }
+
+        transfer_size = size;
+
+        lpuart_transfer_t transfer = {};
+        transfer.data              = (uint8_t*)data;
+        transfer.dataSize          = size;
+
+        LPUART_SendEDMA(LPUART1, &lpuart_edma_handle, &transfer);
+    }
+
+    static void transfer_callback(
+        __attribute__((unused)) LPUART_Type* base,
+        __attribute__((unused)) lpuart_edma_handle_t* handle,
+        status_t status,
+        __attribute__((unused)) void* user_data) {
+
+        if (status != kStatus_LPUART_TxIdle) {
+            return;
+        }
+
+        log_buffer::consume(buffer, transfer_size);
+        transfer_size = 0;
+
+        start_transfer();
+    }
+
+    static void drain() {
+        const uint32_t primask = DisableGlobalIRQ();
+        start_transfer();
+        EnableGlobalIRQ(primask);
+    }
+
+    static bool draining() { return transfer_size != 0; }
+
+#else
+
+    // The DMA request of LPUART1 can only be routed to one channel, which is
+    // used by CORE0, so this core sends its (few) messages synchronously
+    static void drain() {
+        const uint8_t* data = NULL;
+        size_t size         = 0;
+
+        while ((size = log_buffer::peek(buffer, &data)) > 0) {
+            LPUART_WriteBlocking(LPUART1, data, size);
+            log_buffer::consume(buffer, size);
+        }
+    }
+
+    static bool draining() { return false; }
+
+#endif
+
+    /**
+     * @brief Formats a message into the log buffer, preceded by
+     * @p level_format and the prefix unless @p level_format is NULL.
+     */
+    static void write(const char* level_format,
+                      const char* format,
+                      va_list args) {
+
+        if (dropped > 0) {
+            const uint32_t dropped_messages = dropped;
+            dropped                         = 0;
+
+            logger::warnf("%lu log messages dropped\r\n",
+                          (unsigned long)dropped_messages);
+        }
+
+        char* message = (char*)begin_record(MESSAGE_SIZE);
+
+        if (message == NULL) {
+            return;
+        }
+
+        size_t length = 0;
+
+        if (level_format != NULL) {
+            const size_t level_length = strlen(level_format);
+
+            memcpy(message, level_format, level_length);
+            memcpy(message + level_length, prefix_buffer, prefix_buffer_length);
+
+            length = level_length + prefix_buffer_length;
+        }
+
+        const int formatted =
+            vsnprintf(message + length, MESSAGE_SIZE - length, format, args);
+
+        if (formatted > 0) {
+            length += (size_t)formatted < MESSAGE_SIZE - length
+                          ? (size_t)formatted
+                          : MESSAGE_SIZE - length - 1;
+        }
+
+        end_record(length);
+    }
+
     void initialise() {
         CLOCK_EnableClock(kCLOCK_Iomuxc);
 
@@ -61,6 +218,27 @@ namespace logger {
                     &lpuart_config,
                     CLOCK_GetRootClockFreq(kCLOCK_Root_Lpuart1));
 
+        log_buffer::initialise(buffer, log_data, sizeof(log_data));
+
+#if __CORTEX_M == 7
+        DMAMUX_Init(DMAMUX0);
+        DMAMUX_SetSource(DMAMUX0, LOG_DMA_CHANNEL, kDmaRequestMuxLPUART1Tx);
+        DMAMUX_EnableChannel(DMAMUX0, LOG_DMA_CHANNEL);
+
+        edma_config_t edma_config = {};
+        EDMA_GetDefaultConfig(&edma_config);
+        EDMA_Init(DMA0, &edma_config);
+
+        EDMA_CreateHandle(&tx_edma_handle, DMA0, LOG_DMA_CHANNEL);
+
+        LPUART_TransferCreateHandleEDMA(LPUART1,
+                                        &lpuart_edma_handle,
+                                        transfer_callback,
+                                        NULL,
+                                        &tx_edma_handle,
+                                        NULL);
+#endif
+
         initialised = true;
     }
 
@@ -91,45 +269,19 @@ namespace logger {
 
         va_list args;
         va_start(args, format);
-
-        vsprintf(message_buffer, format, args);
+        write(INFO_LEVEL_FMT, format, args);
         va_end(args);
-
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)INFO_LEVEL_FMT,
-                             strlen(INFO_LEVEL_FMT));
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)prefix_buffer,
-                             prefix_buffer_length);
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)message_buffer,
-                             strlen(message_buffer));
     }
 
     void debugf(const char* format, ...) {
-        if (!initialised) {
-            return;
-        }
-
-        if (log_level == Level::LOG_INFO) {
+        if (!initialised || log_level == Level::LOG_INFO) {
             return;
         }
 
         va_list args;
         va_start(args, format);
-
-        vsprintf(message_buffer, format, args);
+        write(DEBUG_LEVEL_FMT, format, args);
         va_end(args);
-
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)DEBUG_LEVEL_FMT,
-                             strlen(DEBUG_LEVEL_FMT));
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)prefix_buffer,
-                             prefix_buffer_length);
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)message_buffer,
-                             strlen(message_buffer));
     }
 
     void warnf(const char* format, ...) {
@@ -139,19 +291,8 @@ namespace logger {
 
         va_list args;
         va_start(args, format);
-
-        vsprintf(message_buffer, format, args);
+        write(WARN_LEVEL_FMT, format, args);
         va_end(args);
-
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)WARN_LEVEL_FMT,
-                             strlen(WARN_LEVEL_FMT));
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)prefix_buffer,
-                             prefix_buffer_length);
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)message_buffer,
-                             strlen(message_buffer));
     }
 
     void errorf(const char* format, ...) {
@@ -161,19 +302,8 @@ namespace logger {
 
         va_list args;
         va_start(args, format);
-
-        vsprintf(message_buffer, format, args);
+        write(ERROR_LEVEL_FMT, format, args);
         va_end(args);
-
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)ERROR_LEVEL_FMT,
-                             strlen(ERROR_LEVEL_FMT));
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)prefix_buffer,
-                             prefix_buffer_length);
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)message_buffer,
-                             strlen(message_buffer));
     }
 
     void rawf(const char* format, ...) {
@@ -183,32 +313,46 @@ namespace logger {
 
         va_list args;
         va_start(args, format);
-
-        vsprintf(message_buffer, format, args);
+        write(NULL, format, args);
         va_end(args);
-
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)message_buffer,
-                             strlen(message_buffer));
     }
 
     void debugrawf(const char* format, ...) {
-        if (!initialised) {
-            return;
-        }
-
-        if (log_level == Level::LOG_INFO) {
+        if (!initialised || log_level == Level::LOG_INFO) {
             return;
         }
 
         va_list args;
         va_start(args, format);
-
-        vsprintf(message_buffer, format, args);
+        write(NULL, format, args);
         va_end(args);
+    }
+
+    uint8_t* begin_record(const size_t size) {
+        if (!initialised) {
+            return NULL;
+        }
+
+        uint8_t* record = log_buffer::reserve(buffer, size);
+
+        if (record == NULL) {
+            dropped++;
+        }
+
+        return record;
+    }
+
+    void end_record(const size_t size) {
+        log_buffer::commit(buffer, size);
+
+        drain();
+    }
+
+    void flush() {
+        if (!initialised) {
+            return;
+        }
 
-        LPUART_WriteBlocking(LPUART1,
-                             (uint8_t*)message_buffer,
-                             strlen(message_buffer));
+        while (!log_buffer::empty(buffer) || draining()) {}
     }
 }
@@ -1,6 +1,16 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Logging module. The messages are formatted into a ring buffer
+ * (log_buffer.h) and sent out in the background, on CORE0 by DMA to the
+ * LPUART and on the host by a thread to stdout, so that logging only costs
+ * the formatting and a copy. Larger dumps are written as binary records, see
+ * log_record.h.
+ */
 namespace logger {
 
     enum class Level { LOG_INFO, LOG_DEBUG };
@@ -55,6 +65,25 @@ namespace logger {
      * @brief Logs a raw message, without any prefix, if the log level is debug.
      */
     void debugrawf(const char* format, ...);
+
+    /**
+     * @brief Reserves @p size bytes in the log for a binary record.
+     *
+     * @return Where to write the record, or NULL if the log buffer is full, in
+     * which case the record is dropped.
+     */
+    uint8_t* begin_record(const size_t size);
+
+    /**
+     * @brief Sends the first @p size bytes of the record reserved with
+     * begin_record.
+     */
+    void end_record(const size_t size);
+
+    /**
+     * @brief Waits until everything logged so far has been sent.
+     */
+    void flush();
 }
 
 #endif
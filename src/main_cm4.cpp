@@ -1,17 +1,21 @@
 #include "clock.h"
+#include "dataset_loader.h"
 #include "delay.h"
 #include "feature_extraction.h"
+#include "file_system.h"
 #include "led.h"
 #include "linalg.h"
 #include "logger.h"
 #include "memory.h"
 #include "multicore.h"
-#include "profile.h"
+#include "pipeline.h"
+
+#include <stdio.h>
 
 volatile bool has_received                   = false;
 volatile multicore::Message received_message = {};
 
-void message_callback(const multicore::Message message) {
+void message_callback(const multicore::Message& message) {
 
     memcpy((void*)&received_message,
            (void*)&message,
@@ -52,8 +56,57 @@ int main(void) {
         message.data[i + 1] = message_text[i];
     }
 
+    has_received = false;
+
     multicore::send_message(message);
 
+    // Wait for CORE0 to tell which frames to produce
+    while (!has_received) {}
+
+    multicore::Message start_message = {};
+
+    memcpy((void*)&start_message,
+           (void*)&received_message,
+           sizeof(multicore::Message));
+
+    pipeline::Exchange exchange = {};
+    char dataset_name[32];
+    uint16_t start_index = 0, end_index = 0;
+
+    if (pipeline::parse_start_message(start_message,
+                                      &exchange,
+                                      dataset_name,
+                                      sizeof(dataset_name),
+                                      &start_index,
+                                      &end_index)) {
+
+        if (!file_system::initialise()) {
+            logger::errorf("Failed to initialise file system\r\n");
+        }
+
+        char dataset_path[64] = "";
+        sprintf(dataset_path, "/%s", dataset_name);
+
+        dataset_loader::initialise(dataset_path);
+
+        logger::infof("Producing frames %d to %d of %s\r\n",
+                      start_index,
+                      end_index,
+                      dataset_path);
+
+        for (int32_t index = start_index; index <= end_index; index++) {
+            pipeline::produce(exchange, index);
+        }
+
+        pipeline::produce_end(exchange);
+
+        dataset_loader::deinitialise();
+
+        if (!file_system::deinitialise()) {
+            logger::errorf("Failed to de-initialise file system\r\n");
+        }
+    }
+
     while (true) {
         led::toggle();
         delay::ms(1000);
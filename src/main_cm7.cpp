@@ -6,7 +6,8 @@
 #include "logger.h"
 #include "memory.h"
 #include "multicore.h"
-#include "profile.h"
+#include "pipeline.h"
+#include "trace.h"
 
 #include "test_fast.h"
 #include "test_lucas_kanade.h"
@@ -18,6 +19,18 @@
 
 #define MAX_NUMBER_OF_FEATURES_FOR_FAST (800)
 
+/**
+ * @brief If set, CORE1 loads the images and builds the image pyramids while
+ * this core tracks, see pipeline.h. Otherwise, this core does everything.
+ */
+#define USE_PIPELINE (1)
+
+/**
+ * @brief If set, the trace of every frame is logged, see trace.h. Convert the
+ * log with vio_log_decode --chrome.
+ */
+#define USE_TRACE (0)
+
 /**
  * @brief Set when the secondary core has sent a message to this core.
  */
@@ -28,16 +41,27 @@ volatile bool has_received = false;
  */
 volatile multicore::Message received_message = {};
 
+#if !USE_PIPELINE
+
 /**
  * @brief Buffer for the image data (placed in DTCM)
  */
-static __attribute__((aligned(32))) uint8_t image_data[752 * 480];
+static __attribute__((aligned(32))) uint8_t image_data[MAX_IMAGE_SIZE];
+
+/**
+ * @brief Buffer for the image read ahead while the one in image_data is
+ * processed, placed in SDRAM as it does not fit in DTCM as well.
+ */
+SECTION_SDRAM static __attribute__((aligned(32)))
+uint8_t prefetch_image_data[MAX_IMAGE_SIZE];
 
 /**
  * @brief Buffer for the lower levels of the image pyramid, placed in OCRAM3.
  */
 SECTION_OCRAM3 static uint8_t lower_levels_image_pyramid_buffer[0x20000];
 
+#endif
+
 /**
  * @brief Start keypoints for Lucas-Kanade/keypoints extracted with fast.
  */
@@ -53,10 +77,34 @@ static image::KeyPoint end_keypoints[MAX_NUMBER_OF_FEATURES_FOR_FAST];
  */
 SECTION_OCRAM12 static image::PatchPyramid patch_pyramid;
 
+/**
+ * @brief Scratch memory of fast_detector (placed in DTCM), which keeps the
+ * rows in flight of FAST off the stack.
+ */
+static __attribute__((aligned(4))) uint8_t
+    fast_scratch[frontend::FastDetector::scratch_size(MAX_IMAGE_WIDTH)];
+
+/**
+ * @brief FAST for the re-detections, set up once.
+ */
+static frontend::FastDetector fast_detector;
+
+/**
+ * @brief Frames handed over from CORE1, placed in SDRAM. They are not
+ * initialised, so that this core never has them dirty in its cache.
+ */
+SECTION_SDRAM static pipeline::Frame pipeline_frames[PIPELINE_FRAMES];
+
+/**
+ * @brief Ring through which CORE1 passes the frames, placed in the shared
+ * memory of RPMsg, which is not cached.
+ */
+SECTION_SHMEM static frame_ring::Ring pipeline_ring;
+
 /**
  * @brief Called when the secondary core sends a message to this core.
  */
-void message_callback(const multicore::Message msg) {
+void message_callback(const multicore::Message& msg) {
 
     memcpy((void*)&received_message, (void*)&msg, sizeof(multicore::Message));
     has_received = true;
@@ -72,6 +120,8 @@ int main(void) {
     logger::set_level(logger::Level::LOG_INFO);
     logger::set_prefix("(CORE0) ");
 
+    trace::set_enabled(USE_TRACE);
+
 #ifdef DEBUG
     logger::rawf("\r\n");
     logger::infof("=== Starting up (Build type: DEBUG) ===\r\n");
@@ -101,6 +151,33 @@ int main(void) {
 
     logger::rawf("\r\n");
 
+    fast_detector.initialise(MAX_IMAGE_WIDTH,
+                             RESAMPLE_FAST_THRESHOLD,
+                             fast_scratch,
+                             sizeof(fast_scratch));
+
+#if USE_PIPELINE
+
+    pipeline::Exchange pipeline_exchange = {&pipeline_ring, pipeline_frames};
+
+    pipeline::initialise(pipeline_exchange);
+
+    multicore::send_message(
+        pipeline::start_message(pipeline_exchange, "v23", 1, 1922));
+
+    // Testing FAST+LK against Vicon Room 2 03, with the images loaded by
+    // CORE1 from the directory v23 on the SD card
+    logger::infof("V23 FAST + LK (pipelined)\r\n");
+    test::lucas_kanade::test_with_pipeline(
+        &pipeline_exchange,
+        &patch_pyramid,
+        &fast_detector,
+        keypoints,
+        end_keypoints,
+        MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL);
+
+#else
+
     if (!file_system::initialise()) {
         logger::errorf("Failed to initialise file system\r\n");
         exit(1);
@@ -109,11 +186,16 @@ int main(void) {
     // Testing FAST+LK against Vicon Room 2 03. Requires the dataset section
     // stored on the SD card in a directory called v23 where the images are
     // indexed sequentially
+    uint8_t* const image_data_buffers[PREFETCH_BUFFERS] = {
+        image_data,
+        prefetch_image_data};
+
     logger::infof("V23 FAST + LK\r\n");
     test::lucas_kanade::test_with_dataset_without_references_with_resample(
-        image_data,
+        image_data_buffers,
         lower_levels_image_pyramid_buffer,
         &patch_pyramid,
+        &fast_detector,
         keypoints,
         end_keypoints,
         MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL,
@@ -125,5 +207,10 @@ int main(void) {
         logger::errorf("Failed to de-initialise file system\r\n");
     }
 
+#endif
+
+    // The log is sent in the background, so wait for the rest of it
+    logger::flush();
+
     return 0;
 }
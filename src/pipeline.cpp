@@ -0,0 +1,241 @@
+#include "pipeline.h"
+
+#include "dataset_loader.h"
+#include "logger.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+
+#ifndef CPU_MIMXRT1166DVM6A
+    #include <thread>
+#endif
+
+/**
+ * @brief First word of the message which starts the producer.
+ */
+#define START_MESSAGE_ID (0x5049U)
+
+namespace pipeline {
+
+    /**
+     * @brief Called while waiting for the other side. On the target, the core
+     * sleeps until the next interrupt, which is either the doorbell of the
+     * other core or at the latest the next tick. On the host, the other side
+     * is a thread which might need this thread's core to make progress.
+     */
+    static inline void backoff() {
+#ifdef CPU_MIMXRT1166DVM6A
+        __WFI();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    /**
+     * @brief Wakes up the other side after the ring has changed.
+     */
+    static inline void doorbell() {
+#ifdef CPU_MIMXRT1166DVM6A
+        multicore::ring_doorbell();
+#endif
+    }
+
+    static uint32_t elapsed_us(const uint32_t start) {
+        return (uint32_t)((uint64_t)(trace::now() - start) * 1000000ULL /
+                          BOARD_BOOTCLOCKRUN_CORE_CLOCK);
+    }
+
+    void initialise(Exchange& exchange) {
+        frame_ring::initialise(*exchange.ring);
+    }
+
+    Frame* acquire_empty(Exchange& exchange) {
+        // The ring holds the frames owned by the consumer, so the next frame
+        // is free as long as the ring holds less than all frames
+        if (frame_ring::size(*exchange.ring) >= PIPELINE_FRAMES) {
+            return NULL;
+        }
+
+        const uint32_t head =
+            exchange.ring->head.load(std::memory_order_relaxed);
+
+        return &exchange.frames[head % PIPELINE_FRAMES];
+    }
+
+    void publish(Exchange& exchange) {
+        const uint32_t head =
+            exchange.ring->head.load(std::memory_order_relaxed);
+
+        Frame* frame = &exchange.frames[head % PIPELINE_FRAMES];
+
+        frame_ring::clean(frame, sizeof(Frame));
+
+        frame_ring::Descriptor descriptor = {};
+
+        descriptor.slot     = head % PIPELINE_FRAMES;
+        descriptor.size     = sizeof(Frame);
+        descriptor.sequence = frame->index;
+
+        // Can not fail, as acquire_empty has checked that there is space
+        frame_ring::push(*exchange.ring, descriptor);
+
+        doorbell();
+    }
+
+    Frame* acquire_filled(Exchange& exchange) {
+        const frame_ring::Descriptor* descriptor =
+            frame_ring::front(*exchange.ring);
+
+        if (descriptor == NULL) {
+            return NULL;
+        }
+
+        Frame* frame = &exchange.frames[descriptor->slot];
+
+        frame_ring::invalidate(frame, descriptor->size);
+
+        return frame;
+    }
+
+    Frame* wait_filled(Exchange& exchange) {
+
+        Frame* frame = NULL;
+
+        while ((frame = acquire_filled(exchange)) == NULL) {
+            backoff();
+        }
+
+        return frame;
+    }
+
+    void release(Exchange& exchange) {
+        frame_ring::pop(*exchange.ring);
+
+        doorbell();
+    }
+
+    bool produce(Exchange& exchange, const int32_t index) {
+
+        Frame* frame = NULL;
+
+        while ((frame = acquire_empty(exchange)) == NULL) {
+            backoff();
+        }
+
+        frame->index = index;
+        frame->valid = false;
+
+        uint32_t start = trace::now();
+
+        // Decoded straight into the frame
+        frame->image.data = frame->image_data;
+
+        if (!dataset_loader::retrieve_image_into(frame->image,
+                                                 PIPELINE_IMAGE_SIZE,
+                                                 index)) {
+            logger::errorf("Failed to retrieve image %ld\r\n", (long)index);
+            publish(exchange);
+            return false;
+        }
+
+        frame->load_us = elapsed_us(start);
+
+        start = trace::now();
+
+        frame->image_pyramid = image::ImagePyramid(frame->image,
+                                                   frame->image_pyramid_buffer);
+
+        frame->pyramid_us = elapsed_us(start);
+
+        frame->valid = true;
+
+        publish(exchange);
+
+        return true;
+    }
+
+    void produce_end(Exchange& exchange) {
+
+        Frame* frame = NULL;
+
+        while ((frame = acquire_empty(exchange)) == NULL) {
+            backoff();
+        }
+
+        frame->index = -1;
+        frame->valid = false;
+
+        publish(exchange);
+    }
+
+#ifdef CPU_MIMXRT1166DVM6A
+
+    /**
+     * @brief Stores @p address in two words of @p data.
+     */
+    static void store_address(uint16_t* data, const void* address) {
+        data[0] = (uint16_t)((uint32_t)address & 0xFFFF);
+        data[1] = (uint16_t)((uint32_t)address >> 16);
+    }
+
+    static void* load_address(const uint16_t* data) {
+        return (void*)((uint32_t)data[0] | ((uint32_t)data[1] << 16));
+    }
+
+    multicore::Message start_message(const Exchange& exchange,
+                                     const char* dataset_name,
+                                     const uint16_t start_index,
+                                     const uint16_t end_index) {
+
+        multicore::Message message = {};
+
+        message.data[0] = START_MESSAGE_ID;
+        store_address(&message.data[1], exchange.ring);
+        store_address(&message.data[3], exchange.frames);
+        message.data[5] = start_index;
+        message.data[6] = end_index;
+
+        // The name is null terminated, as the message is zero initialised
+        const size_t max_length = sizeof(message.data) / sizeof(uint16_t) - 8;
+
+        for (size_t i = 0; i < max_length && dataset_name[i] != '\0'; i++) {
+            message.data[i + 7] = dataset_name[i];
+        }
+
+        return message;
+    }
+
+    bool parse_start_message(const multicore::Message& message,
+                             Exchange* out_exchange,
+                             char* out_dataset_name,
+                             const size_t dataset_name_size,
+                             uint16_t* out_start_index,
+                             uint16_t* out_end_index) {
+
+        if (message.data[0] != START_MESSAGE_ID) {
+            return false;
+        }
+
+        out_exchange->ring =
+            (frame_ring::Ring*)load_address(&message.data[1]);
+        out_exchange->frames = (Frame*)load_address(&message.data[3]);
+        *out_start_index     = message.data[5];
+        *out_end_index       = message.data[6];
+
+        size_t i = 0;
+
+        for (; i < dataset_name_size - 1 && message.data[i + 7] != 0; i++) {
+            out_dataset_name[i] = (char)message.data[i + 7];
+        }
+
+        out_dataset_name[i] = '\0';
+
+        return true;
+    }
+
+#endif
+
+}
@@ -0,0 +1,172 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_ring.h"
+#include "image.h"
+
+#ifdef CPU_MIMXRT1166DVM6A
+    #include "multicore.h"
+#endif
+
+/**
+ * @brief Number of frames in the exchange. With two frames, the producer fills
+ * one frame while the consumer processes the other.
+ */
+#define PIPELINE_FRAMES (2)
+
+/**
+ * @brief Largest image (in pixels) a frame can hold.
+ */
+#define PIPELINE_IMAGE_SIZE (MAX_IMAGE_SIZE)
+
+/**
+ * @brief Size of the buffer for the lower levels of the image pyramid.
+ */
+#define PIPELINE_IMAGE_PYRAMID_BUFFER_SIZE (0x20000)
+
+/**
+ * @brief Two-stage frontend pipeline, where a producer (CORE1) loads the
+ * images and builds the image pyramids while the consumer (CORE0) tracks the
+ * previous frame.
+ *
+ * The frames are handed over without copies: they live in memory shared by
+ * both cores and the producer passes them on through a frame_ring::Ring,
+ * which only holds a descriptor per frame. A frame belongs to the producer
+ * until its descriptor is pushed and to the consumer until the descriptor is
+ * popped again. The frames are filled and consumed in order, so the slot of
+ * the next frame follows from the number of descriptors pushed or popped.
+ */
+namespace pipeline {
+
+    struct Frame {
+        /**
+         * @brief Index of the image in the dataset, or -1 at the end of the
+         * stream.
+         */
+        int32_t index;
+
+        /**
+         * @brief False if the image could not be loaded, in which case there
+         * is no image or pyramid in the frame.
+         */
+        bool valid;
+
+        /**
+         * @brief The blurred image, which is the first level of the pyramid.
+         */
+        image::Image image;
+
+        image::ImagePyramid image_pyramid;
+
+        /**
+         * @brief Time spent by the producer on loading the image and building
+         * the pyramid, in microseconds.
+         */
+        uint32_t load_us;
+        uint32_t pyramid_us;
+
+        __attribute__((aligned(32))) uint8_t image_data[PIPELINE_IMAGE_SIZE];
+
+        uint8_t image_pyramid_buffer[PIPELINE_IMAGE_PYRAMID_BUFFER_SIZE];
+    };
+
+    /**
+     * @brief The view of one side on the pipeline. The ring and the frames
+     * are shared between the cores, the exchange itself is not.
+     */
+    struct Exchange {
+        /**
+         * @brief Ring of the frames passed to the consumer, in memory which is
+         * not cached (rpmsg_sh_mem on the target).
+         */
+        frame_ring::Ring* ring;
+
+        /**
+         * @brief The PIPELINE_FRAMES frames, which may be in cached memory.
+         */
+        Frame* frames;
+    };
+
+    /**
+     * @brief Gives all frames in @p exchange to the producer. Has to be called
+     * by the consumer before any of the sides start.
+     */
+    void initialise(Exchange& exchange);
+
+    /**
+     * @return The next frame to fill, or NULL if the consumer still owns it.
+     */
+    Frame* acquire_empty(Exchange& exchange);
+
+    /**
+     * @brief Hands the frame returned by acquire_empty over to the consumer,
+     * after writing it back from the cache of the producer.
+     */
+    void publish(Exchange& exchange);
+
+    /**
+     * @return The next frame to process, or NULL if it has not been published
+     * yet. The frame is invalidated in the cache of the consumer.
+     */
+    Frame* acquire_filled(Exchange& exchange);
+
+    /**
+     * @brief Waits until the next frame to process has been published.
+     *
+     * @return The frame, see acquire_filled.
+     */
+    Frame* wait_filled(Exchange& exchange);
+
+    /**
+     * @brief Hands the frame returned by acquire_filled back to the producer.
+     */
+    void release(Exchange& exchange);
+
+    /**
+     * @brief Waits for an empty frame, loads the image at @p index from the
+     * dataset set up with dataset_loader::initialise into it, builds the
+     * image pyramid and publishes the frame.
+     *
+     * @return False if the image could not be loaded. The frame is still
+     * published, but marked as invalid.
+     */
+    bool produce(Exchange& exchange, const int32_t index);
+
+    /**
+     * @brief Waits for an empty frame and publishes it as the end of the
+     * stream.
+     */
+    void produce_end(Exchange& exchange);
+
+#ifdef CPU_MIMXRT1166DVM6A
+
+    /**
+     * @brief Creates the message which CORE0 sends to CORE1 to start producing
+     * the frames in [@p start_index, @p end_index] of @p dataset_name into
+     * @p exchange.
+     */
+    multicore::Message start_message(const Exchange& exchange,
+                                     const char* dataset_name,
+                                     const uint16_t start_index,
+                                     const uint16_t end_index);
+
+    /**
+     * @brief Parses a message created with start_message.
+     *
+     * @return False if @p message is not a start message.
+     */
+    bool parse_start_message(const multicore::Message& message,
+                             Exchange* out_exchange,
+                             char* out_dataset_name,
+                             const size_t dataset_name_size,
+                             uint16_t* out_start_index,
+                             uint16_t* out_end_index);
+
+#endif
+
+}
+
+#endif
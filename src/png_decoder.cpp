@@ -0,0 +1,897 @@
+#include "png_decoder.h"
+
+#include <string.h>
+
+/**
+ * @brief Size of the buffer the file is read through, a multiple of the 512
+ * byte blocks of the SD card.
+ */
+#define FILE_BUFFER_SIZE (4096U)
+
+/**
+ * @brief Size of the sliding window of deflate, which is the largest distance
+ * a match can refer back to.
+ */
+#define WINDOW_SIZE (32768U)
+#define WINDOW_MASK (WINDOW_SIZE - 1)
+
+/**
+ * @brief Number of inflated bytes after which the window is written to the
+ * image. Has to leave room for the longest match (258 bytes) before the
+ * unwritten bytes would be overwritten.
+ */
+#define FLUSH_THRESHOLD (WINDOW_SIZE / 2)
+
+/**
+ * @brief Codes of up to this many bits are decoded with a single table
+ * lookup, the rest bit by bit.
+ */
+#define FAST_BITS (10)
+
+#define MAX_CODE_LENGTH (15)
+
+#define MAX_LITERAL_LENGTH_CODES (288)
+#define MAX_DISTANCE_CODES       (30)
+
+#define CHUNK_TYPE(a, b, c, d)                                                 \
+    (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) |    \
+     (uint32_t)(d))
+
+namespace png_decoder {
+
+    /**
+     * @brief Canonical Huffman code, decoded as in zlib's puff with a lookup
+     * table in front for the short codes.
+     */
+    struct Huffman {
+        /**
+         * @brief Number of symbols with each code length.
+         */
+        uint16_t counts[MAX_CODE_LENGTH + 1];
+
+        /**
+         * @brief Symbols ordered by their code.
+         */
+        uint16_t symbols[MAX_LITERAL_LENGTH_CODES];
+
+        /**
+         * @brief (length << 9) | symbol, indexed by the next FAST_BITS bits of
+         * the stream. 0 if the code is longer.
+         */
+        uint16_t fast[1 << FAST_BITS];
+    };
+
+    struct Decoder {
+        ReadCallback read;
+        void* context;
+
+        /**
+         * @brief The unread part of the file buffer.
+         */
+        const uint8_t* position;
+        const uint8_t* end;
+
+        bool end_of_file;
+        bool read_failed;
+
+        /**
+         * @brief Bytes left in the current IDAT chunk.
+         */
+        uint32_t chunk_remaining;
+
+        /**
+         * @brief Set when there are no more IDAT chunks, after which the bit
+         * buffer is filled with zeros.
+         */
+        bool end_of_data;
+
+        uint64_t bits;
+        uint32_t bit_count;
+
+        /**
+         * @brief Number of bytes inflated, the window holds the last
+         * WINDOW_SIZE of them.
+         */
+        uint32_t window_position;
+
+        /**
+         * @brief Number of inflated bytes which have been written to the
+         * image.
+         */
+        uint32_t flushed;
+
+        uint8_t* data;
+        uint32_t width;
+        uint32_t height;
+
+        /**
+         * @brief The row being written and the position in it, where 0 is
+         * the filter type byte which precedes every row.
+         */
+        uint32_t row;
+        uint32_t column;
+        uint8_t filter;
+
+        uint32_t adler_a;
+        uint32_t adler_b;
+    };
+
+    static __attribute__((aligned(32))) uint8_t file_buffer[FILE_BUFFER_SIZE];
+
+    static uint8_t window[WINDOW_SIZE];
+
+    static Huffman literal_length_code, distance_code, code_length_code;
+
+    static Huffman fixed_literal_length_code, fixed_distance_code;
+
+    static bool fixed_codes_built = false;
+
+    static const uint16_t length_base[29] = {
+        3,  4,  5,  6,  7,  8,  9,  10,  11,  13,  15,  17,  19,  23, 27,
+        31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+
+    static const uint8_t length_extra[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+        2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+    static const uint16_t distance_base[MAX_DISTANCE_CODES] = {
+        1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+        33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+        1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+
+    static const uint8_t distance_extra[MAX_DISTANCE_CODES] = {
+        0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    // ---------------------------- File ---------------------------------
+
+    /**
+     * @return False at the end of the file or on a read error.
+     */
+    static bool fill(Decoder& decoder) {
+        if (decoder.end_of_file) {
+            return false;
+        }
+
+        uint32_t read = 0;
+
+        if (!decoder.read(decoder.context,
+                          file_buffer,
+                          FILE_BUFFER_SIZE,
+                          &read)) {
+            decoder.read_failed = true;
+            decoder.end_of_file = true;
+            return false;
+        }
+
+        decoder.end_of_file = read < FILE_BUFFER_SIZE;
+        decoder.position    = file_buffer;
+        decoder.end         = file_buffer + read;
+
+        return read > 0;
+    }
+
+    /**
+     * @brief Reads @p size bytes into @p out, or skips them if @p out is
+     * NULL.
+     */
+    static bool read_bytes(Decoder& decoder, uint8_t* out, uint32_t size) {
+        while (size > 0) {
+            if (decoder.position == decoder.end && !fill(decoder)) {
+                return false;
+            }
+
+            uint32_t available = decoder.end - decoder.position;
+            available          = available < size ? available : size;
+
+            if (out != NULL) {
+                memcpy(out, decoder.position, available);
+                out += available;
+            }
+
+            decoder.position += available;
+            size -= available;
+        }
+
+        return true;
+    }
+
+    static uint32_t big_endian(const uint8_t* data) {
+        return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
+               ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+    }
+
+    /**
+     * @brief Skips to the data of the next IDAT chunk, from the start of a
+     * chunk.
+     *
+     * @return False if the image data has ended.
+     */
+    static bool next_data_chunk(Decoder& decoder) {
+        while (true) {
+            uint8_t header[8];
+
+            if (!read_bytes(decoder, header, sizeof(header))) {
+                return false;
+            }
+
+            const uint32_t length = big_endian(header);
+            const uint32_t type   = big_endian(header + 4);
+
+            if (type == CHUNK_TYPE('I', 'D', 'A', 'T') && length > 0) {
+                decoder.chunk_remaining = length;
+                return true;
+            }
+
+            if (type == CHUNK_TYPE('I', 'E', 'N', 'D')) {
+                return false;
+            }
+
+            // Skip the data and the CRC of any other chunk
+            if (!read_bytes(decoder, NULL, length + 4)) {
+                return false;
+            }
+        }
+    }
+
+    static uint32_t next_byte_slow(Decoder& decoder) {
+        while (decoder.chunk_remaining == 0) {
+            if (decoder.end_of_data) {
+                return 0;
+            }
+
+            // The CRC of the chunk which has ended
+            if (!read_bytes(decoder, NULL, 4) || !next_data_chunk(decoder)) {
+                decoder.end_of_data = true;
+                return 0;
+            }
+        }
+
+        if (decoder.position == decoder.end && !fill(decoder)) {
+            decoder.end_of_data = true;
+            return 0;
+        }
+
+        decoder.chunk_remaining--;
+
+        return *decoder.position++;
+    }
+
+    /**
+     * @return The next byte of the zlib stream, which is split over the IDAT
+     * chunks, or 0 after it.
+     */
+    static inline uint32_t next_byte(Decoder& decoder) {
+        if (decoder.chunk_remaining > 0 && decoder.position < decoder.end) {
+            decoder.chunk_remaining--;
+            return *decoder.position++;
+        }
+
+        return next_byte_slow(decoder);
+    }
+
+    // ----------------------------- Bits ---------------------------------
+
+    static inline void refill(Decoder& decoder) {
+        while (decoder.bit_count <= 56) {
+            decoder.bits |= (uint64_t)next_byte(decoder) << decoder.bit_count;
+            decoder.bit_count += 8;
+        }
+    }
+
+    /**
+     * @return The next @p count (at most 32) bits of the stream.
+     */
+    static inline uint32_t bits(Decoder& decoder, const uint32_t count) {
+        if (decoder.bit_count < count) {
+            refill(decoder);
+        }
+
+        const uint32_t value = (uint32_t)(decoder.bits &
+                                          ((1ULL << count) - 1));
+
+        decoder.bits >>= count;
+        decoder.bit_count -= count;
+
+        return value;
+    }
+
+    // ---------------------------- Huffman -------------------------------
+
+    static uint32_t reverse_bits(uint32_t code, const uint32_t length) {
+        uint32_t reversed = 0;
+
+        for (uint32_t i = 0; i < length; i++) {
+            reversed = (reversed << 1) | (code & 1);
+            code >>= 1;
+        }
+
+        return reversed;
+    }
+
+    /**
+     * @brief Builds @p code from the code @p lengths of @p size symbols.
+     *
+     * @return False if the lengths are over-subscribed. Incomplete codes are
+     * accepted, decoding fails if one of the missing codes occurs.
+     */
+    static bool build(Huffman& code, const uint8_t* lengths, const int size) {
+        memset(code.counts, 0, sizeof(code.counts));
+
+        for (int symbol = 0; symbol < size; symbol++) {
+            code.counts[lengths[symbol]]++;
+        }
+
+        int left = 1;
+
+        for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+            left = (left << 1) - code.counts[length];
+
+            if (left < 0) {
+                return false;
+            }
+        }
+
+        uint16_t offsets[MAX_CODE_LENGTH + 1];
+        offsets[1] = 0;
+
+        for (int length = 1; length < MAX_CODE_LENGTH; length++) {
+            offsets[length + 1] = offsets[length] + code.counts[length];
+        }
+
+        for (int symbol = 0; symbol < size; symbol++) {
+            if (lengths[symbol] != 0) {
+                code.symbols[offsets[lengths[symbol]]++] = symbol;
+            }
+        }
+
+        memset(code.fast, 0, sizeof(code.fast));
+
+        // The codes are assigned in the order of the symbols array, and are
+        // stored bit reversed in the stream
+        uint32_t next_code = 0;
+        int index          = 0;
+
+        for (int length = 1; length <= FAST_BITS; length++) {
+            for (int i = 0; i < code.counts[length]; i++) {
+                const uint16_t entry = (uint16_t)((length << 9) |
+                                                  code.symbols[index++]);
+
+                for (uint32_t j = reverse_bits(next_code++, length);
+                     j < (1U << FAST_BITS);
+                     j += 1U << length) {
+                    code.fast[j] = entry;
+                }
+            }
+
+            next_code <<= 1;
+        }
+
+        return true;
+    }
+
+    /**
+     * @return The next symbol, or -1 if the code is not in @p code.
+     */
+    static inline int decode_symbol(Decoder& decoder, const Huffman& code) {
+        if (decoder.bit_count < MAX_CODE_LENGTH) {
+            refill(decoder);
+        }
+
+        const uint16_t entry =
+            code.fast[decoder.bits & ((1U << FAST_BITS) - 1)];
+
+        if (entry != 0) {
+            decoder.bits >>= entry >> 9;
+            decoder.bit_count -= entry >> 9;
+
+            return entry & 0x1FF;
+        }
+
+        uint64_t stream = decoder.bits;
+        int value       = 0;
+        int first       = 0;
+        int index       = 0;
+
+        for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+            value |= (int)(stream & 1);
+            stream >>= 1;
+
+            const int count = code.counts[length];
+
+            if (value - count < first) {
+                decoder.bits >>= length;
+                decoder.bit_count -= length;
+
+                return code.symbols[index + (value - first)];
+            }
+
+            index += count;
+            first = (first + count) << 1;
+            value <<= 1;
+        }
+
+        return -1;
+    }
+
+    static void build_fixed_codes() {
+        uint8_t lengths[MAX_LITERAL_LENGTH_CODES];
+
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 256 - 144);
+        memset(lengths + 256, 7, 280 - 256);
+        memset(lengths + 280, 8, MAX_LITERAL_LENGTH_CODES - 280);
+
+        build(fixed_literal_length_code, lengths, MAX_LITERAL_LENGTH_CODES);
+
+        memset(lengths, 5, MAX_DISTANCE_CODES);
+
+        build(fixed_distance_code, lengths, MAX_DISTANCE_CODES);
+
+        fixed_codes_built = true;
+    }
+
+    // ----------------------------- Output -------------------------------
+
+    static void update_adler(Decoder& decoder,
+                             const uint8_t* data,
+                             uint32_t size) {
+        uint32_t a = decoder.adler_a;
+        uint32_t b = decoder.adler_b;
+
+        while (size > 0) {
+            // The largest number of bytes before b can overflow
+            uint32_t block = size < 5552 ? size : 5552;
+            size -= block;
+
+            while (block-- > 0) {
+                a += *data++;
+                b += a;
+            }
+
+            a %= 65521;
+            b %= 65521;
+        }
+
+        decoder.adler_a = a;
+        decoder.adler_b = b;
+    }
+
+    static inline uint8_t paeth(const int a, const int b, const int c) {
+        const int p  = a + b - c;
+        const int pa = p > a ? p - a : a - p;
+        const int pb = p > b ? p - b : b - p;
+        const int pc = p > c ? p - c : c - p;
+
+        if (pa <= pb && pa <= pc) {
+            return a;
+        }
+
+        return pb <= pc ? b : c;
+    }
+
+    /**
+     * @brief Reverses the @p filter of @p row in place, where @p previous is
+     * the unfiltered row above it or NULL for the first row. A pixel is a
+     * single byte.
+     */
+    static void unfilter(const uint8_t filter,
+                         uint8_t* row,
+                         const uint8_t* previous,
+                         const uint32_t width) {
+
+        switch (filter) {
+            case 1:
+                for (uint32_t i = 1; i < width; i++) {
+                    row[i] += row[i - 1];
+                }
+                break;
+
+            case 2:
+                if (previous != NULL) {
+                    for (uint32_t i = 0; i < width; i++) {
+                        row[i] += previous[i];
+                    }
+                }
+                break;
+
+            case 3:
+                if (previous != NULL) {
+                    row[0] += previous[0] >> 1;
+
+                    for (uint32_t i = 1; i < width; i++) {
+                        row[i] += (row[i - 1] + previous[i]) >> 1;
+                    }
+                } else {
+                    for (uint32_t i = 1; i < width; i++) {
+                        row[i] += row[i - 1] >> 1;
+                    }
+                }
+                break;
+
+            case 4:
+                if (previous != NULL) {
+                    row[0] += previous[0];
+
+                    for (uint32_t i = 1; i < width; i++) {
+                        row[i] += paeth(row[i - 1],
+                                        previous[i],
+                                        previous[i - 1]);
+                    }
+                } else {
+                    for (uint32_t i = 1; i < width; i++) {
+                        row[i] += row[i - 1];
+                    }
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    /**
+     * @brief Places @p size inflated bytes into the rows of the image.
+     *
+     * @return False if there are more bytes than the image holds.
+     */
+    static bool write_rows(Decoder& decoder,
+                           const uint8_t* data,
+                           uint32_t size) {
+
+        while (size > 0) {
+            if (decoder.row == decoder.height) {
+                return false;
+            }
+
+            if (decoder.column == 0) {
+                decoder.filter = *data++;
+                decoder.column = 1;
+                size--;
+
+                if (decoder.filter > 4) {
+                    return false;
+                }
+
+                continue;
+            }
+
+            uint8_t* row = decoder.data + decoder.row * decoder.width;
+
+            uint32_t count = decoder.width + 1 - decoder.column;
+            count          = count < size ? count : size;
+
+            memcpy(row + decoder.column - 1, data, count);
+
+            data += count;
+            size -= count;
+            decoder.column += count;
+
+            if (decoder.column == decoder.width + 1) {
+                unfilter(decoder.filter,
+                         row,
+                         decoder.row > 0 ? row - decoder.width : NULL,
+                         decoder.width);
+
+                decoder.row++;
+                decoder.column = 0;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Writes the bytes inflated since the last flush to the image.
+     */
+    static bool flush(Decoder& decoder) {
+        while (decoder.flushed != decoder.window_position) {
+            const uint32_t start = decoder.flushed & WINDOW_MASK;
+
+            uint32_t size = decoder.window_position - decoder.flushed;
+            size = start + size > WINDOW_SIZE ? WINDOW_SIZE - start : size;
+
+            update_adler(decoder, &window[start], size);
+
+            if (!write_rows(decoder, &window[start], size)) {
+                return false;
+            }
+
+            decoder.flushed += size;
+        }
+
+        return true;
+    }
+
+    static inline bool should_flush(const Decoder& decoder) {
+        return decoder.window_position - decoder.flushed >= FLUSH_THRESHOLD;
+    }
+
+    // ----------------------------- Inflate ------------------------------
+
+    static bool inflate_stored(Decoder& decoder) {
+        // Skip to the byte boundary
+        bits(decoder, decoder.bit_count & 7);
+
+        const uint32_t length = bits(decoder, 16);
+
+        if (length != (~bits(decoder, 16) & 0xFFFF)) {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < length; i++) {
+            window[decoder.window_position++ & WINDOW_MASK] = bits(decoder, 8);
+
+            if (should_flush(decoder) && !flush(decoder)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static bool inflate_codes(Decoder& decoder,
+                              const Huffman& literal_lengths,
+                              const Huffman& distances) {
+        while (true) {
+            int symbol = decode_symbol(decoder, literal_lengths);
+
+            if (symbol < 0) {
+                return false;
+            }
+
+            if (symbol < 256) {
+                window[decoder.window_position++ & WINDOW_MASK] = symbol;
+            } else if (symbol == 256) {
+                return true;
+            } else {
+                symbol -= 257;
+
+                if (symbol >= 29) {
+                    return false;
+                }
+
+                const uint32_t length = length_base[symbol] +
+                                        bits(decoder, length_extra[symbol]);
+
+                symbol = decode_symbol(decoder, distances);
+
+                if (symbol < 0 || symbol >= MAX_DISTANCE_CODES) {
+                    return false;
+                }
+
+                const uint32_t distance = distance_base[symbol] +
+                                          bits(decoder,
+                                               distance_extra[symbol]);
+
+                if (distance > decoder.window_position) {
+                    return false;
+                }
+
+                uint32_t position = decoder.window_position;
+
+                for (uint32_t i = 0; i < length; i++, position++) {
+                    window[position & WINDOW_MASK] =
+                        window[(position - distance) & WINDOW_MASK];
+                }
+
+                decoder.window_position = position;
+            }
+
+            if (should_flush(decoder) && !flush(decoder)) {
+                return false;
+            }
+        }
+    }
+
+    static bool inflate_dynamic(Decoder& decoder) {
+        static const uint8_t order[19] = {
+            16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+        const uint32_t literal_length_count = bits(decoder, 5) + 257;
+        const uint32_t distance_count       = bits(decoder, 5) + 1;
+        const uint32_t code_length_count    = bits(decoder, 4) + 4;
+
+        if (literal_length_count > 286 ||
+            distance_count > MAX_DISTANCE_CODES) {
+            return false;
+        }
+
+        uint8_t lengths[MAX_LITERAL_LENGTH_CODES + MAX_DISTANCE_CODES];
+
+        memset(lengths, 0, 19);
+
+        for (uint32_t i = 0; i < code_length_count; i++) {
+            lengths[order[i]] = bits(decoder, 3);
+        }
+
+        if (!build(code_length_code, lengths, 19)) {
+            return false;
+        }
+
+        const uint32_t count = literal_length_count + distance_count;
+        uint32_t index       = 0;
+
+        while (index < count) {
+            int symbol = decode_symbol(decoder, code_length_code);
+
+            if (symbol < 0) {
+                return false;
+            }
+
+            if (symbol < 16) {
+                lengths[index++] = symbol;
+                continue;
+            }
+
+            uint8_t length  = 0;
+            uint32_t repeat = 0;
+
+            if (symbol == 16) {
+                if (index == 0) {
+                    return false;
+                }
+
+                length = lengths[index - 1];
+                repeat = 3 + bits(decoder, 2);
+            } else if (symbol == 17) {
+                repeat = 3 + bits(decoder, 3);
+            } else {
+                repeat = 11 + bits(decoder, 7);
+            }
+
+            if (index + repeat > count) {
+                return false;
+            }
+
+            memset(&lengths[index], length, repeat);
+            index += repeat;
+        }
+
+        // Without the end of block code, the block could not end
+        if (lengths[256] == 0) {
+            return false;
+        }
+
+        if (!build(literal_length_code, lengths, literal_length_count) ||
+            !build(distance_code,
+                   lengths + literal_length_count,
+                   distance_count)) {
+            return false;
+        }
+
+        return inflate_codes(decoder, literal_length_code, distance_code);
+    }
+
+    /**
+     * @brief Inflates the zlib stream in the IDAT chunks into the image.
+     */
+    static bool inflate(Decoder& decoder) {
+        const uint32_t cmf = bits(decoder, 8);
+        const uint32_t flg = bits(decoder, 8);
+
+        // Deflate with a window of at most 32 KB and without a preset
+        // dictionary
+        if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 ||
+            ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20) != 0) {
+            return false;
+        }
+
+        if (!fixed_codes_built) {
+            build_fixed_codes();
+        }
+
+        bool last = false;
+
+        while (!last) {
+            last = bits(decoder, 1) != 0;
+
+            bool success = false;
+
+            switch (bits(decoder, 2)) {
+                case 0:
+                    success = inflate_stored(decoder);
+                    break;
+
+                case 1:
+                    success = inflate_codes(decoder,
+                                            fixed_literal_length_code,
+                                            fixed_distance_code);
+                    break;
+
+                case 2:
+                    success = inflate_dynamic(decoder);
+                    break;
+
+                default:
+                    break;
+            }
+
+            if (!success) {
+                return false;
+            }
+        }
+
+        if (!flush(decoder)) {
+            return false;
+        }
+
+        bits(decoder, decoder.bit_count & 7);
+
+        uint32_t adler = 0;
+
+        for (int i = 0; i < 4; i++) {
+            adler = (adler << 8) | bits(decoder, 8);
+        }
+
+        return adler == ((decoder.adler_b << 16) | decoder.adler_a);
+    }
+
+    Status decode(ReadCallback read,
+                  void* context,
+                  uint8_t* out_data,
+                  const size_t capacity,
+                  uint32_t* out_width,
+                  uint32_t* out_height) {
+
+        static const uint8_t signature[8] = {
+            0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+        Decoder decoder;
+        memset(&decoder, 0, sizeof(decoder));
+
+        decoder.read     = read;
+        decoder.context  = context;
+        decoder.position = file_buffer;
+        decoder.end      = file_buffer;
+        decoder.data     = out_data;
+        decoder.adler_a  = 1;
+
+        // Signature, followed by the IHDR chunk and its CRC
+        uint8_t header[8 + 8 + 13 + 4];
+
+        if (!read_bytes(decoder, header, sizeof(header))) {
+            return decoder.read_failed ? STATUS_READ_FAILED : STATUS_MALFORMED;
+        }
+
+        const uint8_t* ihdr = header + 16;
+
+        if (memcmp(header, signature, sizeof(signature)) != 0 ||
+            big_endian(header + 8) != 13 ||
+            big_endian(header + 12) != CHUNK_TYPE('I', 'H', 'D', 'R')) {
+            return STATUS_MALFORMED;
+        }
+
+        decoder.width  = big_endian(ihdr);
+        decoder.height = big_endian(ihdr + 4);
+
+        const uint8_t bit_depth   = ihdr[8];
+        const uint8_t colour_type = ihdr[9];
+
+        // Compression and filter method, which only have one value each
+        if (decoder.width == 0 || decoder.height == 0 || ihdr[10] != 0 ||
+            ihdr[11] != 0) {
+            return STATUS_MALFORMED;
+        }
+
+        *out_width  = decoder.width;
+        *out_height = decoder.height;
+
+        if (bit_depth != 8 || colour_type != 0 || ihdr[12] != 0) {
+            return STATUS_UNSUPPORTED;
+        }
+
+        if ((uint64_t)decoder.width * decoder.height > capacity) {
+            return STATUS_TOO_LARGE;
+        }
+
+        const bool success = next_data_chunk(decoder) && inflate(decoder) &&
+                             decoder.row == decoder.height;
+
+        if (decoder.read_failed) {
+            return STATUS_READ_FAILED;
+        }
+
+        return success ? STATUS_OK : STATUS_MALFORMED;
+    }
+}
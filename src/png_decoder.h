@@ -0,0 +1,72 @@
+#ifndef PNG_DECODER_H_
+#define PNG_DECODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Streaming decoder for 8 bit grayscale, non-interlaced PNGs, which are
+ * what the datasets consist of.
+ *
+ * Unlike lodepng_decode_memory, which needs the whole file in memory and
+ * allocates the decoded image, the file is read through a fixed-size buffer
+ * and the image is inflated into a 32 KB window, from which every row is
+ * unfiltered straight into the caller's buffer. All buffers are static, so
+ * nothing is allocated per image, and the decoder is not reentrant.
+ *
+ * The CRCs of the chunks are not checked, the Adler-32 checksum of the image
+ * data is.
+ */
+namespace png_decoder {
+
+    enum Status {
+        STATUS_OK = 0,
+
+        /**
+         * @brief The read callback failed.
+         */
+        STATUS_READ_FAILED,
+
+        /**
+         * @brief Not a valid PNG.
+         */
+        STATUS_MALFORMED,
+
+        /**
+         * @brief A valid PNG which is not 8 bit grayscale or is interlaced,
+         * which has to be decoded with LodePNG instead.
+         */
+        STATUS_UNSUPPORTED,
+
+        /**
+         * @brief The image does not fit in the output buffer.
+         */
+        STATUS_TOO_LARGE
+    };
+
+    /**
+     * @brief Reads up to @p size bytes of the file into @p buffer.
+     *
+     * @param out_read The number of bytes read, less than @p size only at the
+     * end of the file.
+     *
+     * @return False on a read error.
+     */
+    typedef bool (*ReadCallback)(void* context,
+                                 uint8_t* buffer,
+                                 const uint32_t size,
+                                 uint32_t* out_read);
+
+    /**
+     * @brief Decodes the PNG read with @p read into @p out_data, which holds
+     * @p capacity bytes.
+     */
+    Status decode(ReadCallback read,
+                  void* context,
+                  uint8_t* out_data,
+                  const size_t capacity,
+                  uint32_t* out_width,
+                  uint32_t* out_height);
+}
+
+#endif
@@ -4,22 +4,13 @@
 #include "feature_extraction.h"
 #include "file_system.h"
 #include "logger.h"
+#include "trace.h"
+
+#include "board.h"
 
 #include <stdlib.h>
 #include <string.h>
 
-static void profile_start() {
-    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
-    DWT->CTRL &= ~DWT_CTRL_CYCCNTENA_Msk;
-    DWT->CYCCNT = 0UL;
-    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
-}
-
-static uint32_t profile_end() {
-    DWT->CTRL &= ~DWT_CTRL_CYCCNTENA_Msk;
-    return DWT->CYCCNT;
-}
-
 namespace test {
     namespace fast {
         void test_with_dataset(uint8_t* image_data_buffer,
@@ -81,43 +72,34 @@ namespace test {
                 // The reason this is not profiled is due to in a real pipeline
                 // where the image is retrieved from the camera, the camera
                 // driver would write directly to the staticly allocated
-                // image_data buffer. In order to not have to modify LodePNG too
-                // much (it uses the heap), this is kept in this way where the
-                // data is copied over and then freed
-                {
-                    image::Image image_heap;
-
-                    if (!dataset_loader::retrieve_image(image_heap)) {
-                        logger::errorf("Failed to rerieve image\r\n");
-
-                        *line_ptr++ = '\0';
-                        data_ptr    = line_ptr;
-                        line_ptr    = strchr(data_ptr, '\n');
-
-                        continue;
-                    }
+                // image_data buffer
+                image.data = image_data_buffer;
 
-                    image.data   = image_data_buffer;
-                    image.width  = image_heap.width;
-                    image.height = image_heap.height;
+                if (!dataset_loader::retrieve_image_into(image,
+                                                         MAX_IMAGE_SIZE)) {
+                    logger::errorf("Failed to rerieve image\r\n");
 
-                    memcpy(image.data,
-                           image_heap.data,
-                           image.width * image.height);
+                    *line_ptr++ = '\0';
+                    data_ptr    = line_ptr;
+                    line_ptr    = strchr(data_ptr, '\n');
 
-                    free(image_heap.data);
+                    continue;
                 }
 
                 uint32_t keypoints_size = keypoints_buffer_size;
 
-                profile_start();
+                trace::begin_frame(iterations);
+
+                const uint32_t start = trace::now();
                 frontend::extract_features(image.data,
                                            image.width,
                                            image.height,
                                            100,
                                            keypoints_buffer,
                                            &keypoints_size);
-                uint32_t cycles = profile_end();
+                uint32_t cycles = trace::now() - start;
+
+                trace::end_frame();
 
                 total_features_extracted += keypoints_size;
 
@@ -234,24 +216,12 @@ namespace test {
 
             while (true) {
                 image::Image image;
+                image.data = image_data_buffer;
 
-                {
-                    image::Image image_heap;
-
-                    if (!dataset_loader::retrieve_image(image_heap)) {
-                        logger::errorf("Failed to rerieve image\r\n");
-                        break;
-                    }
-
-                    image.data   = image_data_buffer;
-                    image.width  = image_heap.width;
-                    image.height = image_heap.height;
-
-                    memcpy(image.data,
-                           image_heap.data,
-                           image.width * image.height);
-
-                    free(image_heap.data);
+                if (!dataset_loader::retrieve_image_into(image,
+                                                         MAX_IMAGE_SIZE)) {
+                    logger::errorf("Failed to rerieve image\r\n");
+                    break;
                 }
 
                 uint32_t keypoints_size = keypoints_buffer_size;
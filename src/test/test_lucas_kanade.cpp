@@ -4,8 +4,13 @@
 #include "feature_extraction.h"
 #include "feature_tracking.h"
 #include "file_system.h"
+#include "log_record.h"
 #include "logger.h"
+#include "trace.h"
 
+#include "board.h"
+
+#include <math.h>
 #include <stdlib.h>
 
 #define MAX_AMOUNT_OF_REFERENCE_POINTS (800)
@@ -36,18 +41,6 @@ static void populate_buffer_from_data_entry(char* data,
     *entries = entry_index;
 }
 
-static void profile_start() {
-    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
-    DWT->CTRL &= ~DWT_CTRL_CYCCNTENA_Msk;
-    DWT->CYCCNT = 0UL;
-    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
-}
-
-static uint32_t profile_end() {
-    DWT->CTRL &= ~DWT_CTRL_CYCCNTENA_Msk;
-    return DWT->CYCCNT;
-}
-
 namespace test {
     namespace lucas_kanade {
         void test_with_dataset(uint8_t* image_data_buffer,
@@ -121,6 +114,8 @@ namespace test {
 
                 logger::rawf("\r\n");
 
+                trace::begin_frame(index);
+
                 uint32_t cycles = 0;
 
                 // First retrieve the start points
@@ -198,11 +193,11 @@ namespace test {
                         keypoints_size = keypoints_buffer_size;
                     }
 
-                    profile_start();
+                    const uint32_t start = trace::now();
                     patch_pyramid->construct(image_pyramid,
                                              keypoints_buffer,
                                              keypoints_size);
-                    cycles += profile_end();
+                    cycles += trace::now() - start;
                 }
 
                 // Now we can load the second image
@@ -269,7 +264,7 @@ namespace test {
 
                 // The image pyramid creation is in this instance is profiled
                 // since we're working on the "current" image
-                profile_start();
+                const uint32_t start = trace::now();
                 image::ImagePyramid image_pyramid(image, image_pyramid_buffer);
 
                 frontend::track_features(*patch_pyramid,
@@ -278,7 +273,9 @@ namespace test {
                                          end_keypoints_buffer,
                                          keypoints_size);
 
-                cycles += profile_end();
+                cycles += trace::now() - start;
+
+                trace::end_frame();
 
                 if (index % 10 == 0) {
 
@@ -297,7 +294,7 @@ namespace test {
                                    "[%3.0f, "
                                    "%3.0f] "
                                    "-> [%3.0f, %3.0f]\r\n",
-                                   i,
+                                   (unsigned int)i,
                                    round(reference_start_point[0]),
                                    round(reference_start_point[1]),
                                    round(end_point.point.x),
@@ -312,7 +309,7 @@ namespace test {
                                    "[%3.0f, "
                                    "%3.0f] "
                                    "-> [%3.0f, %3.0f]\r\n",
-                                   i,
+                                   (unsigned int)i,
                                    round(reference_start_point[0]),
                                    round(reference_start_point[1]),
                                    round(end_point.point.x),
@@ -431,10 +428,72 @@ namespace test {
             dataset_loader::deinitialise();
         }
 
+        /**
+         * @brief Tracks the keypoints into @p image, re-detects them with FAST
+         * when too few are left and constructs the patches for the next frame.
+         * Logs the keypoints of every frame.
+         */
+        static void process_frame(image::Image& image,
+                                  image::ImagePyramid& image_pyramid,
+                                  image::PatchPyramid* patch_pyramid,
+                                  const frontend::FastDetector* fast_detector,
+                                  image::KeyPoint* keypoints_buffer,
+                                  image::KeyPoint* end_keypoints_buffer,
+                                  const size_t keypoints_buffer_size,
+                                  const size_t index,
+                                  uint32_t* keypoints_size,
+                                  size_t* stale_features) {
+
+            if (*keypoints_size > 0) {
+                frontend::track_features(*patch_pyramid,
+                                         image_pyramid,
+                                         keypoints_buffer,
+                                         end_keypoints_buffer,
+                                         *keypoints_size);
+
+                *stale_features = 0;
+                for (size_t i = 0; i < *keypoints_size; i++) {
+                    if (end_keypoints_buffer[i].stale) {
+                        (*stale_features)++;
+                    }
+                }
+
+                if (((int)*keypoints_size - (int)*stale_features) >= 5) {
+                    log_record::write_keypoints(log_record::TYPE_TRACKS,
+                                                index,
+                                                end_keypoints_buffer,
+                                                *keypoints_size);
+                }
+
+                memcpy(keypoints_buffer,
+                       end_keypoints_buffer,
+                       sizeof(image::KeyPoint) * *keypoints_size);
+            }
+
+            // if (keypoints_size == 0) {
+            if (((int)*keypoints_size - (int)*stale_features) < 5) {
+                *keypoints_size = keypoints_buffer_size;
+
+                fast_detector->detect(image, keypoints_buffer, keypoints_size);
+
+                *stale_features = 0;
+
+                log_record::write_keypoints(log_record::TYPE_KEYPOINTS,
+                                            index,
+                                            keypoints_buffer,
+                                            *keypoints_size);
+            }
+
+            patch_pyramid->construct(image_pyramid,
+                                     keypoints_buffer,
+                                     *keypoints_size);
+        }
+
         void test_with_dataset_without_references_with_resample(
-            uint8_t* image_data_buffer,
+            uint8_t* const image_data_buffers[PREFETCH_BUFFERS],
             uint8_t* image_pyramid_buffer,
             image::PatchPyramid* patch_pyramid,
+            const frontend::FastDetector* fast_detector,
             image::KeyPoint* keypoints_buffer,
             image::KeyPoint* end_keypoints_buffer,
             const size_t keypoints_buffer_size,
@@ -447,6 +506,13 @@ namespace test {
 
             dataset_loader::initialise(dataset_path);
 
+            // MAX_IMAGE_SIZE is a multiple of the sector size, so frames of
+            // a container are read in the background
+            frame_prefetcher::start(image_data_buffers,
+                                    MAX_IMAGE_SIZE,
+                                    start_index,
+                                    end_index);
+
             size_t index = start_index;
 
             uint32_t keypoints_size = 0;
@@ -461,114 +527,242 @@ namespace test {
                 }
                 */
 
-                image::Image image;
+                trace::begin_frame(index);
 
-                {
-                    image::Image image_heap;
+                // The frames come in order, so this is the frame at index
+                const frame_prefetcher::Frame* frame = NULL;
 
-                    if (!dataset_loader::retrieve_image(image_heap, index)) {
-                        logger::errorf("Failed to rerieve image\r\n");
-                        index++;
-                        continue;
-                    }
+                {
+                    TRACE_ZONE(ZONE_LOAD);
 
-                    image.data   = image_data_buffer;
-                    image.width  = image_heap.width;
-                    image.height = image_heap.height;
+                    frame = frame_prefetcher::acquire();
+                }
 
-                    memcpy(image.data,
-                           image_heap.data,
-                           image.width * image.height);
+                if (frame == NULL) {
+                    break;
+                }
 
-                    free(image_heap.data);
+                if (!frame->valid) {
+                    logger::errorf("Failed to rerieve image\r\n");
+                    frame_prefetcher::release();
+                    index++;
+                    continue;
                 }
 
+                image::Image image = frame->image;
+
                 image::ImagePyramid image_pyramid(image, image_pyramid_buffer);
 
-                if (keypoints_size > 0) {
-                    frontend::track_features(*patch_pyramid,
-                                             image_pyramid,
-                                             keypoints_buffer,
-                                             end_keypoints_buffer,
-                                             keypoints_size);
+                process_frame(image,
+                              image_pyramid,
+                              patch_pyramid,
+                              fast_detector,
+                              keypoints_buffer,
+                              end_keypoints_buffer,
+                              keypoints_buffer_size,
+                              index,
+                              &keypoints_size,
+                              &stale_features);
 
-                    stale_features = 0;
-                    for (size_t i = 0; i < keypoints_size; i++) {
-                        if (end_keypoints_buffer[i].stale) {
-                            stale_features++;
-                        }
-                    }
+                trace::end_frame();
 
-                    if (((int)keypoints_size - (int)stale_features) >= 5) {
-
-                        logger::rawf("%lu: ", index);
-                        for (size_t i = 0; i < keypoints_size; i++) {
-
-                            if (i == keypoints_size - 1) {
-                                logger::rawf(
-                                    "%d, %d, %d",
-                                    (int)round(end_keypoints_buffer[i].point.x),
-                                    (int)round(end_keypoints_buffer[i].point.y),
-                                    end_keypoints_buffer[i].stale ? 1 : 0);
-                            } else {
-                                logger::rawf(
-                                    "%d, %d, %d, ",
-                                    (int)round(end_keypoints_buffer[i].point.x),
-                                    (int)round(end_keypoints_buffer[i].point.y),
-                                    end_keypoints_buffer[i].stale ? 1 : 0);
-                            }
-                        }
-                        logger::rawf("\r\n");
-                    }
+                frame_prefetcher::release();
+
+                index++;
+            }
+
+            frame_prefetcher::stop();
+
+            dataset_loader::deinitialise();
+        }
+
+        void test_with_pipeline(pipeline::Exchange* exchange,
+                                image::PatchPyramid* patch_pyramid,
+                                const frontend::FastDetector* fast_detector,
+                                image::KeyPoint* keypoints_buffer,
+                                image::KeyPoint* end_keypoints_buffer,
+                                const size_t keypoints_buffer_size) {
+
+            uint32_t keypoints_size = 0;
 
-                    memcpy(keypoints_buffer,
-                           end_keypoints_buffer,
-                           sizeof(image::KeyPoint) * keypoints_size);
+            size_t stale_features = 0;
+
+            while (true) {
+
+                pipeline::Frame* frame = pipeline::wait_filled(*exchange);
+
+                if (frame->index < 0) {
+                    pipeline::release(*exchange);
+                    break;
                 }
 
-                // if (keypoints_size == 0) {
-                if (((int)keypoints_size - (int)stale_features) < 5) {
-                    keypoints_size = keypoints_buffer_size;
+                if (!frame->valid) {
+                    logger::errorf("Failed to rerieve image\r\n");
+                    pipeline::release(*exchange);
+                    continue;
+                }
 
-                    frontend::extract_features(image.data,
-                                               image.width,
-                                               image.height,
-                                               70,
-                                               keypoints_buffer,
-                                               &keypoints_size);
+                trace::begin_frame(frame->index);
 
-                    stale_features = 0;
+                process_frame(frame->image,
+                              frame->image_pyramid,
+                              patch_pyramid,
+                              fast_detector,
+                              keypoints_buffer,
+                              end_keypoints_buffer,
+                              keypoints_buffer_size,
+                              frame->index,
+                              &keypoints_size,
+                              &stale_features);
 
-                    logger::rawf("%lu: ", index);
+                trace::end_frame();
 
-                    for (size_t i = 0; i < keypoints_size; i++) {
+                // The patches are copied out of the pyramid, so the frame can
+                // be handed back to the producer
+                pipeline::release(*exchange);
+            }
+        }
 
-                        if (i == keypoints_size - 1) {
-                            logger::rawf(
-                                "%d, %d, %d",
-                                (int)round(keypoints_buffer[i].point.x),
-                                (int)round(keypoints_buffer[i].point.y),
-                                keypoints_buffer[i].stale ? 1 : 0);
-                        } else {
-                            logger::rawf(
-                                "%d, %d, %d, ",
-                                (int)round(keypoints_buffer[i].point.x),
-                                (int)round(keypoints_buffer[i].point.y),
-                                keypoints_buffer[i].stale ? 1 : 0);
-                        }
-                    }
+        /**
+         * @brief Checks that the forward-backward check of every keypoint of
+         * @p previous_keypoints, tracked back from @p next_image_pyramid into
+         * @p previous_image_pyramid, rejects it if and only if
+         * @p expect_stale, and that the rejected tracks are stale.
+         */
+        template <typename PatchPyramid>
+        static bool
+        check_backward_tracks(const char* tracker_name,
+                              PatchPyramid* patch_pyramid,
+                              image::ImagePyramid& previous_image_pyramid,
+                              image::ImagePyramid& next_image_pyramid,
+                              const image::KeyPoint* previous_keypoints,
+                              const size_t keypoints_size,
+                              const bool expect_stale) {
+
+            image::KeyPoint next_keypoints[keypoints_size];
+            image::KeyPoint backward_keypoints[keypoints_size];
+
+            memcpy(next_keypoints,
+                   previous_keypoints,
+                   sizeof(image::KeyPoint) * keypoints_size);
+
+            patch_pyramid->construct(next_image_pyramid,
+                                     next_keypoints,
+                                     keypoints_size);
+
+            frontend::check_forward_backward(*patch_pyramid,
+                                             previous_image_pyramid,
+                                             previous_keypoints,
+                                             next_keypoints,
+                                             backward_keypoints,
+                                             keypoints_size,
+                                             1.0f);
+
+            bool passed = true;
+
+            for (size_t i = 0; i < keypoints_size; i++) {
+                if (next_keypoints[i].stale != expect_stale) {
+                    logger::errorf("%s tracker: keypoint at (%.1f, %.1f) is "
+                                   "%s after the forward-backward check\r\n",
+                                   tracker_name,
+                                   previous_keypoints[i].point.x,
+                                   previous_keypoints[i].point.y,
+                                   next_keypoints[i].stale ? "stale"
+                                                           : "not stale");
+                    passed = false;
+                }
 
-                    logger::rawf("\r\n");
+                // A diverged track has to be lost by the tracker itself, not
+                // only through a large error
+                if (expect_stale && !backward_keypoints[i].stale) {
+                    logger::errorf("%s tracker: track back from (%.1f, %.1f) "
+                                   "is not stale\r\n",
+                                   tracker_name,
+                                   previous_keypoints[i].point.x,
+                                   previous_keypoints[i].point.y);
+                    passed = false;
                 }
+            }
 
-                patch_pyramid->construct(image_pyramid,
-                                         keypoints_buffer,
-                                         keypoints_size);
+            return passed;
+        }
 
-                index++;
+        bool test_forward_backward_with_divergent_track(
+            uint8_t* const image_data_buffers[2],
+            uint8_t* const image_pyramid_buffers[2],
+            image::PatchPyramid* patch_pyramid,
+            image::FixedPointPatchPyramid* fixed_point_patch_pyramid) {
+
+            const size_t width  = DIVERGENT_TRACK_IMAGE_WIDTH;
+            const size_t height = DIVERGENT_TRACK_IMAGE_HEIGHT;
+
+            // A texture on a horizontal ramp. The next image is 100 levels
+            // brighter, which the ramp explains by a flow beyond the right
+            // edge of the previous image, so the backward track diverges
+            for (size_t y = 0; y < height; y++) {
+                for (size_t x = 0; x < width; x++) {
+
+                    const float intensity = 60 + 0.3f * x +
+                                            20 * sinf(0.4f * x) *
+                                                cosf(0.3f * y);
+
+                    image_data_buffers[0][y * width + x] = (uint8_t)intensity;
+                    image_data_buffers[1][y * width + x] =
+                        (uint8_t)fminf(intensity + 100, 255);
+                }
             }
 
-            dataset_loader::deinitialise();
+            image::Image previous_image(image_data_buffers[0], width, height);
+            image::Image next_image(image_data_buffers[1], width, height);
+
+            image::ImagePyramid previous_image_pyramid(
+                previous_image,
+                image_pyramid_buffers[0]);
+            image::ImagePyramid next_image_pyramid(next_image,
+                                                   image_pyramid_buffers[1]);
+
+            const image::KeyPoint keypoints[] = {image::KeyPoint(64, 96),
+                                                 image::KeyPoint(128, 96),
+                                                 image::KeyPoint(100, 50)};
+
+            const size_t keypoints_size = sizeof(keypoints) /
+                                          sizeof(keypoints[0]);
+
+            bool passed = true;
+
+            // Tracked back into the image itself as a control, where every
+            // keypoint has to pass the check
+            passed &= check_backward_tracks("Float",
+                                            patch_pyramid,
+                                            previous_image_pyramid,
+                                            previous_image_pyramid,
+                                            keypoints,
+                                            keypoints_size,
+                                            false);
+            passed &= check_backward_tracks("Fixed-point",
+                                            fixed_point_patch_pyramid,
+                                            previous_image_pyramid,
+                                            previous_image_pyramid,
+                                            keypoints,
+                                            keypoints_size,
+                                            false);
+
+            passed &= check_backward_tracks("Float",
+                                            patch_pyramid,
+                                            previous_image_pyramid,
+                                            next_image_pyramid,
+                                            keypoints,
+                                            keypoints_size,
+                                            true);
+            passed &= check_backward_tracks("Fixed-point",
+                                            fixed_point_patch_pyramid,
+                                            previous_image_pyramid,
+                                            next_image_pyramid,
+                                            keypoints,
+                                            keypoints_size,
+                                            true);
+
+            return passed;
         }
     }
 }
@@ -1,7 +1,22 @@
 #ifndef TEST_lUCAS_KANADE
 #define TEST_lUCAS_KANADE
 
+#include "feature_extraction.h"
+#include "frame_prefetcher.h"
 #include "image.h"
+#include "pipeline.h"
+
+/**
+ * @brief FAST threshold of the re-detections in the tests with resampling.
+ */
+#define RESAMPLE_FAST_THRESHOLD (70)
+
+/**
+ * @brief Size of the synthetic images of
+ * test_forward_backward_with_divergent_track.
+ */
+#define DIVERGENT_TRACK_IMAGE_WIDTH  (256)
+#define DIVERGENT_TRACK_IMAGE_HEIGHT (192)
 
 namespace test {
     namespace lucas_kanade {
@@ -14,10 +29,17 @@ namespace test {
                                const size_t keypoints_buffer_size,
                                const char* dataset_name);
 
+        /**
+         * @brief Tracks the frames in [@p start_index, @p end_index] of the
+         * dataset, re-detecting features with @p fast_detector when too few
+         * are left. The frames are read into @p image_data_buffers by the
+         * frame_prefetcher, the next one while the current one is processed.
+         */
         void test_with_dataset_without_references_with_resample(
-            uint8_t* image_data_buffer,
+            uint8_t* const image_data_buffers[PREFETCH_BUFFERS],
             uint8_t* image_pyramid_buffer,
             image::PatchPyramid* patch_pyramid,
+            const frontend::FastDetector* fast_detector,
             image::KeyPoint* keypoints_buffer,
             image::KeyPoint* end_keypoints_buffer,
             const size_t keypoints_buffer_size,
@@ -25,6 +47,37 @@ namespace test {
             const size_t start_index,
             const size_t end_index);
 
+        /**
+         * @brief Same as test_with_dataset_without_references_with_resample,
+         * but the frames are loaded and their image pyramids built by the
+         * producer of the pipeline (CORE1 on the target) through
+         * @p exchange, until the end of the stream.
+         */
+        void test_with_pipeline(pipeline::Exchange* exchange,
+                                image::PatchPyramid* patch_pyramid,
+                                const frontend::FastDetector* fast_detector,
+                                image::KeyPoint* keypoints_buffer,
+                                image::KeyPoint* end_keypoints_buffer,
+                                const size_t keypoints_buffer_size);
+
+        /**
+         * @brief Builds a synthetic pair of images in @p image_data_buffers
+         * where the track back from the second image into the first
+         * diverges, and checks that check_forward_backward rejects it with
+         * both trackers, while a keypoint tracked back into its own image
+         * passes. The buffers hold DIVERGENT_TRACK_IMAGE_WIDTH by
+         * DIVERGENT_TRACK_IMAGE_HEIGHT pixels, and the lower levels of the
+         * pyramids of each image are placed in @p image_pyramid_buffers.
+         *
+         * @return False, after logging the keypoints which fail, if the check
+         * does not hold.
+         */
+        bool test_forward_backward_with_divergent_track(
+            uint8_t* const image_data_buffers[2],
+            uint8_t* const image_pyramid_buffers[2],
+            image::PatchPyramid* patch_pyramid,
+            image::FixedPointPatchPyramid* fixed_point_patch_pyramid);
+
     }
 
 }
@@ -0,0 +1,256 @@
+#include "trace.h"
+
+#include "log_record.h"
+#include "logger.h"
+
+#include <string.h>
+
+#include "board.h"
+
+#ifdef CPU_MIMXRT1166DVM6A
+    #include "fsl_device_registers.h"
+
+    // The cores run at different clocks
+    #define TRACE_FREQUENCY (SystemCoreClock)
+#else
+    #include <atomic>
+    #include <chrono>
+
+    #define TRACE_FREQUENCY (BOARD_BOOTCLOCKRUN_CORE_CLOCK)
+#endif
+
+/**
+ * @brief On the host, every thread has its own trace, as every core does on
+ * the target.
+ */
+#ifdef CPU_MIMXRT1166DVM6A
+    #define TRACE_LOCAL
+#else
+    #define TRACE_LOCAL thread_local
+#endif
+
+namespace trace {
+
+    /**
+     * @brief The trace of the current frame.
+     */
+    struct State {
+        bool enabled;
+
+        /**
+         * @brief Set between begin_frame and end_frame.
+         */
+        bool active;
+
+        uint32_t index;
+        uint32_t start;
+        uint16_t count;
+        uint16_t dropped;
+
+        /**
+         * @brief Number of zones which have begun but not ended, each of
+         * which has a slot reserved for its end.
+         */
+        uint16_t open;
+
+        Event events[TRACE_CAPACITY];
+    };
+
+    static TRACE_LOCAL State state;
+
+    static const char* zone_names[NUMBER_OF_ZONES] = {"load",
+                                                      "pyramid",
+                                                      "extract",
+                                                      "patches",
+                                                      "track",
+                                                      "track level",
+                                                      "lk iteration"};
+
+    /**
+     * @return The number to tell the traces of this core/thread apart.
+     */
+    static uint8_t core() {
+#ifdef CPU_MIMXRT1166DVM6A
+        return __CORTEX_M == 7 ? 0 : 1;
+#else
+        static std::atomic<uint8_t> next_core(0);
+        static thread_local uint8_t core = next_core.fetch_add(1);
+
+        return core;
+#endif
+    }
+
+    const char* zone_name(const uint8_t zone) {
+        return zone < NUMBER_OF_ZONES ? zone_names[zone] : "unknown";
+    }
+
+    SECTION_ITCM uint32_t now() {
+#ifdef CPU_MIMXRT1166DVM6A
+        // Enabled on first use and never reset, so that it can be shared
+        if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0) {
+            CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+            DWT->CYCCNT = 0UL;
+            DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        }
+
+        return DWT->CYCCNT;
+#else
+        // On the host, the "cycles" are nanoseconds (see
+        // BOARD_BOOTCLOCKRUN_CORE_CLOCK)
+        return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+    void set_enabled(const bool enabled) { state.enabled = enabled; }
+
+    void begin_frame(const uint32_t index) {
+        state.index   = index;
+        state.count   = 0;
+        state.dropped = 0;
+        state.open    = 0;
+        state.active  = true;
+        state.start   = now();
+    }
+
+    void end_frame() {
+        state.active = false;
+
+        if (!state.enabled) {
+            return;
+        }
+
+        const size_t payload_size = sizeof(Header) +
+                                    state.count * sizeof(Event);
+        const size_t record_size  = sizeof(log_record::Header) + payload_size;
+
+        uint8_t* record = logger::begin_record(record_size);
+
+        if (record == NULL) {
+            return;
+        }
+
+        const log_record::Header record_header = {LOG_RECORD_MARKER,
+                                                  log_record::TYPE_TRACE,
+                                                  (uint16_t)payload_size};
+        memcpy(record, &record_header, sizeof(record_header));
+        record += sizeof(record_header);
+
+        const Header header = {state.index,
+                               state.start,
+                               (uint32_t)TRACE_FREQUENCY,
+                               state.count,
+                               state.dropped,
+                               core()};
+        memcpy(record, &header, sizeof(header));
+        record += sizeof(header);
+
+        memcpy(record, state.events, state.count * sizeof(Event));
+
+        logger::end_record(record_size);
+    }
+
+    SECTION_ITCM bool begin(const Zone zone) {
+        if (!state.active) {
+            return false;
+        }
+
+        if (state.count + state.open + 2 > TRACE_CAPACITY) {
+            state.dropped += 2;
+            return false;
+        }
+
+        state.events[state.count++] = {now() - state.start, zone};
+        state.open++;
+
+        return true;
+    }
+
+    SECTION_ITCM void end(const Zone zone) {
+        if (!state.active) {
+            return;
+        }
+
+        state.events[state.count++] = {now() - state.start,
+                                       (uint8_t)(zone | TRACE_END)};
+        state.open--;
+    }
+
+    void begin_chrome(ChromeWriter& writer, FILE* output) {
+        memset(&writer, 0, sizeof(writer));
+        writer.output = output;
+
+        fprintf(output, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    }
+
+    bool write_chrome(ChromeWriter& writer,
+                      const uint8_t* data,
+                      const size_t size) {
+
+        Header header;
+
+        if (size < sizeof(Header)) {
+            return false;
+        }
+
+        memcpy(&header, data, sizeof(Header));
+
+        if (size != sizeof(Header) + header.count * sizeof(Event) ||
+            header.frequency == 0) {
+            return false;
+        }
+
+        if (header.dropped > 0) {
+            fprintf(stderr,
+                    "Frame %lu: %u trace events dropped\n",
+                    (unsigned long)header.index,
+                    header.dropped);
+        }
+
+        // The frames of a core are in order, so a start before the last one
+        // means that the counter has wrapped around
+        if (header.start < writer.last_start[header.core]) {
+            writer.offset[header.core] += (uint64_t)1 << 32;
+        }
+
+        writer.last_start[header.core] = header.start;
+
+        const uint64_t start = writer.offset[header.core] + header.start;
+        const uint8_t* events = data + sizeof(Header);
+
+        for (size_t i = 0; i < header.count; i++) {
+            Event event;
+            memcpy(&event, events + i * sizeof(Event), sizeof(Event));
+
+            const bool is_end = (event.zone & TRACE_END) != 0;
+            const double timestamp = (double)(start + event.time) * 1e6 /
+                                     (double)header.frequency;
+
+            fprintf(writer.output,
+                    "%s{\"name\": \"%s\", \"ph\": \"%s\", \"ts\": %.3f, "
+                    "\"pid\": 0, \"tid\": %u",
+                    writer.events > 0 ? ",\n" : "",
+                    zone_name(event.zone & ~TRACE_END),
+                    is_end ? "E" : "B",
+                    timestamp,
+                    header.core);
+
+            if (!is_end) {
+                fprintf(writer.output,
+                        ", \"args\": {\"frame\": %lu}",
+                        (unsigned long)header.index);
+            }
+
+            fprintf(writer.output, "}");
+
+            writer.events++;
+        }
+
+        return true;
+    }
+
+    void end_chrome(ChromeWriter& writer) {
+        fprintf(writer.output, "\n]}\n");
+    }
+}
@@ -0,0 +1,214 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Set to 0 to compile the trace zones out.
+ */
+#ifndef TRACE_ENABLED
+    #define TRACE_ENABLED (1)
+#endif
+
+/**
+ * @brief Number of events in the trace buffer of a frame. An event is the
+ * begin or the end of a zone.
+ */
+#define TRACE_CAPACITY (1024)
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b)  TRACE_CONCAT_(a, b)
+
+/**
+ * @brief Traces the rest of the enclosing scope as @p zone, which is one of
+ * the trace::Zone values without the namespace.
+ */
+#if TRACE_ENABLED
+    #define TRACE_ZONE(zone) \
+        trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(trace::zone)
+#else
+    #define TRACE_ZONE(zone) (void)0
+#endif
+
+/**
+ * @brief Per-frame timing of the stages of the frontend.
+ *
+ * The stages are marked with nestable zones, which record the cycle counter
+ * (nanoseconds on the host) at their begin and end into a preallocated
+ * buffer. The counter is never reset, so that zones can be nested and any
+ * number of them can be taken per frame. The buffer is only written between
+ * begin_frame and end_frame, and end_frame emits it as a binary log record,
+ * which vio_log_decode converts into Chrome trace JSON (which Perfetto opens
+ * as well).
+ *
+ * Every core, and on the host every thread, has its own buffer.
+ */
+namespace trace {
+
+    /**
+     * @brief The zones, named by zone_name. The values are part of the log
+     * format.
+     */
+    enum Zone : uint8_t {
+        ZONE_LOAD = 0,
+        ZONE_PYRAMID,
+        ZONE_EXTRACT,
+        ZONE_PATCHES,
+        ZONE_TRACK,
+        ZONE_TRACK_LEVEL,
+        ZONE_LK_ITERATION,
+        NUMBER_OF_ZONES
+    };
+
+    /**
+     * @brief Payload of a trace record, followed by the events.
+     */
+    struct __attribute__((packed)) Header {
+        uint32_t index;
+
+        /**
+         * @brief Counter at the begin of the frame, which the times of the
+         * events are relative to.
+         */
+        uint32_t start;
+
+        /**
+         * @brief Frequency of the counter in Hz.
+         */
+        uint32_t frequency;
+
+        uint16_t count;
+
+        /**
+         * @brief Events which did not fit in the buffer.
+         */
+        uint16_t dropped;
+
+        /**
+         * @brief Core (thread on the host) the frame was traced on.
+         */
+        uint8_t core;
+    };
+
+    struct __attribute__((packed)) Event {
+        uint32_t time;
+
+        /**
+         * @brief The zone, with TRACE_END set for the end of the zone.
+         */
+        uint8_t zone;
+    };
+
+    /**
+     * @brief Set in Event::zone for the end of a zone.
+     */
+    constexpr uint8_t TRACE_END = 0x80;
+
+    /**
+     * @return The name of @p zone as shown in the trace viewer.
+     */
+    const char* zone_name(const uint8_t zone);
+
+    /**
+     * @return The cycle counter on the target, nanoseconds on the host.
+     */
+    uint32_t now();
+
+    /**
+     * @brief Sets whether end_frame emits the trace of this core/thread.
+     */
+    void set_enabled(const bool enabled);
+
+    /**
+     * @brief Clears the buffer and starts recording the frame at @p index.
+     */
+    void begin_frame(const uint32_t index);
+
+    /**
+     * @brief Stops recording and logs the trace of the frame if enabled.
+     */
+    void end_frame();
+
+    /**
+     * @brief Records the begin of @p zone.
+     *
+     * @return True if the begin was recorded, which means that there is space
+     * reserved for the end as well.
+     */
+    bool begin(const Zone zone);
+
+    /**
+     * @brief Records the end of @p zone, only to be called if begin returned
+     * true.
+     */
+    void end(const Zone zone);
+
+    /**
+     * @brief Records a zone for the lifetime of the object, see TRACE_ZONE.
+     */
+    class Scope {
+      public:
+        explicit Scope(const Zone traced_zone)
+            : zone(traced_zone), recorded(begin(traced_zone)) {}
+
+        ~Scope() {
+            if (recorded) {
+                end(zone);
+            }
+        }
+
+        Scope(const Scope&)            = delete;
+        Scope& operator=(const Scope&) = delete;
+
+      private:
+        const Zone zone;
+        const bool recorded;
+    };
+
+    /**
+     * @brief Converts trace records into a Chrome trace JSON file.
+     */
+    struct ChromeWriter {
+        FILE* output;
+
+        /**
+         * @brief Number of events written so far.
+         */
+        size_t events;
+
+        /**
+         * @brief Start of the last frame of every core, to detect when the
+         * 32 bit counter wraps around.
+         */
+        uint32_t last_start[256];
+
+        /**
+         * @brief Counter value added for the wrap-arounds of every core.
+         */
+        uint64_t offset[256];
+    };
+
+    /**
+     * @brief Starts the JSON in @p output.
+     */
+    void begin_chrome(ChromeWriter& writer, FILE* output);
+
+    /**
+     * @brief Appends the events of the payload of a trace record of @p size
+     * bytes at @p data.
+     *
+     * @return False if the payload is malformed.
+     */
+    bool write_chrome(ChromeWriter& writer,
+                      const uint8_t* data,
+                      const size_t size);
+
+    /**
+     * @brief Terminates the JSON.
+     */
+    void end_chrome(ChromeWriter& writer);
+}
+
+#endif
@@ -1,10 +1,21 @@
 #include "feature_extraction.h"
 
+#include <math.h>
 #include <string.h>
 
 #include "fsl_device_registers.h"
 
 #include "board.h"
+#include "logger.h"
+#include "trace.h"
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #define BELOW_THRESHOLD_RANGE  (1)
 #define WITHIN_THRESHOLD_RANGE (0)
@@ -252,174 +263,181 @@ namespace frontend {
         return 0;
     }
 
-    SECTION_ITCM void extract_features(const uint8_t* image_buffer,
-                                       const int_fast32_t width,
-                                       const int_fast32_t height,
-                                       const uint8_t threshold,
-                                       image::KeyPoint* out_keypoints,
-                                       uint32_t* out_keypoints_size) {
-
-        // Keep track of how many keypoints we can store
-        const uint32_t max_number_of_keypoints = *out_keypoints_size;
-
-        // Reset the number of keypoints just in case
-        *out_keypoints_size = 0;
-
-        // Loop variables are declared here so that they have a reserved
-        // register place and don't have to be loaded for new loops
-        //
-        // Kept as signed integers to prevent underflow checks around 0 for
-        // speed.
-        int_fast32_t i, j, k;
-
-        // Pattern offset is used to retrieve the pattern around a given center
-        // pixel from the pointer of that center pixel without having to do any
-        // other computation
-        int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND];
-
-        // The pixel pattern from Rosten's implementation is the
-        // following (where we let point 0 be at the bottom with counter clock
-        // wise rotation):
-        //
-        //
-        //    |    | 9  | 8  | 7  |    |
-        //----+----+----+----+----+----+---
-        //    | 10 |    |    |    | 6  |
-        //----+----+----+----+----+----+---
-        // 11 |    |    |    |    |    | 5
-        //----+----+----+----+----+----+---
-        // 12 |    |    | p  |    |    | 4
-        //----+----+----+----+----+----+---
-        // 13 |    |    |    |    |    | 3
-        //----+----+----+----+----+----+---
-        //    | 14 |    |    |    | 2  |
-        //----+----+----+----+----+----+---
-        //    |    | 15 | 0  | 1  |    |
-        //
-        //
-        // The pattern offset lets us access the pattern around a given pixel p,
-        // by having the pointer to that pixel. E.g. for accessing point 4, one
-        // would do pixel_ptr[pattern[4]]
-
-        pattern_offset[0]  = 0 + width * 3;
-        pattern_offset[1]  = 1 + width * 3;
-        pattern_offset[2]  = 2 + width * 2;
-        pattern_offset[3]  = 3 + width * 1;
-        pattern_offset[4]  = 3 + width * 0;
-        pattern_offset[5]  = 3 + width * -1;
-        pattern_offset[6]  = 2 + width * -2;
-        pattern_offset[7]  = 1 + width * -3;
-        pattern_offset[8]  = 0 + width * -3;
-        pattern_offset[9]  = -1 + width * -3;
-        pattern_offset[10] = -2 + width * -2;
-        pattern_offset[11] = -3 + width * -1;
-        pattern_offset[12] = -3 + width * 0;
-        pattern_offset[13] = -3 + width * 1;
-        pattern_offset[14] = -2 + width * 2;
-        pattern_offset[15] = -1 + width * 3;
-
-        // Wrap around. This allows us to check the consecutive pixels starting
-        // from e.g. point 15 and onwards without any further computation
-        pattern_offset[16] = 0 + width * 3;
-        pattern_offset[17] = 1 + width * 3;
-        pattern_offset[18] = 2 + width * 2;
-        pattern_offset[19] = 3 + width * 1;
-        pattern_offset[20] = 3 + width * 0;
-        pattern_offset[21] = 3 + width * -1;
-        pattern_offset[22] = 2 + width * -2;
-        pattern_offset[23] = 1 + width * -3;
-        pattern_offset[24] = 0 + width * -3;
-
-        // Build a packed threshold such that we have a 32 bit integer with the
-        // threshold repeated for use in the SIMD 4 byte instructions
-        const uint32_t threshold_packed = (threshold << 24) |
-                                          (threshold << 16) | (threshold << 8) |
-                                          threshold;
-
-        // The threshold look up table is utilized for a fast check whether a
-        // given pattern value is below the range of (pixel value - threshold)
-        // to (pixel value + threshold), within or above.
-        //
-        // This is utilized to quickly reject points which can't be a candidate
-        // for a corner.
-        //
-        // This lookup table consists of the following entries:
-        //
-        // 0			   <= 1 < (255-threshold)
-        // (255-threshold) <= 0 < (255+threshold)
-        // (255+threshold) <= 2 < 512
-        //
-        // To then quickly check a given pattern pixel for this, one can do:
-        //
-        // lookup_table[255 - pixel value + pattern value]
-        //
-        // For e.g. a threshold of a 100, a pixel value of 16 and a pattern
-        // value of 120, this would yield:
-        //
-        // lookup_table[255 - 16 + 120] = lookup_table[359]
-        //
-        // Which according to the definition of the table is within the upper
-        // range and has a value of 2.
-        uint32_t threshold_lookup_table[512];
+    namespace fast {
+
+        /**
+         * @brief Segment test of evaluate_corner_candidate.
+         */
+        struct MaskChain {
+            SECTION_ITCM static inline int evaluate(
+                const uint8_t* pixel_ptr,
+                const int threshold,
+                const uint32_t threshold_lookup_table[512],
+                const int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND]) {
+                return evaluate_corner_candidate(pixel_ptr,
+                                                 threshold,
+                                                 threshold_lookup_table,
+                                                 pattern_offset);
+            }
+        };
+
+        /**
+         * @return True if the 16 bit @p mask has
+         * CONSECUTIVE_PIXELS_IN_PATTERN consecutive bits set, wrapping
+         * around from bit 15 to bit 0.
+         */
+        static constexpr bool has_consecutive_bits(const uint32_t mask) {
+
+            // With the mask repeated in the upper half, the runs which wrap
+            // around are contiguous as well
+            const uint32_t repeated = mask | (mask << 16);
+
+            uint32_t run = repeated;
+            for (int k = 1; k < CONSECUTIVE_PIXELS_IN_PATTERN; k++) {
+                run &= repeated >> k;
+            }
 
-        for (int n = -255; n <= 255; n++) {
-            threshold_lookup_table[n + 255] =
-                (n < -threshold  ? BELOW_THRESHOLD_RANGE
-                 : n > threshold ? ABOVE_THRESHOLD_RANGE
-                                 : WITHIN_THRESHOLD_RANGE);
+            return (run & 0xFFFF) != 0;
         }
 
-        // We keep a buffer which holds the scores of three rows in flight
-        //
-        // We make sure that the buffer is a multiple of 4 in order to do faster
-        // clearing
-        uint8_t row_scores_buffer[((width * 3) / 4 + 1) * 4];
-
-        // This pointer array is used to reference the different rows with
-        // scores in flight
-        uint8_t* row_scores[3];
-        row_scores[0] = row_scores_buffer;
-        row_scores[1] = row_scores[0] + width;
-        row_scores[2] = row_scores[1] + width;
-
-        // Also keep a buffer for the corner positions of three rows in flight
-        uint16_t
-            row_corner_positions_buffer[(width + 1) * 3 * sizeof(uint16_t)];
-
-        // As with the row scores, we keep a convenience array of pointers for
-        // the different rows in flight.
-        //
-        // Note that the number of corners are kept as the -1'th entry
-        // here: (row_corner_positions[n])[-1] is the amount of corners for the
-        // n'th row. This proved beneficial during profiling. That's why we
-        // append + 1 for the buffer pointers.
-        uint16_t* row_corner_positions[3];
-        row_corner_positions[0] = row_corner_positions_buffer + 1;
-        row_corner_positions[1] = row_corner_positions[0] + width + 1;
-        row_corner_positions[2] = row_corner_positions[1] + width + 1;
+        /**
+         * @brief One bit for every 16 bit mask of the pattern, set if the
+         * mask has CONSECUTIVE_PIXELS_IN_PATTERN consecutive bits.
+         */
+        struct ConsecutiveBitsTable {
+            uint32_t words[(1 << 16) / 32];
 
-        fast_clear_buffer(row_scores[0], width * 3);
+            constexpr bool contains(const uint32_t mask) const {
+                return (words[mask >> 5] >> (mask & 31)) & 1;
+            }
+        };
 
-        for (j = 3; j < height - 2; j++) {
+        static constexpr ConsecutiveBitsTable build_consecutive_bits_table() {
+            ConsecutiveBitsTable table = {};
 
-            const uint8_t* pixel_ptr = &image_buffer[j * width] + 3;
+            for (uint32_t mask = 0; mask < (1 << 16); mask++) {
+                if (has_consecutive_bits(mask)) {
+                    table.words[mask >> 5] |= 1U << (mask & 31);
+                }
+            }
 
-            uint8_t* current_row_scores = row_scores[(j - 3) % 3];
+            return table;
+        }
 
-            // Buffer for the detected corner positions on this row
-            uint16_t* current_row_corner_positions =
-                row_corner_positions[(j - 3) % 3];
+        /**
+         * @brief Generated at compile time, 8 KB.
+         */
+        static constexpr ConsecutiveBitsTable consecutive_bits_table =
+            build_consecutive_bits_table();
+
+        static_assert(consecutive_bits_table.contains(0x01FF) &&
+                          consecutive_bits_table.contains(0xF01F) &&
+                          !consecutive_bits_table.contains(0x00FF) &&
+                          !consecutive_bits_table.contains(0xF00F),
+                      "The runs of 9 bits have to wrap around");
+
+        /**
+         * @brief Segment test which compares the 16 pattern pixels without
+         * branching into a mask per polarity, and looks both masks up in
+         * consecutive_bits_table.
+         */
+        struct SegmentMask {
+            SECTION_ITCM static inline int evaluate(
+                const uint8_t* pixel_ptr,
+                const int threshold,
+                const uint32_t threshold_lookup_table[512],
+                const int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND]) {
+
+                (void)threshold_lookup_table;
+
+                const int pixel_plus_threshold  = pixel_ptr[0] + threshold;
+                const int pixel_minus_threshold = pixel_ptr[0] - threshold;
+
+                // Bit k is set if pattern pixel k is above or below the
+                // threshold range, the comparisons do not branch
+                uint32_t above = 0;
+                uint32_t below = 0;
+
+                for (int k = 0; k < 16; k++) {
+                    const int value = pixel_ptr[pattern_offset[k]];
+
+                    above |= (uint32_t)(value > pixel_plus_threshold) << k;
+                    below |= (uint32_t)(value < pixel_minus_threshold) << k;
+                }
 
-            // Number of corners detected on this row
-            uint16_t current_row_number_of_corners = 0;
+                if (!consecutive_bits_table.contains(above) &&
+                    !consecutive_bits_table.contains(below)) {
+                    return 0;
+                }
 
-            if (j < height - 3) {
-                i = 3;
+                return calculate_corner_score(pixel_ptr,
+                                              pattern_offset,
+                                              threshold);
+            }
+        };
+
+        /**
+         * @brief Backend using the 32 bit ARMv7E-M SIMD instructions, checking
+         * groups of 4 candidates at a time. On the host, the instructions are
+         * provided by the portable implementations in src/host.
+         */
+        struct Armv7em {
+
+            /**
+             * @brief Computes the scores of a row and the positions of the
+             * corners on it.
+             *
+             * @param row_ptr [in] Pointer to the start of the row in the
+             * image.
+             * @param start_column [in] Column of the first group of 4
+             * candidates, at least 3.
+             * @param end_column [in] Groups start before this column, so the
+             * candidates up to end_column + 2 are checked. At most width - 7.
+             * @param threshold [in] Threshold for the pixel pattern.
+             * @param threshold_lookup_table [in] Lookup table for rejecting
+             * candidates, see extract_features.
+             * @param pattern_offset [in] Used to retrieve the pattern around a
+             * pixel candidate.
+             * @param flags_buffer [in] Scratch of the wide backends for the
+             * flags of the row, see detect_row_with_flags. Not used here.
+             * @param current_row_scores [out] Scores of the row.
+             * @param current_row_corner_positions [out] Positions of the
+             * corners on the row.
+             *
+             * @return The number of corners on the row.
+             */
+            template <typename Classifier>
+            SECTION_ITCM static uint16_t detect_row(
+                const uint8_t* row_ptr,
+                const int_fast32_t start_column,
+                const int_fast32_t end_column,
+                const uint8_t threshold,
+                const uint32_t threshold_lookup_table[512],
+                const int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND],
+                uint8_t* flags_buffer,
+                uint8_t* current_row_scores,
+                uint16_t* current_row_corner_positions) {
+
+                (void)flags_buffer;
+
+                // Build a packed threshold such that we have a 32 bit integer
+                // with the threshold repeated for use in the SIMD 4 byte
+                // instructions
+                const uint32_t threshold_packed = (threshold << 24) |
+                                                  (threshold << 16) |
+                                                  (threshold << 8) | threshold;
+
+                const uint8_t* pixel_ptr = row_ptr + start_column;
+
+                // Number of corners detected on this row
+                uint16_t current_row_number_of_corners = 0;
+
+                int_fast32_t i = start_column;
 
                 // Every iteration builds on checking a group of 4 sequential
                 // pixels for whether they could be candidates for a corner by
                 // utilizing SIMD instructions
-                for (; i < width - 7; i += 4, pixel_ptr += 4) {
+                for (; i < end_column; i += 4, pixel_ptr += 4) {
 
                     // Clear the scores for this group
                     *((uint32_t*)(current_row_scores + i)) = 0x0;
@@ -601,7 +619,7 @@ namespace frontend {
                     // pattern
                     for (uint8_t idx = 0; idx < 4; idx++) {
 
-                        current_row_scores[i + idx] = evaluate_corner_candidate(
+                        current_row_scores[i + idx] = Classifier::evaluate(
                             &pixel_ptr[idx],
                             threshold,
                             threshold_lookup_table,
@@ -613,57 +631,1958 @@ namespace frontend {
                         }
                     }
                 }
+
+                return current_row_number_of_corners;
+            }
+        };
+
+        /**
+         * @brief Per pixel flags computed by the wide SIMD backends. They hold
+         * the same comparisons as the ARMv7E-M backend does with USUB8 and SEL
+         * on the diagonals 0/8 and 4/12 for a group of 4, but for a single
+         * pixel, so that they can be computed for 16 or 32 pixels at a time.
+         */
+#define FLAG_POINT0_8_ABOVE    (1 << 0)
+#define FLAG_POINT0_8_BELOW    (1 << 1)
+#define FLAG_POINT4_12_ABOVE   (1 << 2)
+#define FLAG_POINT4_12_BELOW   (1 << 3)
+#define FLAG_ABOVE_SATURATED   (1 << 4)
+#define FLAG_BELOW_SATURATED   (1 << 5)
+
+#define FLAGS_PACKED(flag)     ((flag) * 0x01010101U)
+
+        /**
+         * @brief Computes the flags of a single pixel, used for the pixels at
+         * the end of the row which do not fill a whole SIMD register.
+         */
+        static inline uint8_t classify_pixel(
+            const uint8_t* pixel_ptr,
+            const uint8_t threshold,
+            const int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND]) {
+
+            const int pixel_plus_threshold  = min(pixel_ptr[0] + threshold,
+                                                 255);
+            const int pixel_minus_threshold = max(pixel_ptr[0] - threshold, 0);
+
+            const int point0  = pixel_ptr[pattern_offset[0]];
+            const int point4  = pixel_ptr[pattern_offset[4]];
+            const int point8  = pixel_ptr[pattern_offset[8]];
+            const int point12 = pixel_ptr[pattern_offset[12]];
+
+            uint8_t flags = 0;
+
+            if (point0 >= pixel_plus_threshold ||
+                point8 >= pixel_plus_threshold) {
+                flags |= FLAG_POINT0_8_ABOVE;
             }
 
-            // Here comes the trick to specify the -1 index of the row corner
-            // positions buffer is the number of corners. Structuring this way
-            // proved beneficial during profiling
-            current_row_corner_positions[-1] = current_row_number_of_corners;
+            if (pixel_minus_threshold >= point0 ||
+                pixel_minus_threshold >= point8) {
+                flags |= FLAG_POINT0_8_BELOW;
+            }
 
-            if (j == 3)
-                continue;
+            if (point4 >= pixel_plus_threshold ||
+                point12 >= pixel_plus_threshold) {
+                flags |= FLAG_POINT4_12_ABOVE;
+            }
 
-            // Here we check the score of the previous row against the second
-            // previous row and the current row just examined. The one within a
-            // 3x3 grid with the highest score wins and is classified as a
-            // feature
-            const uint8_t* second_previous_row_scores = row_scores[(j - 2) % 3];
+            if (pixel_minus_threshold >= point4 ||
+                pixel_minus_threshold >= point12) {
+                flags |= FLAG_POINT4_12_BELOW;
+            }
 
-            const uint8_t* previous_row_scores = row_scores[(j - 1) % 3];
-            const uint16_t* previous_row_corner_positions =
-                row_corner_positions[(j - 1) % 3];
-            const uint16_t previous_row_number_of_corners =
-                previous_row_corner_positions[-1];
+            if (pixel_plus_threshold == 255) {
+                flags |= FLAG_ABOVE_SATURATED;
+            }
 
-            for (k = 0; k < (int_fast32_t)previous_row_number_of_corners; k++) {
+            if (pixel_minus_threshold == 0) {
+                flags |= FLAG_BELOW_SATURATED;
+            }
 
-                const uint32_t idx = previous_row_corner_positions[k];
-                const uint8_t previous_row_score = previous_row_scores[idx];
+            return flags;
+        }
 
-                if ((previous_row_score > previous_row_scores[idx + 1] &&
-                     previous_row_score > previous_row_scores[idx - 1] &&
-                     previous_row_score > second_previous_row_scores[idx - 1] &&
-                     previous_row_score > second_previous_row_scores[idx] &&
-                     previous_row_score > second_previous_row_scores[idx + 1] &&
-                     previous_row_score > current_row_scores[idx - 1] &&
-                     previous_row_score > current_row_scores[idx] &&
-                     previous_row_score > current_row_scores[idx + 1])) {
+        /**
+         * @brief Walks the row in groups of 4 with the per pixel flags in the
+         * exact same way as Armv7em::detect_row does, including the
+         * realignment when the leading candidates of a group are rejected and
+         * skipping the comparisons when the whole group saturates. This keeps
+         * the scores written to the row buffer, and thus the output after the
+         * non-maximum suppression, identical across the backends.
+         *
+         * @param flags [in] Flags of the pixels start_column to end_column + 2
+         * of the row.
+         *
+         * @return The number of corners on the row.
+         */
+        template <typename Classifier>
+        static inline uint16_t detect_row_from_flags(
+            const uint8_t* row_ptr,
+            const uint8_t* flags,
+            const int_fast32_t start_column,
+            const int_fast32_t end_column,
+            const uint8_t threshold,
+            const uint32_t threshold_lookup_table[512],
+            const int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND],
+            uint8_t* current_row_scores,
+            uint16_t* current_row_corner_positions) {
+
+            uint16_t current_row_number_of_corners = 0;
 
-                    if (*out_keypoints_size == max_number_of_keypoints) {
+            for (int_fast32_t i = start_column; i < end_column; i += 4) {
 
-                        logger::errorf(
-                            "Did not have enough space in the keypoint buffer "
-                            "to store all keypoints\r\n");
+                *((uint32_t*)(current_row_scores + i)) = 0x0;
 
-                        return;
+                uint32_t group_flags;
+                memcpy(&group_flags, flags + i, sizeof(group_flags));
+
+                // The ARMv7E-M backend skips the comparisons if all 4 pixels
+                // saturate, which is what these enable masks replicate
+                const uint32_t above_enabled =
+                    (group_flags & FLAGS_PACKED(FLAG_ABOVE_SATURATED)) !=
+                            FLAGS_PACKED(FLAG_ABOVE_SATURATED)
+                        ? FLAGS_PACKED(1)
+                        : 0;
+
+                const uint32_t below_enabled =
+                    (group_flags & FLAGS_PACKED(FLAG_BELOW_SATURATED)) !=
+                            FLAGS_PACKED(FLAG_BELOW_SATURATED)
+                        ? FLAGS_PACKED(1)
+                        : 0;
+
+                // One bit per pixel, where 0x00000100 corresponds to 0x0000FF00
+                // in the ARMv7E-M backend
+                uint32_t threshold_mask = (group_flags & above_enabled) |
+                                          ((group_flags >> 1) & below_enabled);
+
+                if (threshold_mask == 0) {
+                    continue;
+                }
+
+                if (threshold_mask == 0x01010100) {
+                    i -= 3;
+                    continue;
+                }
+
+                if (threshold_mask == 0x01010000) {
+                    i -= 2;
+                    continue;
+                }
+
+                if (threshold_mask == 0x01000000) {
+                    i -= 1;
+                    continue;
+                }
+
+                threshold_mask = ((group_flags >> 2) & above_enabled) |
+                                 ((group_flags >> 3) & below_enabled);
+
+                if (threshold_mask == 0) {
+                    continue;
+                }
+
+                if (threshold_mask == 0x01010100) {
+                    i -= 3;
+                    continue;
+                }
+
+                if (threshold_mask == 0x01010000) {
+                    i -= 2;
+                    continue;
+                }
+
+                if (threshold_mask == 0x01000000) {
+                    i -= 1;
+                    continue;
+                }
+
+                for (uint8_t idx = 0; idx < 4; idx++) {
+
+                    current_row_scores[i + idx] = Classifier::evaluate(
+                        &row_ptr[i + idx],
+                        threshold,
+                        threshold_lookup_table,
+                        pattern_offset);
+
+                    if (current_row_scores[i + idx] != 0) {
+                        current_row_corner_positions
+                            [current_row_number_of_corners++] = i + idx;
                     }
+                }
+            }
 
-                    out_keypoints[*out_keypoints_size].stale   = false;
-                    out_keypoints[*out_keypoints_size].point.x = idx;
-                    out_keypoints[*out_keypoints_size].point.y = j - 1;
-                    (*out_keypoints_size)++;
+            return current_row_number_of_corners;
+        }
+
+        /**
+         * @brief Common row detection for the wide SIMD backends, where @p
+         * Backend computes the flags of @p Backend::LANES pixels at a time
+         * into @p flags_buffer, which holds at least a row.
+         */
+        template <typename Backend, typename Classifier>
+        static inline uint16_t detect_row_with_flags(
+            const uint8_t* row_ptr,
+            const int_fast32_t start_column,
+            const int_fast32_t end_column,
+            const uint8_t threshold,
+            const uint32_t threshold_lookup_table[512],
+            const int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND],
+            uint8_t* flags_buffer,
+            uint8_t* current_row_scores,
+            uint16_t* current_row_corner_positions) {
+
+            // The groups of 4 reaches at most pixel end_column + 2
+            const int_fast32_t end = end_column + 3;
+
+            uint8_t* flags = flags_buffer;
+
+            int_fast32_t i = start_column;
+
+            for (; i + Backend::LANES <= end; i += Backend::LANES) {
+                Backend::classify(row_ptr + i,
+                                  threshold,
+                                  pattern_offset,
+                                  flags + i);
+            }
+
+            for (; i < end; i++) {
+                flags[i] = classify_pixel(row_ptr + i,
+                                          threshold,
+                                          pattern_offset);
+            }
+
+            return detect_row_from_flags<Classifier>(row_ptr,
+                                         flags,
+                                         start_column,
+                                         end_column,
+                                         threshold,
+                                         threshold_lookup_table,
+                                         pattern_offset,
+                                         current_row_scores,
+                                         current_row_corner_positions);
+        }
+
+#if defined(__SSE2__)
+        /**
+         * @brief Backend checking 16 candidates at a time with SSE2.
+         */
+        struct Sse2 {
+
+            static const int_fast32_t LANES = 16;
+
+            /**
+             * @return a >= b for unsigned bytes.
+             */
+            static inline __m128i greater_equal(const __m128i a,
+                                                const __m128i b) {
+                return _mm_cmpeq_epi8(_mm_max_epu8(a, b), a);
+            }
+
+            static inline void classify(
+                const uint8_t* pixel_ptr,
+                const uint8_t threshold,
+                const int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND],
+                uint8_t* out_flags) {
+
+                const __m128i threshold_packed = _mm_set1_epi8((char)threshold);
+
+                const __m128i pixels = _mm_loadu_si128(
+                    (const __m128i*)pixel_ptr);
+
+                const __m128i pixels_plus_threshold = _mm_adds_epu8(
+                    pixels,
+                    threshold_packed);
+                const __m128i pixels_minus_threshold = _mm_subs_epu8(
+                    pixels,
+                    threshold_packed);
+
+                const __m128i point0 = _mm_loadu_si128(
+                    (const __m128i*)(pixel_ptr + pattern_offset[0]));
+                const __m128i point4 = _mm_loadu_si128(
+                    (const __m128i*)(pixel_ptr + pattern_offset[4]));
+                const __m128i point8 = _mm_loadu_si128(
+                    (const __m128i*)(pixel_ptr + pattern_offset[8]));
+                const __m128i point12 = _mm_loadu_si128(
+                    (const __m128i*)(pixel_ptr + pattern_offset[12]));
+
+                const __m128i point0_8_above = _mm_or_si128(
+                    greater_equal(point0, pixels_plus_threshold),
+                    greater_equal(point8, pixels_plus_threshold));
+                const __m128i point0_8_below = _mm_or_si128(
+                    greater_equal(pixels_minus_threshold, point0),
+                    greater_equal(pixels_minus_threshold, point8));
+                const __m128i point4_12_above = _mm_or_si128(
+                    greater_equal(point4, pixels_plus_threshold),
+                    greater_equal(point12, pixels_plus_threshold));
+                const __m128i point4_12_below = _mm_or_si128(
+                    greater_equal(pixels_minus_threshold, point4),
+                    greater_equal(pixels_minus_threshold, point12));
+
+                const __m128i above_saturated = _mm_cmpeq_epi8(
+                    pixels_plus_threshold,
+                    _mm_set1_epi8((char)0xFF));
+                const __m128i below_saturated = _mm_cmpeq_epi8(
+                    pixels_minus_threshold,
+                    _mm_setzero_si128());
+
+                __m128i flags = _mm_and_si128(
+                    point0_8_above,
+                    _mm_set1_epi8(FLAG_POINT0_8_ABOVE));
+                flags = _mm_or_si128(flags,
+                                     _mm_and_si128(point0_8_below,
+                                                   _mm_set1_epi8(
+                                                       FLAG_POINT0_8_BELOW)));
+                flags = _mm_or_si128(flags,
+                                     _mm_and_si128(point4_12_above,
+                                                   _mm_set1_epi8(
+                                                       FLAG_POINT4_12_ABOVE)));
+                flags = _mm_or_si128(flags,
+                                     _mm_and_si128(point4_12_below,
+                                                   _mm_set1_epi8(
+                                                       FLAG_POINT4_12_BELOW)));
+                flags = _mm_or_si128(flags,
+                                     _mm_and_si128(above_saturated,
+                                                   _mm_set1_epi8(
+                                                       FLAG_ABOVE_SATURATED)));
+                flags = _mm_or_si128(flags,
+                                     _mm_and_si128(below_saturated,
+                                                   _mm_set1_epi8(
+                                                       FLAG_BELOW_SATURATED)));
+
+                _mm_storeu_si128((__m128i*)out_flags, flags);
+            }
+
+            template <typename Classifier>
+            static uint16_t detect_row(
+                const uint8_t* row_ptr,
+                const int_fast32_t start_column,
+                const int_fast32_t end_column,
+                const uint8_t threshold,
+                const uint32_t threshold_lookup_table[512],
+                const int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND],
+                uint8_t* flags_buffer,
+                uint8_t* current_row_scores,
+                uint16_t* current_row_corner_positions) {
+                return detect_row_with_flags<Sse2, Classifier>(
+                    row_ptr,
+                    start_column,
+                    end_column,
+                    threshold,
+                    threshold_lookup_table,
+                    pattern_offset,
+                    flags_buffer,
+                    current_row_scores,
+                    current_row_corner_positions);
+            }
+        };
+#endif
+
+#if defined(__AVX2__)
+        /**
+         * @brief Backend checking 32 candidates at a time with AVX2.
+         */
+        struct Avx2 {
+
+            static const int_fast32_t LANES = 32;
+
+            /**
+             * @return a >= b for unsigned bytes.
+             */
+            static inline __m256i greater_equal(const __m256i a,
+                                                const __m256i b) {
+                return _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), a);
+            }
+
+            static inline void classify(
+                const uint8_t* pixel_ptr,
+                const uint8_t threshold,
+                const int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND],
+                uint8_t* out_flags) {
+
+                const __m256i threshold_packed = _mm256_set1_epi8(
+                    (char)threshold);
+
+                const __m256i pixels = _mm256_loadu_si256(
+                    (const __m256i*)pixel_ptr);
+
+                const __m256i pixels_plus_threshold = _mm256_adds_epu8(
+                    pixels,
+                    threshold_packed);
+                const __m256i pixels_minus_threshold = _mm256_subs_epu8(
+                    pixels,
+                    threshold_packed);
+
+                const __m256i point0 = _mm256_loadu_si256(
+                    (const __m256i*)(pixel_ptr + pattern_offset[0]));
+                const __m256i point4 = _mm256_loadu_si256(
+                    (const __m256i*)(pixel_ptr + pattern_offset[4]));
+                const __m256i point8 = _mm256_loadu_si256(
+                    (const __m256i*)(pixel_ptr + pattern_offset[8]));
+                const __m256i point12 = _mm256_loadu_si256(
+                    (const __m256i*)(pixel_ptr + pattern_offset[12]));
+
+                const __m256i point0_8_above = _mm256_or_si256(
+                    greater_equal(point0, pixels_plus_threshold),
+                    greater_equal(point8, pixels_plus_threshold));
+                const __m256i point0_8_below = _mm256_or_si256(
+                    greater_equal(pixels_minus_threshold, point0),
+                    greater_equal(pixels_minus_threshold, point8));
+                const __m256i point4_12_above = _mm256_or_si256(
+                    greater_equal(point4, pixels_plus_threshold),
+                    greater_equal(point12, pixels_plus_threshold));
+                const __m256i point4_12_below = _mm256_or_si256(
+                    greater_equal(pixels_minus_threshold, point4),
+                    greater_equal(pixels_minus_threshold, point12));
+
+                const __m256i above_saturated = _mm256_cmpeq_epi8(
+                    pixels_plus_threshold,
+                    _mm256_set1_epi8((char)0xFF));
+                const __m256i below_saturated = _mm256_cmpeq_epi8(
+                    pixels_minus_threshold,
+                    _mm256_setzero_si256());
+
+                __m256i flags = _mm256_and_si256(
+                    point0_8_above,
+                    _mm256_set1_epi8(FLAG_POINT0_8_ABOVE));
+                flags = _mm256_or_si256(
+                    flags,
+                    _mm256_and_si256(point0_8_below,
+                                     _mm256_set1_epi8(FLAG_POINT0_8_BELOW)));
+                flags = _mm256_or_si256(
+                    flags,
+                    _mm256_and_si256(point4_12_above,
+                                     _mm256_set1_epi8(FLAG_POINT4_12_ABOVE)));
+                flags = _mm256_or_si256(
+                    flags,
+                    _mm256_and_si256(point4_12_below,
+                                     _mm256_set1_epi8(FLAG_POINT4_12_BELOW)));
+                flags = _mm256_or_si256(
+                    flags,
+                    _mm256_and_si256(above_saturated,
+                                     _mm256_set1_epi8(FLAG_ABOVE_SATURATED)));
+                flags = _mm256_or_si256(
+                    flags,
+                    _mm256_and_si256(below_saturated,
+                                     _mm256_set1_epi8(FLAG_BELOW_SATURATED)));
+
+                _mm256_storeu_si256((__m256i*)out_flags, flags);
+            }
+
+            template <typename Classifier>
+            static uint16_t detect_row(
+                const uint8_t* row_ptr,
+                const int_fast32_t start_column,
+                const int_fast32_t end_column,
+                const uint8_t threshold,
+                const uint32_t threshold_lookup_table[512],
+                const int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND],
+                uint8_t* flags_buffer,
+                uint8_t* current_row_scores,
+                uint16_t* current_row_corner_positions) {
+                return detect_row_with_flags<Avx2, Classifier>(
+                    row_ptr,
+                    start_column,
+                    end_column,
+                    threshold,
+                    threshold_lookup_table,
+                    pattern_offset,
+                    flags_buffer,
+                    current_row_scores,
+                    current_row_corner_positions);
+            }
+        };
+#endif
+
+#if defined(__ARM_NEON)
+        /**
+         * @brief Backend checking 16 candidates at a time with NEON.
+         */
+        struct Neon {
+
+            static const int_fast32_t LANES = 16;
+
+            static inline void classify(
+                const uint8_t* pixel_ptr,
+                const uint8_t threshold,
+                const int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND],
+                uint8_t* out_flags) {
+
+                const uint8x16_t threshold_packed = vdupq_n_u8(threshold);
+
+                const uint8x16_t pixels = vld1q_u8(pixel_ptr);
+
+                const uint8x16_t pixels_plus_threshold = vqaddq_u8(
+                    pixels,
+                    threshold_packed);
+                const uint8x16_t pixels_minus_threshold = vqsubq_u8(
+                    pixels,
+                    threshold_packed);
+
+                const uint8x16_t point0  = vld1q_u8(pixel_ptr +
+                                                   pattern_offset[0]);
+                const uint8x16_t point4  = vld1q_u8(pixel_ptr +
+                                                   pattern_offset[4]);
+                const uint8x16_t point8  = vld1q_u8(pixel_ptr +
+                                                   pattern_offset[8]);
+                const uint8x16_t point12 = vld1q_u8(pixel_ptr +
+                                                    pattern_offset[12]);
+
+                const uint8x16_t point0_8_above = vorrq_u8(
+                    vcgeq_u8(point0, pixels_plus_threshold),
+                    vcgeq_u8(point8, pixels_plus_threshold));
+                const uint8x16_t point0_8_below = vorrq_u8(
+                    vcgeq_u8(pixels_minus_threshold, point0),
+                    vcgeq_u8(pixels_minus_threshold, point8));
+                const uint8x16_t point4_12_above = vorrq_u8(
+                    vcgeq_u8(point4, pixels_plus_threshold),
+                    vcgeq_u8(point12, pixels_plus_threshold));
+                const uint8x16_t point4_12_below = vorrq_u8(
+                    vcgeq_u8(pixels_minus_threshold, point4),
+                    vcgeq_u8(pixels_minus_threshold, point12));
+
+                const uint8x16_t above_saturated = vceqq_u8(
+                    pixels_plus_threshold,
+                    vdupq_n_u8(0xFF));
+                const uint8x16_t below_saturated = vceqq_u8(
+                    pixels_minus_threshold,
+                    vdupq_n_u8(0));
+
+                uint8x16_t flags = vandq_u8(point0_8_above,
+                                            vdupq_n_u8(FLAG_POINT0_8_ABOVE));
+                flags = vorrq_u8(flags,
+                                 vandq_u8(point0_8_below,
+                                          vdupq_n_u8(FLAG_POINT0_8_BELOW)));
+                flags = vorrq_u8(flags,
+                                 vandq_u8(point4_12_above,
+                                          vdupq_n_u8(FLAG_POINT4_12_ABOVE)));
+                flags = vorrq_u8(flags,
+                                 vandq_u8(point4_12_below,
+                                          vdupq_n_u8(FLAG_POINT4_12_BELOW)));
+                flags = vorrq_u8(flags,
+                                 vandq_u8(above_saturated,
+                                          vdupq_n_u8(FLAG_ABOVE_SATURATED)));
+                flags = vorrq_u8(flags,
+                                 vandq_u8(below_saturated,
+                                          vdupq_n_u8(FLAG_BELOW_SATURATED)));
+
+                vst1q_u8(out_flags, flags);
+            }
+
+            template <typename Classifier>
+            static uint16_t detect_row(
+                const uint8_t* row_ptr,
+                const int_fast32_t start_column,
+                const int_fast32_t end_column,
+                const uint8_t threshold,
+                const uint32_t threshold_lookup_table[512],
+                const int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND],
+                uint8_t* flags_buffer,
+                uint8_t* current_row_scores,
+                uint16_t* current_row_corner_positions) {
+                return detect_row_with_flags<Neon, Classifier>(
+                    row_ptr,
+                    start_column,
+                    end_column,
+                    threshold,
+                    threshold_lookup_table,
+                    pattern_offset,
+                    flags_buffer,
+                    current_row_scores,
+                    current_row_corner_positions);
+            }
+        };
+#endif
+    }
+
+    /**
+     * @brief Stores the corners in raster order until the keypoint buffer is
+     * full. Corners detected on pyramid level @p octave are mapped back to
+     * the centre of the block of level 0 pixels they were averaged from.
+     */
+    struct KeyPointOutput {
+
+        image::KeyPoint* keypoints;
+        uint32_t* keypoints_size;
+
+        /**
+         * @brief How many keypoints we can store.
+         */
+        const uint32_t max_number_of_keypoints;
+
+        const uint8_t octave;
+
+        /**
+         * @brief Corners within one pixel of the level of any of these
+         * keypoints, which were detected on coarser levels, are rejected, so
+         * that a corner is not kept once per level.
+         */
+        const image::KeyPoint* coarser_keypoints = NULL;
+        uint32_t coarser_keypoints_size          = 0;
+
+        KeyPointOutput(image::KeyPoint* out_keypoints,
+                       uint32_t* out_keypoints_size,
+                       const uint8_t level = 0)
+            : keypoints(out_keypoints), keypoints_size(out_keypoints_size),
+              max_number_of_keypoints(*out_keypoints_size), octave(level) {
+
+            // Reset the number of keypoints just in case
+            *keypoints_size = 0;
+        }
+
+        /**
+         * @brief Adds a corner at @p x, @p y with the given @p score.
+         *
+         * @return false if the corner could not be stored and the detection
+         * should stop.
+         */
+        inline bool add(const uint32_t x, const uint32_t y, const uint8_t) {
+
+            if (*keypoints_size == max_number_of_keypoints) {
+
+                logger::errorf("Did not have enough space in the keypoint "
+                               "buffer to store all keypoints\r\n");
+
+                return false;
+            }
+
+            const float scale    = (float)(1 << octave);
+            const float mapped_x = (x + 0.5f) * scale - 0.5f;
+            const float mapped_y = (y + 0.5f) * scale - 0.5f;
+
+            for (uint32_t i = 0; i < coarser_keypoints_size; i++) {
+
+                const float radius = (float)(1 << coarser_keypoints[i].octave);
+
+                const float dx = coarser_keypoints[i].point.x - mapped_x;
+                const float dy = coarser_keypoints[i].point.y - mapped_y;
+
+                if (dx * dx + dy * dy <= radius * radius) {
+                    return true;
                 }
             }
+
+            keypoints[*keypoints_size].stale   = false;
+            keypoints[*keypoints_size].point.x = mapped_x;
+            keypoints[*keypoints_size].point.y = mapped_y;
+            keypoints[*keypoints_size].octave  = octave;
+            (*keypoints_size)++;
+
+            return true;
+        }
+    };
+
+    /**
+     * @brief A corner kept in a grid cell.
+     */
+    struct GridCorner {
+        uint16_t x;
+        uint16_t y;
+        uint8_t score;
+    };
+
+    /**
+     * @return False, after logging an error, if @p grid is empty or does not
+     * fit in MAX_GRID_CELLS and MAX_GRID_CORNERS.
+     */
+    static bool fits_grid(const Grid& grid) {
+
+        const uint32_t number_of_cells = grid.columns * grid.rows;
+
+        if (number_of_cells == 0 || grid.keypoints_per_cell == 0) {
+            return false;
+        }
+
+        if (number_of_cells > MAX_GRID_CELLS ||
+            number_of_cells * grid.keypoints_per_cell > MAX_GRID_CORNERS) {
+            logger::errorf("Grid of %ux%u with %u corners per cell is too "
+                           "large, max: %lu cells, %lu corners\r\n",
+                           grid.columns,
+                           grid.rows,
+                           grid.keypoints_per_cell,
+                           (unsigned long)MAX_GRID_CELLS,
+                           (unsigned long)MAX_GRID_CORNERS);
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Keeps the corners with the highest score in every cell of a grid.
+     * Each cell holds its corners sorted by descending score, which is cheap
+     * for the handful of corners kept per cell.
+     */
+    struct GridOutput {
+
+        const Grid grid;
+
+        const int_fast32_t width;
+        const int_fast32_t height;
+
+        /**
+         * @brief keypoints_per_cell corners for each cell, row major.
+         */
+        GridCorner* corners;
+
+        /**
+         * @brief Number of corners in each cell.
+         */
+        uint8_t* corners_size;
+
+        /**
+         * @brief If not NULL, corners in the cells marked here are rejected.
+         */
+        const uint8_t* covered_cells = NULL;
+
+        /**
+         * @brief Corners closer than the exclusion radius to any of these
+         * keypoints are rejected.
+         */
+        const image::KeyPoint* existing_keypoints = NULL;
+        uint32_t existing_keypoints_size          = 0;
+        float exclusion_radius_squared            = 0;
+
+        GridOutput(const Grid& grid_layout,
+                   const int_fast32_t image_width,
+                   const int_fast32_t image_height,
+                   GridCorner* corners_buffer,
+                   uint8_t* corners_size_buffer)
+            : grid(grid_layout), width(image_width), height(image_height),
+              corners(corners_buffer), corners_size(corners_size_buffer) {
+
+            memset(corners_size, 0, grid.columns * grid.rows);
         }
+
+        inline bool
+        add(const uint32_t x, const uint32_t y, const uint8_t score) {
+
+            const uint32_t cell = (y * grid.rows / height) * grid.columns +
+                                  (x * grid.columns / width);
+
+            if (covered_cells != NULL && covered_cells[cell]) {
+                return true;
+            }
+
+            for (uint32_t i = 0; i < existing_keypoints_size; i++) {
+
+                const float dx = existing_keypoints[i].point.x - x;
+                const float dy = existing_keypoints[i].point.y - y;
+
+                if (dx * dx + dy * dy < exclusion_radius_squared) {
+                    return true;
+                }
+            }
+
+            GridCorner* cell_corners = &corners[cell * grid.keypoints_per_cell];
+            uint8_t size             = corners_size[cell];
+
+            // As corners are added in raster order, a corner with an equal
+            // score as the weakest one in a full cell is rejected, so that the
+            // first one detected wins
+            if (size == grid.keypoints_per_cell) {
+                if (score <= cell_corners[size - 1].score) {
+                    return true;
+                }
+
+                size--;
+            } else {
+                corners_size[cell]++;
+            }
+
+            while (size > 0 && cell_corners[size - 1].score < score) {
+                cell_corners[size] = cell_corners[size - 1];
+                size--;
+            }
+
+            cell_corners[size].x     = x;
+            cell_corners[size].y     = y;
+            cell_corners[size].score = score;
+
+            return true;
+        }
+
+        /**
+         * @brief Writes the kept corners to @p out_keypoints. The best corner
+         * of every cell is written first, then the second best of every cell
+         * and so on, so that the keypoints stay spread over the image if the
+         * buffer can not hold all of them. When only some of the corners of a
+         * rank fit, the ones with the highest score are chosen.
+         */
+        void write(image::KeyPoint* out_keypoints,
+                   uint32_t* out_keypoints_size) const {
+
+            const uint32_t max_number_of_keypoints = *out_keypoints_size;
+            const uint32_t number_of_cells = grid.columns * grid.rows;
+
+            *out_keypoints_size = 0;
+
+            for (uint8_t rank = 0; rank < grid.keypoints_per_cell; rank++) {
+
+                uint32_t histogram[256] = {};
+                uint32_t rank_size      = 0;
+
+                for (uint32_t cell = 0; cell < number_of_cells; cell++) {
+                    if (corners_size[cell] > rank) {
+                        histogram[corners[cell * grid.keypoints_per_cell + rank]
+                                      .score]++;
+                        rank_size++;
+                    }
+                }
+
+                if (rank_size == 0) {
+                    return;
+                }
+
+                const uint32_t space = max_number_of_keypoints -
+                                       *out_keypoints_size;
+
+                // If not all the corners of this rank fit, only the ones with
+                // a score above the minimum score are written, and the ones
+                // equal to it fill up the remaining space in cell order
+                int minimum_score             = 0;
+                uint32_t minimum_score_places = space;
+
+                if (rank_size > space) {
+
+                    uint32_t count = 0;
+
+                    for (minimum_score = 255; minimum_score > 0;
+                         minimum_score--) {
+                        if (count + histogram[minimum_score] > space) {
+                            break;
+                        }
+
+                        count += histogram[minimum_score];
+                    }
+
+                    minimum_score_places = space - count;
+                }
+
+                for (uint32_t cell = 0; cell < number_of_cells; cell++) {
+
+                    if (corners_size[cell] <= rank) {
+                        continue;
+                    }
+
+                    const GridCorner& corner =
+                        corners[cell * grid.keypoints_per_cell + rank];
+
+                    if (corner.score < minimum_score) {
+                        continue;
+                    }
+
+                    if (corner.score == minimum_score) {
+                        if (minimum_score_places == 0) {
+                            continue;
+                        }
+
+                        minimum_score_places--;
+                    }
+
+                    out_keypoints[*out_keypoints_size] = image::KeyPoint(
+                        corner.x,
+                        corner.y);
+                    (*out_keypoints_size)++;
+                }
+
+                if (rank_size > space) {
+                    return;
+                }
+            }
+        }
+    };
+
+    /**
+     * @return The first column (or row) of @p cell when @p length pixels are
+     * split into @p cells cells, such that pixel x belongs to cell x * cells /
+     * length.
+     */
+    static inline int_fast32_t cell_start(const int_fast32_t cell,
+                                          const int_fast32_t cells,
+                                          const int_fast32_t length) {
+        return (cell * length + cells - 1) / cells;
+    }
+
+    /**
+     * @brief Number of bits of each coordinate of a corner packed for ANMS.
+     */
+#define ANMS_COORDINATE_BITS (12)
+#define ANMS_COORDINATE_MASK ((1 << ANMS_COORDINATE_BITS) - 1)
+
+    /**
+     * @brief Number of cells along each axis of the grid ANMS looks the kept
+     * corners up in, at most.
+     */
+#define ANMS_GRID_SIZE (32)
+
+    /**
+     * @brief Stores every corner packed into a word, with the inverted score
+     * in the top byte and the row and column below it, so that the words
+     * sort by descending score and then in raster order.
+     */
+    struct AnmsOutput {
+
+        uint32_t* candidates;
+        uint32_t* candidates_size;
+
+        const uint32_t capacity;
+
+        AnmsOutput(uint32_t* candidates_buffer,
+                   uint32_t* out_candidates_size)
+            : candidates(candidates_buffer),
+              candidates_size(out_candidates_size),
+              capacity(*out_candidates_size) {
+
+            *candidates_size = 0;
+        }
+
+        inline bool
+        add(const uint32_t x, const uint32_t y, const uint8_t score) {
+
+            if (*candidates_size == capacity) {
+
+                logger::errorf("Did not have enough space in the ANMS "
+                               "candidate buffer to store all corners\r\n");
+
+                return false;
+            }
+
+            candidates[(*candidates_size)++] =
+                ((uint32_t)(255 - score) << (2 * ANMS_COORDINATE_BITS)) |
+                (y << ANMS_COORDINATE_BITS) | x;
+
+            return true;
+        }
+    };
+
+    /**
+     * @brief Moves @p values[@p root] down the max-heap in the first @p end
+     * values until it is not smaller than its children.
+     */
+    static void
+    sift_down(uint32_t* values, uint32_t root, const uint32_t end) {
+
+        while (2 * root + 1 < end) {
+            uint32_t child = 2 * root + 1;
+
+            if (child + 1 < end && values[child] < values[child + 1]) {
+                child++;
+            }
+
+            if (values[root] >= values[child]) {
+                return;
+            }
+
+            const uint32_t value = values[root];
+            values[root]         = values[child];
+            values[child]        = value;
+
+            root = child;
+        }
+    }
+
+    /**
+     * @brief Sorts @p values in ascending order in place with heapsort, which
+     * needs no memory beyond the values.
+     */
+    static void sort_ascending(uint32_t* values, const uint32_t size) {
+
+        for (uint32_t root = size / 2; root > 0; root--) {
+            sift_down(values, root - 1, size);
+        }
+
+        for (uint32_t end = size; end > 1; end--) {
+            const uint32_t value = values[0];
+            values[0]            = values[end - 1];
+            values[end - 1]      = value;
+
+            sift_down(values, 0, end - 1);
+        }
+    }
+
+    /**
+     * @brief Keeps the @p candidates, sorted by descending score, which are
+     * at least @p radius away from every corner kept before them. The kept
+     * corners are looked up in a grid with cells of at least @p radius, so
+     * only the 3x3 cells around a candidate are checked.
+     *
+     * @param kept [out] The first @p max_kept corners kept, at most
+     * MAX_ANMS_KEYPOINTS.
+     *
+     * @return The number of corners kept, or @p max_kept + 1 if there are
+     * more, in which case the suppression stops early.
+     */
+    static uint32_t suppress_within_radius(const uint32_t* candidates,
+                                           const uint32_t candidates_size,
+                                           const int32_t radius,
+                                           const int32_t width,
+                                           const int32_t height,
+                                           const uint32_t max_kept,
+                                           uint32_t* kept) {
+
+        const int32_t cell_size = max(
+            radius,
+            (max(width, height) + ANMS_GRID_SIZE - 1) / ANMS_GRID_SIZE);
+
+        const int32_t columns = (width + cell_size - 1) / cell_size;
+        const int32_t rows    = (height + cell_size - 1) / cell_size;
+
+        // The kept corners of every cell as a linked list, UINT16_MAX ends it
+        uint16_t cell_heads[ANMS_GRID_SIZE * ANMS_GRID_SIZE];
+        uint16_t next_kept[MAX_ANMS_KEYPOINTS];
+
+        memset(cell_heads, 0xFF, columns * rows * sizeof(uint16_t));
+
+        const int32_t radius_squared = radius * radius;
+
+        uint32_t kept_size = 0;
+
+        for (uint32_t i = 0; i < candidates_size; i++) {
+
+            const int32_t x = candidates[i] & ANMS_COORDINATE_MASK;
+            const int32_t y = (candidates[i] >> ANMS_COORDINATE_BITS) &
+                              ANMS_COORDINATE_MASK;
+
+            const int32_t column = x / cell_size;
+            const int32_t row    = y / cell_size;
+
+            bool suppressed = false;
+
+            for (int32_t r = max(row - 1, 0);
+                 r <= min(row + 1, rows - 1) && !suppressed;
+                 r++) {
+                for (int32_t c = max(column - 1, 0);
+                     c <= min(column + 1, columns - 1) && !suppressed;
+                     c++) {
+                    for (uint16_t k = cell_heads[r * columns + c];
+                         k != UINT16_MAX;
+                         k = next_kept[k]) {
+
+                        const int32_t dx = (int32_t)(kept[k] &
+                                                     ANMS_COORDINATE_MASK) -
+                                           x;
+                        const int32_t dy =
+                            (int32_t)((kept[k] >> ANMS_COORDINATE_BITS) &
+                                      ANMS_COORDINATE_MASK) -
+                            y;
+
+                        if (dx * dx + dy * dy < radius_squared) {
+                            suppressed = true;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            if (suppressed) {
+                continue;
+            }
+
+            if (kept_size == max_kept) {
+                return max_kept + 1;
+            }
+
+            const uint32_t cell = row * columns + column;
+
+            kept[kept_size]      = candidates[i];
+            next_kept[kept_size] = cell_heads[cell];
+            cell_heads[cell]     = kept_size;
+            kept_size++;
+        }
+
+        return kept_size;
+    }
+
+    /**
+     * @brief Detects corners on a row, but only in the cells of the grid
+     * which are not covered.
+     *
+     * @return The number of corners on the row.
+     */
+    template <typename Backend, typename Classifier>
+    SECTION_ITCM static uint16_t detect_uncovered_row(
+        const uint8_t* row_ptr,
+        const int_fast32_t width,
+        const int_fast32_t cell_row,
+        const uint8_t threshold,
+        const uint32_t threshold_lookup_table[512],
+        const int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND],
+        const Grid& grid,
+        const uint8_t* covered_cells,
+        uint8_t* flags_buffer,
+        uint8_t* current_row_scores,
+        uint16_t* current_row_corner_positions) {
+
+        // The covered parts of the row are not scanned, so make sure that
+        // they do not keep any scores from the row three rows above
+        memset(current_row_scores, 0, width);
+
+        const uint8_t* covered_cells_on_row = &covered_cells[cell_row *
+                                                             grid.columns];
+
+        uint16_t current_row_number_of_corners = 0;
+
+        // Candidates up to end_column + 2 can be checked by a span, so the
+        // next span has to start after that
+        int_fast32_t previous_end_column = 0;
+
+        int_fast32_t cell = 0;
+
+        while (cell < grid.columns) {
+
+            if (covered_cells_on_row[cell]) {
+                cell++;
+                continue;
+            }
+
+            // Scan neighbouring cells which are not covered in one go
+            const int_fast32_t first_cell = cell;
+
+            while (cell < grid.columns && !covered_cells_on_row[cell]) {
+                cell++;
+            }
+
+            const int_fast32_t start_column = max(
+                max(cell_start(first_cell, grid.columns, width),
+                    (int_fast32_t)3),
+                previous_end_column + 3);
+
+            const int_fast32_t end_column = min(cell_start(cell,
+                                                           grid.columns,
+                                                           width),
+                                                width - 7);
+
+            if (start_column >= end_column) {
+                continue;
+            }
+
+            current_row_number_of_corners +=
+                Backend::template detect_row<Classifier>(
+                    row_ptr,
+                    start_column,
+                    end_column,
+                    threshold,
+                    threshold_lookup_table,
+                    pattern_offset,
+                    flags_buffer,
+                    current_row_scores,
+                    current_row_corner_positions +
+                        current_row_number_of_corners);
+
+            previous_end_column = end_column;
+        }
+
+        return current_row_number_of_corners;
+    }
+
+    /**
+     * @brief Builds the threshold lookup table for @p threshold, which is
+     * utilized for a fast check whether a given pattern value is below the
+     * range of (pixel value - threshold) to (pixel value + threshold), within
+     * or above. This is utilized to quickly reject points which can't be a
+     * candidate for a corner.
+     *
+     * This lookup table consists of the following entries:
+     *
+     * 0               <= 1 < (255-threshold)
+     * (255-threshold) <= 0 < (255+threshold)
+     * (255+threshold) <= 2 < 512
+     *
+     * To then quickly check a given pattern pixel for this, one can do:
+     *
+     * lookup_table[255 - pixel value + pattern value]
+     *
+     * For e.g. a threshold of a 100, a pixel value of 16 and a pattern value
+     * of 120, this would yield:
+     *
+     * lookup_table[255 - 16 + 120] = lookup_table[359]
+     *
+     * Which according to the definition of the table is within the upper
+     * range and has a value of 2.
+     */
+    static void
+    build_threshold_lookup_table(const uint8_t threshold,
+                                 uint32_t threshold_lookup_table[512]) {
+        for (int n = -255; n <= 255; n++) {
+            threshold_lookup_table[n + 255] =
+                (n < -threshold  ? BELOW_THRESHOLD_RANGE
+                 : n > threshold ? ABOVE_THRESHOLD_RANGE
+                                 : WITHIN_THRESHOLD_RANGE);
+        }
+    }
+
+    template <typename Backend, typename Classifier>
+    template <typename Output>
+    SECTION_ITCM void BasicFastDetector<Backend, Classifier>::detect_corners(
+        const image::Image& image,
+        Output& output,
+        FastStatistics* statistics,
+        const Grid* grid,
+        const uint8_t* covered_cells) const {
+
+        const uint8_t* image_buffer = image.data;
+        const int_fast32_t width    = image.width;
+        const int_fast32_t height   = image.height;
+        const uint8_t threshold     = current_threshold;
+
+        // Loop variables are declared here so that they have a reserved
+        // register place and don't have to be loaded for new loops
+        //
+        // Kept as signed integers to prevent underflow checks around 0 for
+        // speed.
+        int_fast32_t j, k;
+
+        // Pattern offset is used to retrieve the pattern around a given center
+        // pixel from the pointer of that center pixel without having to do any
+        // other computation
+        int pattern_offset[PIXELS_IN_PATTERN_WITH_WRAP_AROUND];
+
+        // The pixel pattern from Rosten's implementation is the
+        // following (where we let point 0 be at the bottom with counter clock
+        // wise rotation):
+        //
+        //
+        //    |    | 9  | 8  | 7  |    |
+        //----+----+----+----+----+----+---
+        //    | 10 |    |    |    | 6  |
+        //----+----+----+----+----+----+---
+        // 11 |    |    |    |    |    | 5
+        //----+----+----+----+----+----+---
+        // 12 |    |    | p  |    |    | 4
+        //----+----+----+----+----+----+---
+        // 13 |    |    |    |    |    | 3
+        //----+----+----+----+----+----+---
+        //    | 14 |    |    |    | 2  |
+        //----+----+----+----+----+----+---
+        //    |    | 15 | 0  | 1  |    |
+        //
+        //
+        // The pattern offset lets us access the pattern around a given pixel p,
+        // by having the pointer to that pixel. E.g. for accessing point 4, one
+        // would do pixel_ptr[pattern[4]]
+
+        pattern_offset[0]  = 0 + width * 3;
+        pattern_offset[1]  = 1 + width * 3;
+        pattern_offset[2]  = 2 + width * 2;
+        pattern_offset[3]  = 3 + width * 1;
+        pattern_offset[4]  = 3 + width * 0;
+        pattern_offset[5]  = 3 + width * -1;
+        pattern_offset[6]  = 2 + width * -2;
+        pattern_offset[7]  = 1 + width * -3;
+        pattern_offset[8]  = 0 + width * -3;
+        pattern_offset[9]  = -1 + width * -3;
+        pattern_offset[10] = -2 + width * -2;
+        pattern_offset[11] = -3 + width * -1;
+        pattern_offset[12] = -3 + width * 0;
+        pattern_offset[13] = -3 + width * 1;
+        pattern_offset[14] = -2 + width * 2;
+        pattern_offset[15] = -1 + width * 3;
+
+        // Wrap around. This allows us to check the consecutive pixels starting
+        // from e.g. point 15 and onwards without any further computation
+        pattern_offset[16] = 0 + width * 3;
+        pattern_offset[17] = 1 + width * 3;
+        pattern_offset[18] = 2 + width * 2;
+        pattern_offset[19] = 3 + width * 1;
+        pattern_offset[20] = 3 + width * 0;
+        pattern_offset[21] = 3 + width * -1;
+        pattern_offset[22] = 2 + width * -2;
+        pattern_offset[23] = 1 + width * -3;
+        pattern_offset[24] = 0 + width * -3;
+
+        // The buffer holds the scores of three rows in flight, its size is
+        // a multiple of 4 in order to do faster clearing
+        //
+        // This pointer array is used to reference the different rows with
+        // scores in flight
+        uint8_t* row_scores[3];
+        row_scores[0] = row_scores_buffer;
+        row_scores[1] = row_scores[0] + width;
+        row_scores[2] = row_scores[1] + width;
+
+        // As with the row scores, we keep a convenience array of pointers for
+        // the corner positions of the different rows in flight.
+        //
+        // Note that the number of corners are kept as the -1'th entry
+        // here: (row_corner_positions[n])[-1] is the amount of corners for the
+        // n'th row. This proved beneficial during profiling. That's why we
+        // append + 1 for the buffer pointers.
+        uint16_t* row_corner_positions[3];
+        row_corner_positions[0] = row_corner_positions_buffer + 1;
+        row_corner_positions[1] = row_corner_positions[0] + width + 1;
+        row_corner_positions[2] = row_corner_positions[1] + width + 1;
+
+        fast_clear_buffer(row_scores[0], width * 3);
+
+        for (j = 3; j < height - 2; j++) {
+
+            uint8_t* current_row_scores = row_scores[(j - 3) % 3];
+
+            // Buffer for the detected corner positions on this row
+            uint16_t* current_row_corner_positions =
+                row_corner_positions[(j - 3) % 3];
+
+            // Number of corners detected on this row
+            uint16_t current_row_number_of_corners = 0;
+
+            if (j < height - 3 && grid == NULL) {
+                current_row_number_of_corners =
+                    Backend::template detect_row<Classifier>(
+                        &image_buffer[j * width],
+                        3,
+                        width - 7,
+                        threshold,
+                        threshold_lookup_table,
+                        pattern_offset,
+                        flags_buffer,
+                        current_row_scores,
+                        current_row_corner_positions);
+            } else if (j < height - 3) {
+                current_row_number_of_corners =
+                    detect_uncovered_row<Backend, Classifier>(
+                        &image_buffer[j * width],
+                        width,
+                        j * grid->rows / height,
+                        threshold,
+                        threshold_lookup_table,
+                        pattern_offset,
+                        *grid,
+                        covered_cells,
+                        flags_buffer,
+                        current_row_scores,
+                        current_row_corner_positions);
+            }
+
+            // Here comes the trick to specify the -1 index of the row corner
+            // positions buffer is the number of corners. Structuring this way
+            // proved beneficial during profiling
+            current_row_corner_positions[-1] = current_row_number_of_corners;
+
+            if (j == 3)
+                continue;
+
+            // Here we check the score of the previous row against the second
+            // previous row and the current row just examined. The one within a
+            // 3x3 grid with the highest score wins and is classified as a
+            // feature
+            const uint8_t* second_previous_row_scores = row_scores[(j - 2) % 3];
+
+            const uint8_t* previous_row_scores = row_scores[(j - 1) % 3];
+            const uint16_t* previous_row_corner_positions =
+                row_corner_positions[(j - 1) % 3];
+            const uint16_t previous_row_number_of_corners =
+                previous_row_corner_positions[-1];
+
+            for (k = 0; k < (int_fast32_t)previous_row_number_of_corners; k++) {
+
+                const uint32_t idx = previous_row_corner_positions[k];
+                const uint8_t previous_row_score = previous_row_scores[idx];
+
+                if ((previous_row_score > previous_row_scores[idx + 1] &&
+                     previous_row_score > previous_row_scores[idx - 1] &&
+                     previous_row_score > second_previous_row_scores[idx - 1] &&
+                     previous_row_score > second_previous_row_scores[idx] &&
+                     previous_row_score > second_previous_row_scores[idx + 1] &&
+                     previous_row_score > current_row_scores[idx - 1] &&
+                     previous_row_score > current_row_scores[idx] &&
+                     previous_row_score > current_row_scores[idx + 1])) {
+
+                    if (statistics != NULL) {
+                        statistics->score_histogram[previous_row_score]++;
+                    }
+
+                    if (!output.add(idx, j - 1, previous_row_score)) {
+
+                        // The corners are suppressed on rows 4 to height - 3
+                        if (statistics != NULL) {
+                            statistics->scanned_fraction =
+                                (float)(j - 4) / (float)(height - 6);
+                        }
+
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    template <typename Backend, typename Classifier>
+    bool BasicFastDetector<Backend, Classifier>::initialise(
+        const size_t width,
+        const uint8_t threshold,
+        uint8_t* scratch,
+        const size_t size) {
+
+        max_width = 0;
+
+        if (size < scratch_size(width)) {
+            logger::errorf("FAST needs %zu bytes of scratch memory for a "
+                           "width of %zu, got %zu\r\n",
+                           scratch_size(width),
+                           width,
+                           size);
+            return false;
+        }
+
+        // The lookup table is first, so the scores stay 4-byte aligned for
+        // clearing them, and the corner positions after them 2-byte aligned
+        threshold_lookup_table      = (uint32_t*)scratch;
+        row_scores_buffer           = scratch + 512 * sizeof(uint32_t);
+        row_corner_positions_buffer = (uint16_t*)(row_scores_buffer +
+                                                  ((width * 3) / 4 + 1) *
+                                                      4);
+        flags_buffer = (uint8_t*)(row_corner_positions_buffer +
+                                  (width + 1) * 3);
+
+        max_width         = width;
+        current_threshold = threshold;
+
+        build_threshold_lookup_table(threshold, threshold_lookup_table);
+
+        return true;
+    }
+
+    template <typename Backend, typename Classifier>
+    void BasicFastDetector<Backend, Classifier>::set_threshold(
+        const uint8_t threshold) {
+
+        // Without scratch memory, there is no table to build yet
+        if (threshold != current_threshold && max_width > 0) {
+            build_threshold_lookup_table(threshold, threshold_lookup_table);
+        }
+
+        current_threshold = threshold;
+    }
+
+    template <typename Backend, typename Classifier>
+    bool BasicFastDetector<Backend, Classifier>::accepts(
+        const image::Image& image,
+        FastStatistics* statistics) const {
+
+        if (statistics != NULL) {
+            memset(statistics->score_histogram,
+                   0,
+                   sizeof(statistics->score_histogram));
+            statistics->threshold        = current_threshold;
+            statistics->scanned_fraction = 1.0f;
+        }
+
+        if (image.width > max_width) {
+            logger::errorf("Image of width %zu is wider than the %zu FAST was "
+                           "set up for\r\n",
+                           image.width,
+                           max_width);
+            return false;
+        }
+
+        return true;
+    }
+
+    template <typename Backend, typename Classifier>
+    SECTION_ITCM void BasicFastDetector<Backend, Classifier>::detect(
+        const image::Image& image,
+        image::KeyPoint* out_keypoints,
+        uint32_t* out_keypoints_size,
+        FastStatistics* out_statistics) const {
+
+        TRACE_ZONE(ZONE_EXTRACT);
+
+        KeyPointOutput output(out_keypoints, out_keypoints_size);
+
+        if (!accepts(image, out_statistics)) {
+            return;
+        }
+
+        detect_corners(image, output, out_statistics);
+    }
+
+    template <typename Backend, typename Classifier>
+    SECTION_ITCM void BasicFastDetector<Backend, Classifier>::detect(
+        image::ImagePyramid& image_pyramid,
+        const Octaves& octaves,
+        image::KeyPoint* out_keypoints,
+        uint32_t* out_keypoints_size) {
+
+        TRACE_ZONE(ZONE_EXTRACT);
+
+        const uint32_t max_number_of_keypoints = *out_keypoints_size;
+        const uint8_t original_threshold       = current_threshold;
+
+        const int32_t levels = octaves.levels < PYRAMID_LEVELS
+                                   ? octaves.levels
+                                   : PYRAMID_LEVELS;
+
+        *out_keypoints_size = 0;
+
+        for (int32_t level = levels - 1; level >= 0; level--) {
+
+            // The levels are narrower than level 0, so the scratch fits them
+            const image::Image& level_image = *image_pyramid.at(level);
+
+            uint32_t level_keypoints_size = max_number_of_keypoints -
+                                            *out_keypoints_size;
+
+            KeyPointOutput output(out_keypoints + *out_keypoints_size,
+                                  &level_keypoints_size,
+                                  (uint8_t)level);
+
+            output.coarser_keypoints      = out_keypoints;
+            output.coarser_keypoints_size = *out_keypoints_size;
+
+            if (!accepts(level_image, NULL)) {
+                break;
+            }
+
+            set_threshold(octaves.thresholds[level]);
+            detect_corners(level_image, output, NULL);
+
+            *out_keypoints_size += level_keypoints_size;
+
+            if (*out_keypoints_size == max_number_of_keypoints) {
+                break;
+            }
+        }
+
+        set_threshold(original_threshold);
+    }
+
+    template <typename Backend, typename Classifier>
+    SECTION_ITCM void BasicFastDetector<Backend, Classifier>::detect(
+        const image::Image& image,
+        const Grid& grid,
+        image::KeyPoint* out_keypoints,
+        uint32_t* out_keypoints_size,
+        FastStatistics* out_statistics) const {
+
+        TRACE_ZONE(ZONE_EXTRACT);
+
+        if (!accepts(image, out_statistics) || !fits_grid(grid)) {
+            *out_keypoints_size = 0;
+            return;
+        }
+
+        GridCorner corners[MAX_GRID_CORNERS];
+        uint8_t corners_size[MAX_GRID_CELLS];
+
+        GridOutput output(grid,
+                          image.width,
+                          image.height,
+                          corners,
+                          corners_size);
+
+        detect_corners(image, output, out_statistics);
+
+        output.write(out_keypoints, out_keypoints_size);
+    }
+
+    template <typename Backend, typename Classifier>
+    SECTION_ITCM void BasicFastDetector<Backend, Classifier>::detect(
+        const image::Image& image,
+        const Anms& anms,
+        image::KeyPoint* out_keypoints,
+        uint32_t* out_keypoints_size,
+        FastStatistics* out_statistics) const {
+
+        TRACE_ZONE(ZONE_EXTRACT);
+
+        static_assert(MAX_ANMS_KEYPOINTS < UINT16_MAX,
+                      "The lists of kept corners are indexed with 16 bits, "
+                      "where UINT16_MAX ends a list");
+
+        const uint32_t max_number_of_keypoints =
+            min(*out_keypoints_size, MAX_ANMS_KEYPOINTS);
+
+        *out_keypoints_size = 0;
+
+        if (!accepts(image, out_statistics)) {
+            return;
+        }
+
+        if (image.width > ANMS_COORDINATE_MASK + 1 ||
+            image.height > ANMS_COORDINATE_MASK + 1) {
+            logger::errorf("Image of %zux%zu is too large for ANMS\r\n",
+                           image.width,
+                           image.height);
+            return;
+        }
+
+        uint32_t candidates_size = anms.capacity;
+        AnmsOutput output(anms.candidates, &candidates_size);
+
+        detect_corners(image, output, out_statistics);
+
+        sort_ascending(anms.candidates, candidates_size);
+
+        const int32_t width  = image.width;
+        const int32_t height = image.height;
+
+        uint32_t kept[MAX_ANMS_KEYPOINTS];
+        uint32_t kept_size = 0;
+
+        if (candidates_size <= max_number_of_keypoints) {
+            memcpy(kept, anms.candidates, candidates_size * sizeof(uint32_t));
+            kept_size = candidates_size;
+        } else if (max_number_of_keypoints > 0) {
+
+            // Fewer corners are kept the larger the radius, and a radius
+            // larger than the diagonal keeps only the strongest one
+            int32_t low  = 1;
+            int32_t high = width + height;
+
+            while (low < high) {
+                const int32_t radius = (low + high) / 2;
+
+                if (suppress_within_radius(anms.candidates,
+                                           candidates_size,
+                                           radius,
+                                           width,
+                                           height,
+                                           max_number_of_keypoints,
+                                           kept) <= max_number_of_keypoints) {
+                    high = radius;
+                } else {
+                    low = radius + 1;
+                }
+            }
+
+            kept_size = suppress_within_radius(anms.candidates,
+                                               candidates_size,
+                                               low,
+                                               width,
+                                               height,
+                                               max_number_of_keypoints,
+                                               kept);
+        }
+
+        for (uint32_t i = 0; i < kept_size; i++) {
+            out_keypoints[i] = image::KeyPoint(
+                kept[i] & ANMS_COORDINATE_MASK,
+                (kept[i] >> ANMS_COORDINATE_BITS) & ANMS_COORDINATE_MASK);
+        }
+
+        *out_keypoints_size = kept_size;
+    }
+
+    template <typename Backend, typename Classifier>
+    SECTION_ITCM void BasicFastDetector<Backend, Classifier>::replenish(
+        const image::Image& image,
+        const Grid& grid,
+        const float exclusion_radius,
+        image::KeyPoint* keypoints,
+        uint32_t* keypoints_size,
+        const uint32_t max_number_of_keypoints,
+        FastStatistics* out_statistics) const {
+
+        TRACE_ZONE(ZONE_EXTRACT);
+
+        const int_fast32_t width  = image.width;
+        const int_fast32_t height = image.height;
+
+        // Remove the keypoints which were lost, so that the new ones can be
+        // appended after the ones still tracked
+        uint32_t number_of_keypoints = 0;
+
+        for (uint32_t i = 0; i < *keypoints_size; i++) {
+            if (!keypoints[i].stale) {
+                keypoints[number_of_keypoints++] = keypoints[i];
+            }
+        }
+
+        *keypoints_size = number_of_keypoints;
+
+        const uint32_t number_of_cells = grid.columns * grid.rows;
+
+        if (!accepts(image, out_statistics) || !fits_grid(grid) ||
+            number_of_keypoints >= max_number_of_keypoints) {
+            return;
+        }
+
+        uint8_t covered_cells[MAX_GRID_CELLS];
+        memset(covered_cells, 0, number_of_cells);
+
+        uint32_t number_of_covered_cells = 0;
+
+        for (uint32_t i = 0; i < number_of_keypoints; i++) {
+
+            const int_fast32_t x = min(max((int_fast32_t)keypoints[i].point.x,
+                                           (int_fast32_t)0),
+                                       width - 1);
+            const int_fast32_t y = min(max((int_fast32_t)keypoints[i].point.y,
+                                           (int_fast32_t)0),
+                                       height - 1);
+
+            const uint32_t cell = (y * grid.rows / height) * grid.columns +
+                                  (x * grid.columns / width);
+
+            if (!covered_cells[cell]) {
+                covered_cells[cell] = 1;
+                number_of_covered_cells++;
+            }
+        }
+
+        if (number_of_covered_cells == number_of_cells) {
+            return;
+        }
+
+        GridCorner corners[MAX_GRID_CORNERS];
+        uint8_t corners_size[MAX_GRID_CELLS];
+
+        GridOutput output(grid, width, height, corners, corners_size);
+
+        output.covered_cells            = covered_cells;
+        output.existing_keypoints       = keypoints;
+        output.existing_keypoints_size  = number_of_keypoints;
+        output.exclusion_radius_squared = exclusion_radius * exclusion_radius;
+
+        detect_corners(image, output, out_statistics, &grid, covered_cells);
+
+        uint32_t number_of_new_keypoints = max_number_of_keypoints -
+                                           number_of_keypoints;
+
+        output.write(keypoints + number_of_keypoints, &number_of_new_keypoints);
+
+        *keypoints_size += number_of_new_keypoints;
+    }
+
+    uint8_t adapt_threshold(const ThresholdController& controller,
+                            const FastStatistics& statistics) {
+
+        // The corners of the rows which were not scanned are assumed to be
+        // like the ones of the rows which were
+        const float scale = statistics.scanned_fraction > 0
+                                ? 1.0f / statistics.scanned_fraction
+                                : 1.0f;
+
+        // Number of corners found at every threshold above the last one
+        uint32_t counts[257];
+        counts[256] = 0;
+
+        for (int score = 255; score >= 0; score--) {
+            counts[score] = counts[score + 1] +
+                            statistics.score_histogram[score];
+        }
+
+        const int threshold = statistics.threshold;
+        const float target  = controller.target;
+        const float found   = counts[threshold] * scale;
+
+        int next_threshold = threshold;
+
+        if (found > target) {
+            while (next_threshold < 255 &&
+                   counts[next_threshold] * scale > target) {
+                next_threshold++;
+            }
+        } else if (found < target * 0.75f && counts[threshold] == 0) {
+            next_threshold = threshold / 2;
+        } else if (found < target * 0.75f) {
+
+            // The count is assumed to double for every step it halves in
+            // above the last threshold
+            int half_threshold = threshold;
+
+            while (half_threshold < 255 &&
+                   counts[half_threshold] * 2 > counts[threshold]) {
+                half_threshold++;
+            }
+
+            const float doublings = log2f(target / found);
+
+            next_threshold = max(
+                threshold - (int)ceilf((half_threshold - threshold) *
+                                       doublings),
+                threshold / 2);
+        }
+
+        return (uint8_t)min(max(next_threshold,
+                                (int)controller.minimum_threshold),
+                            (int)controller.maximum_threshold);
+    }
+
+    /**
+     * @return The scratch memory of a detector in whole words, so that it is
+     * 4-byte aligned on the stack.
+     */
+    template <typename Backend>
+    static constexpr size_t scratch_words(const size_t width) {
+        return (BasicFastDetector<Backend>::scratch_size(width) +
+                sizeof(uint32_t) - 1) /
+               sizeof(uint32_t);
+    }
+
+    template <typename Backend>
+    SECTION_ITCM void extract_features(const uint8_t* image_buffer,
+                                       const int_fast32_t width,
+                                       const int_fast32_t height,
+                                       const uint8_t threshold,
+                                       image::KeyPoint* out_keypoints,
+                                       uint32_t* out_keypoints_size) {
+
+        uint32_t scratch[scratch_words<Backend>(width)];
+
+        BasicFastDetector<Backend> detector;
+        detector.initialise(width,
+                            threshold,
+                            (uint8_t*)scratch,
+                            sizeof(scratch));
+        detector.detect(image::Image((uint8_t*)image_buffer, width, height),
+                        out_keypoints,
+                        out_keypoints_size);
+    }
+
+    template <typename Backend>
+    SECTION_ITCM void extract_features(const uint8_t* image_buffer,
+                                       const int_fast32_t width,
+                                       const int_fast32_t height,
+                                       const uint8_t threshold,
+                                       const Grid& grid,
+                                       image::KeyPoint* out_keypoints,
+                                       uint32_t* out_keypoints_size) {
+
+        uint32_t scratch[scratch_words<Backend>(width)];
+
+        BasicFastDetector<Backend> detector;
+        detector.initialise(width,
+                            threshold,
+                            (uint8_t*)scratch,
+                            sizeof(scratch));
+        detector.detect(image::Image((uint8_t*)image_buffer, width, height),
+                        grid,
+                        out_keypoints,
+                        out_keypoints_size);
+    }
+
+    template <typename Backend>
+    SECTION_ITCM void
+    replenish_features(const uint8_t* image_buffer,
+                       const int_fast32_t width,
+                       const int_fast32_t height,
+                       const uint8_t threshold,
+                       const Grid& grid,
+                       const float exclusion_radius,
+                       image::KeyPoint* keypoints,
+                       uint32_t* keypoints_size,
+                       const uint32_t max_number_of_keypoints) {
+
+        uint32_t scratch[scratch_words<Backend>(width)];
+
+        BasicFastDetector<Backend> detector;
+        detector.initialise(width,
+                            threshold,
+                            (uint8_t*)scratch,
+                            sizeof(scratch));
+        detector.replenish(image::Image((uint8_t*)image_buffer, width, height),
+                           grid,
+                           exclusion_radius,
+                           keypoints,
+                           keypoints_size,
+                           max_number_of_keypoints);
+    }
+
+#define INSTANTIATE_BACKEND(Backend)                                           \
+    template void extract_features<Backend>(const uint8_t*,                    \
+                                            const int_fast32_t,                \
+                                            const int_fast32_t,                \
+                                            const uint8_t,                     \
+                                            image::KeyPoint*,                  \
+                                            uint32_t*);                        \
+    template void extract_features<Backend>(const uint8_t*,                    \
+                                            const int_fast32_t,                \
+                                            const int_fast32_t,                \
+                                            const uint8_t,                     \
+                                            const Grid&,                       \
+                                            image::KeyPoint*,                  \
+                                            uint32_t*);                        \
+    template void replenish_features<Backend>(const uint8_t*,                  \
+                                              const int_fast32_t,              \
+                                              const int_fast32_t,              \
+                                              const uint8_t,                   \
+                                              const Grid&,                     \
+                                              const float,                     \
+                                              image::KeyPoint*,                \
+                                              uint32_t*,                       \
+                                              const uint32_t);                 \
+    template class BasicFastDetector<Backend>;
+
+    INSTANTIATE_BACKEND(fast::Armv7em)
+
+#if defined(__SSE2__)
+    INSTANTIATE_BACKEND(fast::Sse2)
+#endif
+
+#if defined(__AVX2__)
+    INSTANTIATE_BACKEND(fast::Avx2)
+#endif
+
+#if defined(__ARM_NEON)
+    INSTANTIATE_BACKEND(fast::Neon)
+#endif
+
+#ifndef CPU_MIMXRT1166DVM6A
+    // The segment mask is only compared against the mask chain on the host,
+    // so that the target does not spend ITCM on a second copy of FAST
+    template class BasicFastDetector<fast::Armv7em, fast::SegmentMask>;
+
+    #if defined(__SSE2__)
+    template class BasicFastDetector<fast::Sse2, fast::SegmentMask>;
+    #endif
+
+    #if defined(__AVX2__)
+    template class BasicFastDetector<fast::Avx2, fast::SegmentMask>;
+    #endif
+
+    #if defined(__ARM_NEON)
+    template class BasicFastDetector<fast::Neon, fast::SegmentMask>;
+    #endif
+#endif
+
+    void extract_features(const uint8_t* image_buffer,
+                          const int_fast32_t width,
+                          const int_fast32_t height,
+                          const uint8_t threshold,
+                          image::KeyPoint* out_keypoints,
+                          uint32_t* out_keypoints_size) {
+        extract_features<fast::DefaultBackend>(image_buffer,
+                                               width,
+                                               height,
+                                               threshold,
+                                               out_keypoints,
+                                               out_keypoints_size);
+    }
+
+    void extract_features(const uint8_t* image_buffer,
+                          const int_fast32_t width,
+                          const int_fast32_t height,
+                          const uint8_t threshold,
+                          const Grid& grid,
+                          image::KeyPoint* out_keypoints,
+                          uint32_t* out_keypoints_size) {
+        extract_features<fast::DefaultBackend>(image_buffer,
+                                               width,
+                                               height,
+                                               threshold,
+                                               grid,
+                                               out_keypoints,
+                                               out_keypoints_size);
+    }
+
+    void replenish_features(const uint8_t* image_buffer,
+                            const int_fast32_t width,
+                            const int_fast32_t height,
+                            const uint8_t threshold,
+                            const Grid& grid,
+                            const float exclusion_radius,
+                            image::KeyPoint* keypoints,
+                            uint32_t* keypoints_size,
+                            const uint32_t max_number_of_keypoints) {
+        replenish_features<fast::DefaultBackend>(image_buffer,
+                                                 width,
+                                                 height,
+                                                 threshold,
+                                                 grid,
+                                                 exclusion_radius,
+                                                 keypoints,
+                                                 keypoints_size,
+                                                 max_number_of_keypoints);
     }
 }
@@ -10,7 +10,190 @@
 namespace frontend {
 
     /**
-     * @brief Performs FAST on a given image.
+     * @brief Backends for the candidate checks in FAST, selected at compile
+     * time through the template parameter of extract_features. All backends
+     * yield identical keypoints.
+     *
+     * The segment tests, which decide if a candidate which passed the checks
+     * of the backend is a corner, are selected through the second template
+     * parameter of BasicFastDetector, and yield identical keypoints as well.
+     */
+    namespace fast {
+
+        /**
+         * @brief 32 bit ARMv7E-M SIMD instructions, 4 candidates at a time.
+         * Used on the target, and available on the host through the portable
+         * implementations of the instructions.
+         */
+        struct Armv7em;
+
+#if defined(__SSE2__)
+        /**
+         * @brief SSE2, 16 candidates at a time.
+         */
+        struct Sse2;
+#endif
+
+#if defined(__AVX2__)
+        /**
+         * @brief AVX2, 32 candidates at a time.
+         */
+        struct Avx2;
+#endif
+
+#if defined(__ARM_NEON)
+        /**
+         * @brief NEON, 16 candidates at a time.
+         */
+        struct Neon;
+#endif
+
+#if defined(CPU_MIMXRT1166DVM6A)
+        typedef Armv7em DefaultBackend;
+#elif defined(__AVX2__)
+        typedef Avx2 DefaultBackend;
+#elif defined(__SSE2__)
+        typedef Sse2 DefaultBackend;
+#elif defined(__ARM_NEON)
+        typedef Neon DefaultBackend;
+#else
+        typedef Armv7em DefaultBackend;
+#endif
+
+        /**
+         * @brief Rejects the candidate on the lookup table along the 8
+         * diagonals, then walks the pattern for the consecutive pixels.
+         */
+        struct MaskChain;
+
+        /**
+         * @brief Compares all 16 pattern pixels into a bitmask per polarity
+         * and looks them up in a table of the masks with 9 consecutive bits,
+         * which is generated at compile time. Only instantiated on the host.
+         */
+        struct SegmentMask;
+    }
+
+    /**
+     * @brief Grid used to spread the keypoints evenly over the image.
+     */
+    struct Grid {
+        /**
+         * @brief Number of cells along the x axis.
+         */
+        uint8_t columns;
+
+        /**
+         * @brief Number of cells along the y axis.
+         */
+        uint8_t rows;
+
+        /**
+         * @brief The maximum amount of keypoints kept in each cell, the ones
+         * with the highest corner score are kept.
+         */
+        uint8_t keypoints_per_cell;
+    };
+
+    /**
+     * @brief Most cells of a Grid, and most corners kept over all of its
+     * cells, so that the stack use of a grid detection does not depend on
+     * the grid. Larger grids are rejected.
+     */
+    constexpr uint32_t MAX_GRID_CELLS   = 256;
+    constexpr uint32_t MAX_GRID_CORNERS = 512;
+
+    /**
+     * @brief Adaptive non-maximal suppression, which selects keypoints spread
+     * evenly over the image from all the corners of a detection, see
+     * BasicFastDetector::detect.
+     */
+    struct Anms {
+        /**
+         * @brief Memory for the corners found before the selection, one word
+         * per corner.
+         */
+        uint32_t* candidates;
+
+        /**
+         * @brief Number of corners @p candidates can hold. The detection
+         * stops at the corners which do not fit, as it does for the keypoint
+         * buffer without ANMS.
+         */
+        uint32_t capacity;
+    };
+
+    /**
+     * @brief Most keypoints a detection with Anms keeps, so that its stack
+     * use does not depend on the size of the keypoint buffer. Larger buffers
+     * are filled up to it.
+     */
+    constexpr uint32_t MAX_ANMS_KEYPOINTS = 512;
+
+    /**
+     * @brief The corners found by a detection, from which adapt_threshold
+     * predicts how many corners a detection with another threshold finds.
+     */
+    struct FastStatistics {
+        /**
+         * @brief Number of corners surviving the non-maximum suppression per
+         * corner score, including the ones which did not fit in the keypoint
+         * buffer. A corner is found at every threshold up to its score.
+         */
+        uint32_t score_histogram[256];
+
+        /**
+         * @brief The threshold of the detection.
+         */
+        uint8_t threshold;
+
+        /**
+         * @brief Fraction of the rows scanned, less than 1 if the detection
+         * stopped early as the keypoint buffer was full.
+         */
+        float scanned_fraction;
+    };
+
+    /**
+     * @brief Target of adapt_threshold.
+     */
+    struct ThresholdController {
+        /**
+         * @brief Number of corners a detection should find.
+         */
+        uint32_t target = 0;
+
+        uint8_t minimum_threshold = 10;
+        uint8_t maximum_threshold = 200;
+    };
+
+    /**
+     * @brief Pyramid levels scanned by the multi-scale detection of
+     * BasicFastDetector::detect.
+     */
+    struct Octaves {
+        /**
+         * @brief Number of levels scanned, from level 0 up to at most
+         * PYRAMID_LEVELS.
+         */
+        uint8_t levels;
+
+        /**
+         * @brief Threshold of every level, as the averaged and blurred levels
+         * have less contrast than the full resolution.
+         */
+        uint8_t thresholds[PYRAMID_LEVELS];
+    };
+
+    /**
+     * @brief Performs FAST on a given image with the fast::DefaultBackend for
+     * the platform.
+     *
+     * The free functions set up a BasicFastDetector for the width of the
+     * image on every call, with its scratch memory on the stack, so they are
+     * reentrant but their stack use grows with the width (about 9.6 KB for
+     * MAX_IMAGE_WIDTH). Use a BasicFastDetector of your own to keep the
+     * scratch memory elsewhere and the lookup table between detections.
      *
      * @param image_buffer [in] Buffer for the image.
      * @param width [in] The width of the image.
@@ -29,6 +212,270 @@ namespace frontend {
                           image::KeyPoint* out_keypoints,
                           uint32_t* out_keypoints_size);
 
+    /**
+     * @brief Performs FAST on a given image with the given @p Backend, see
+     * fast. Instantiated for the backends available on the platform.
+     */
+    template <typename Backend>
+    void extract_features(const uint8_t* image_buffer,
+                          const int_fast32_t width,
+                          const int_fast32_t height,
+                          const uint8_t threshold,
+                          image::KeyPoint* out_keypoints,
+                          uint32_t* out_keypoints_size);
+
+    /**
+     * @brief Performs FAST on a given image and keeps the corners with the
+     * highest score in every cell of the @p grid, instead of the first corners
+     * in raster order. The best corner of every cell is placed first in @p
+     * out_keypoints, then the second best of every cell and so on. If the
+     * buffer can not hold all of them, the last rank which fits partially is
+     * filled with its corners with the highest score.
+     *
+     * @param image_buffer [in] Buffer for the image.
+     * @param width [in] The width of the image.
+     * @param height [in] The height of the image.
+     * @param threshold [in] Threshold used for determining if a pixel is a
+     * corner/feature or not.
+     * @param grid [in] The grid the image is split into.
+     * @param out_keypoints [out] Features/corners detected are placed in
+     * this buffer.
+     * @param out_keypoints_size [in-out] Size of the keypoint buffer, the
+     * number of features/corners detected are placed in this integer pointer.
+     */
+    void extract_features(const uint8_t* image_buffer,
+                          const int_fast32_t width,
+                          const int_fast32_t height,
+                          const uint8_t threshold,
+                          const Grid& grid,
+                          image::KeyPoint* out_keypoints,
+                          uint32_t* out_keypoints_size);
+
+    /**
+     * @brief Grid variant of extract_features with the given @p Backend.
+     */
+    template <typename Backend>
+    void extract_features(const uint8_t* image_buffer,
+                          const int_fast32_t width,
+                          const int_fast32_t height,
+                          const uint8_t threshold,
+                          const Grid& grid,
+                          image::KeyPoint* out_keypoints,
+                          uint32_t* out_keypoints_size);
+
+
+    /**
+     * @brief Replenishes the @p keypoints with new corners, where only the
+     * cells of the @p grid which do not contain any of the keypoints still
+     * tracked are scanned. The new corners are selected as in the grid variant
+     * of extract_features and appended after the existing keypoints, so that
+     * the tracks which survived are kept. As covered cells are not scanned,
+     * a corner next to a covered cell is not suppressed by a stronger corner
+     * inside of it.
+     *
+     * @param image_buffer [in] Buffer for the image.
+     * @param width [in] The width of the image.
+     * @param height [in] The height of the image.
+     * @param threshold [in] Threshold used for determining if a pixel is a
+     * corner/feature or not.
+     * @param grid [in] The grid the image is split into.
+     * @param exclusion_radius [in] New corners closer than this to one of the
+     * existing keypoints are rejected.
+     * @param keypoints [in-out] The existing keypoints. Stale keypoints are
+     * removed, and the new corners are appended.
+     * @param keypoints_size [in-out] The number of keypoints.
+     * @param max_number_of_keypoints [in] Size of the keypoint buffer.
+     */
+    void replenish_features(const uint8_t* image_buffer,
+                            const int_fast32_t width,
+                            const int_fast32_t height,
+                            const uint8_t threshold,
+                            const Grid& grid,
+                            const float exclusion_radius,
+                            image::KeyPoint* keypoints,
+                            uint32_t* keypoints_size,
+                            const uint32_t max_number_of_keypoints);
+
+    /**
+     * @brief replenish_features with the given @p Backend.
+     */
+    template <typename Backend>
+    void replenish_features(const uint8_t* image_buffer,
+                            const int_fast32_t width,
+                            const int_fast32_t height,
+                            const uint8_t threshold,
+                            const Grid& grid,
+                            const float exclusion_radius,
+                            image::KeyPoint* keypoints,
+                            uint32_t* keypoints_size,
+                            const uint32_t max_number_of_keypoints);
+
+    /**
+     * @brief FAST with the given @p Backend and the segment test
+     * @p Classifier, set up once for images up to a width and for a
+     * threshold. The threshold lookup table is only rebuilt when the
+     * threshold changes, and the scores and corner positions of the rows in
+     * flight are kept in scratch memory placed by the caller (e.g. in DTCM),
+     * so the stack use does not grow with the width of the image. The stack
+     * use is bounded instead by the corners a detection keeps: about 3 KB
+     * for the MAX_GRID_CORNERS of a grid and about 5 KB for the
+     * MAX_ANMS_KEYPOINTS of Anms and its suppression grid.
+     *
+     * The free functions above set up a detector with its scratch memory on
+     * the stack for every call.
+     */
+    template <typename Backend, typename Classifier = fast::MaskChain>
+    class BasicFastDetector {
+      public:
+        /**
+         * @return The number of bytes of scratch memory for images up to
+         * @p width pixels wide: the threshold lookup table, the scores
+         * and the corner positions of three rows, and the flags of a row for
+         * the wide backends.
+         */
+        static constexpr size_t scratch_size(const size_t width) {
+            return 512 * sizeof(uint32_t) + ((width * 3) / 4 + 1) * 4 +
+                   (width + 1) * 3 * sizeof(uint16_t) + width;
+        }
+
+        /**
+         * @brief Sets the detector up for images up to @p width pixels
+         * wide and builds the lookup table for @p threshold.
+         *
+         * @param scratch [in] Scratch memory of @p size bytes, 4-byte
+         * aligned, which has to hold scratch_size(width) bytes. It is
+         * used by the detector until it is set up again.
+         *
+         * @return False if the scratch memory is too small, in which case
+         * the detector does not find any corners.
+         */
+        bool initialise(const size_t width,
+                        const uint8_t threshold,
+                        uint8_t* scratch,
+                        const size_t size);
+
+        /**
+         * @brief Changes the threshold, the lookup table is only rebuilt if
+         * it differs from the current one.
+         */
+        void set_threshold(const uint8_t threshold);
+
+        uint8_t threshold() const { return current_threshold; }
+
+        /**
+         * @brief extract_features on @p image.
+         *
+         * @param out_statistics [out] If not NULL, the scores of the corners
+         * for adapt_threshold.
+         */
+        void detect(const image::Image& image,
+                    image::KeyPoint* out_keypoints,
+                    uint32_t* out_keypoints_size,
+                    FastStatistics* out_statistics = NULL) const;
+
+        /**
+         * @brief Grid variant of extract_features on @p image.
+         */
+        void detect(const image::Image& image,
+                    const Grid& grid,
+                    image::KeyPoint* out_keypoints,
+                    uint32_t* out_keypoints_size,
+                    FastStatistics* out_statistics = NULL) const;
+
+        /**
+         * @brief Detects all the corners of @p image into the candidates of
+         * @p anms, then keeps the ones which are further than a suppression
+         * radius from every stronger kept corner. The radius is the smallest
+         * one which keeps at most *@p out_keypoints_size corners, found by a
+         * binary search. The keypoints are written by descending score.
+         */
+        void detect(const image::Image& image,
+                    const Anms& anms,
+                    image::KeyPoint* out_keypoints,
+                    uint32_t* out_keypoints_size,
+                    FastStatistics* out_statistics = NULL) const;
+
+        /**
+         * @brief replenish_features on @p image. The statistics only cover
+         * the cells which are scanned.
+         */
+        void replenish(const image::Image& image,
+                       const Grid& grid,
+                       const float exclusion_radius,
+                       image::KeyPoint* keypoints,
+                       uint32_t* keypoints_size,
+                       const uint32_t max_number_of_keypoints,
+                       FastStatistics* out_statistics = NULL) const;
+
+        /**
+         * @brief Multi-scale extract_features on the levels of
+         * @p image_pyramid given by @p octaves, each with its own threshold.
+         * The corners are mapped back to the centre of their block of level 0
+         * pixels and tagged with their level in image::KeyPoint::octave.
+         * Corners within one pixel of the level of a corner kept on a coarser
+         * level are dropped, so that a corner is not kept once per level.
+         * The coarsest level is scanned first, so its corners, which survive
+         * the largest motion, are kept when the keypoint buffer fills. The
+         * threshold is restored afterwards.
+         */
+        void detect(image::ImagePyramid& image_pyramid,
+                    const Octaves& octaves,
+                    image::KeyPoint* out_keypoints,
+                    uint32_t* out_keypoints_size);
+
+      private:
+        /**
+         * @brief Runs FAST and passes the corners surviving the non-maximum
+         * suppression to @p output in raster order.
+         *
+         * @param grid [in] If not NULL, only the cells of this grid which are
+         * not marked in @p covered_cells are scanned.
+         */
+        template <typename Output>
+        void detect_corners(const image::Image& image,
+                            Output& output,
+                            FastStatistics* statistics,
+                            const Grid* grid             = NULL,
+                            const uint8_t* covered_cells = NULL) const;
+
+        /**
+         * @return True if @p image can be processed, otherwise logs why not.
+         * Resets @p statistics either way.
+         */
+        bool accepts(const image::Image& image,
+                     FastStatistics* statistics) const;
+
+        size_t max_width          = 0;
+        uint8_t current_threshold = 0;
+
+        /**
+         * @brief The parts of the scratch memory, see scratch_size.
+         */
+        uint32_t* threshold_lookup_table      = NULL;
+        uint8_t* row_scores_buffer            = NULL;
+        uint16_t* row_corner_positions_buffer = NULL;
+        uint8_t* flags_buffer                 = NULL;
+    };
+
+    typedef BasicFastDetector<fast::DefaultBackend> FastDetector;
+
+    /**
+     * @brief Chooses the threshold of the next detection from the corners of
+     * the last one, so that it finds about @p controller.target corners. This
+     * bounds the time spent on scoring corners which are thrown away, and
+     * lowers the threshold in images with little texture.
+     *
+     * Raising the threshold keeps exactly the corners with a score of at
+     * least the new threshold, as a corner is only suppressed by stronger
+     * ones, so the count above the last threshold is read from the
+     * histogram. Below it, the count is extrapolated from how quickly it
+     * grows towards the last threshold. Counts which stay within a quarter
+     * below the target keep the threshold.
+     *
+     * @return The new threshold, within the limits of @p controller.
+     */
+    uint8_t adapt_threshold(const ThresholdController& controller,
+                            const FastStatistics& statistics);
 }
 
 #endif
@@ -1,207 +1,1157 @@
 #include "feature_tracking.h"
 
+#include "trace.h"
+
 #include <math.h>
+#include <string.h>
+
+#include "board.h"
+
+/**
+ * @brief Fractional bits of the bilinear weights in the fixed-point tracker,
+ * which also makes the interpolated intensities Q7.
+ */
+#define WEIGHT_FRACTION_BITS (7)
+
+/**
+ * @brief Fractional bits of the flow in the fixed-point tracker.
+ */
+#define FLOW_FRACTION_BITS (16)
+
+static_assert(FLOW_FRACTION_BITS == PATCH_FRACTION_BITS,
+              "The fraction of the patches is added to the flow as is");
 
-#ifdef CPU_MIMXRT1166DVM6A
-    #include "board.h"
-#else
-    #define SECTION_ITCM
-#endif
+/**
+ * @brief The fixed-point tracker stops iterating when the incremental flow is
+ * at most 0.01 pixels, as the float tracker.
+ */
+#define FLOW_THRESHOLD ((int64_t)(0.01 * (1 << FLOW_FRACTION_BITS)))
+
+/**
+ * @brief Number of features the trackers keep the state of at a time.
+ * Larger patch pyramids are tracked in batches, so that the memory of the
+ * tracker does not grow with their capacity.
+ */
+#define TRACKING_BATCH_SIZE (MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL)
 
 namespace frontend {
 
-    void track_features(image::PatchPyramid& previous_patch_pyramid,
-                        image::ImagePyramid& next_image_pyramid,
-                        image::KeyPoint* previous_keypoints,
-                        image::KeyPoint* next_keypoints,
-                        const size_t previous_keypoints_size) {
+    /**
+     * @return The number of pixels in a patch of @p size, rounded up to an
+     * even number so that the patch can be processed in pairs of 16 bit
+     * values.
+     */
+    static constexpr int_fast32_t padded_area(const uint16_t size) {
+        return ((size * size) + 1) & ~1;
+    }
+
+    /**
+     * @brief The state of the float tracker for a batch of features at the
+     * current pyramid level, stored as a structure of arrays so that every
+     * iteration runs over the whole set of active features.
+     */
+    template <uint16_t Size> struct TrackingState {
+        /**
+         * @brief The x and y gradients of the previous patches (the steepest
+         * descent images, i.e. the rows of A^T). The patches are
+         * interpolated to sub-pixel positions, so the gradients are floats
+         * as the H^-1 computed from them.
+         */
+        float gradient_x[TRACKING_BATCH_SIZE][Size * Size];
+        float gradient_y[TRACKING_BATCH_SIZE][Size * Size];
+
+        /**
+         * @brief The entries of H^-1.
+         */
+        float Hinv_xx[TRACKING_BATCH_SIZE];
+        float Hinv_xy[TRACKING_BATCH_SIZE];
+        float Hinv_yx[TRACKING_BATCH_SIZE];
+        float Hinv_yy[TRACKING_BATCH_SIZE];
+
+        /**
+         * @brief The flow from the level above, upsampled to this level.
+         */
+        float guess_x[TRACKING_BATCH_SIZE];
+        float guess_y[TRACKING_BATCH_SIZE];
+
+        /**
+         * @brief The flow found at this level, relative to the guess.
+         */
+        float flow_x[TRACKING_BATCH_SIZE];
+        float flow_y[TRACKING_BATCH_SIZE];
+
+        /**
+         * @brief The sum of the absolute intensity differences at the last
+         * accepted iteration.
+         */
+        float norm[TRACKING_BATCH_SIZE];
+
+        uint8_t iterations[TRACKING_BATCH_SIZE];
+
+        /**
+         * @brief True for the features rejected at any level so far, which
+         * are not tracked any further.
+         */
+        bool rejected[TRACKING_BATCH_SIZE];
+
+        /**
+         * @brief Indices of the features tracked at this level.
+         */
+        uint8_t features[TRACKING_BATCH_SIZE];
+        size_t features_size;
+
+        /**
+         * @brief Indices of the features which have not converged yet.
+         */
+        uint8_t active[TRACKING_BATCH_SIZE];
+        size_t active_size;
+    };
+
+    /**
+     * @brief Kept outside of the stack as it is too large for it on the
+     * target.
+     */
+    template <uint16_t Size> static TrackingState<Size> tracking_state;
+
+    /**
+     * @brief The state of the fixed-point tracker for a batch of features.
+     */
+    template <uint16_t Levels> struct FixedPointTrackingState {
+        /**
+         * @brief The flow of every feature at every pyramid level, with
+         * FLOW_FRACTION_BITS fractional bits.
+         */
+        int32_t pyramid_level_flow[TRACKING_BATCH_SIZE][Levels][2];
+
+        /**
+         * @brief True for the features rejected at any level so far, see
+         * TrackingState::rejected.
+         */
+        bool rejected[TRACKING_BATCH_SIZE];
+    };
+
+    /**
+     * @brief Kept outside of the stack, as the tracking_state.
+     */
+    template <uint16_t Levels>
+    static FixedPointTrackingState<Levels> fixed_point_tracking_state;
+
+    /**
+     * @brief Warps the next image to the patch at @p x, @p y with bilinear
+     * interpolation (as image::Patch, but without the border) and places the
+     * negated difference to @p previous_image_patch in @p b.
+     *
+     * @return The sum of the absolute differences.
+     */
+    template <uint16_t Size>
+    SECTION_ITCM static float
+    warp_difference(const image::BasicPatch<Size>& previous_image_patch,
+                    const float x,
+                    const float y,
+                    const image::Image& image,
+                    float b[Size * Size]) {
+
+        const int_fast32_t start_point_x = floor(x);
+        const int_fast32_t start_point_y = floor(y);
+
+        // The patch and the extra row and column used for the interpolation
+        uint8_t buffer[(Size + 1) * (Size + 1)];
+
+        for (int_fast32_t j = 0; j < Size + 1; j++) {
+
+            // Extrapolate with the intensity values at the border of the
+            // image, as done for image::Patch
+            int_fast32_t ys = start_point_y + j;
+            ys = ys < 0 ? 0 : ys > (int_fast32_t)image.height - 1
+                                  ? image.height - 1
+                                  : ys;
+
+            for (int_fast32_t i = 0; i < Size + 1; i++) {
+
+                int_fast32_t xs = start_point_x + i;
+                xs = xs < 0 ? 0 : xs > (int_fast32_t)image.width - 1
+                                      ? image.width - 1
+                                      : xs;
+
+                buffer[j * (Size + 1) + i] =
+                    image.data[ys * image.width + xs];
+            }
+        }
+
+        const float alpha_x = abs(x - start_point_x);
+        const float alpha_y = abs(y - start_point_y);
+
+        float norm = 0;
+
+        for (int_fast32_t j = 0; j < Size; j++) {
+
+            const float* previous_row = previous_image_patch.row(j);
+
+            for (int_fast32_t i = 0; i < Size; i++) {
+
+                const float I = buffer[j * (Size + 1) + i];
+                const float I_x_shift = buffer[j * (Size + 1) + i + 1];
+                const float I_y_shift = buffer[(j + 1) * (Size + 1) + i];
+                const float I_xy_shift =
+                    buffer[(j + 1) * (Size + 1) + i + 1];
+
+                const float next = (1 - alpha_x) * (1 - alpha_y) * I +
+                                   alpha_x * (1 - alpha_y) * I_x_shift +
+                                   (1 - alpha_x) * alpha_y * I_y_shift +
+                                   alpha_x * alpha_y * I_xy_shift;
+
+                const float It = next - previous_row[i];
+
+                norm += fabs(It);
+
+                b[j * Size + i] = -It;
+            }
+        }
+
+        return norm;
+    }
+
+    /**
+     * @return The smallest eigenvalue of the structure tensor
+     * [xx xy; xy yy] divided by the area of a patch of @p size.
+     */
+    static float min_eigenvalue(const float xx,
+                                const float xy,
+                                const float yy,
+                                const uint16_t size) {
+
+        const float half_difference = (xx - yy) / 2;
+
+        return ((xx + yy) / 2 -
+                sqrtf(half_difference * half_difference + xy * xy)) /
+               (float)(size * size);
+    }
+
+    /**
+     * @return The smallest eigenvalue of the structure tensor of @p patch per
+     * pixel, see TrackQuality::min_eigenvalue.
+     */
+    template <uint16_t Size>
+    static float min_eigenvalue(const image::BasicPatch<Size>& patch) {
+
+        image::BasicPatch<Size> patch_dx, patch_dy;
+        image::dx(patch, patch_dx);
+        image::dy(patch, patch_dy);
+
+        float H_xx = 0, H_yy = 0, H_xy = 0;
+
+        for (int_fast32_t j = 0; j < Size; j++) {
+            for (int_fast32_t i = 0; i < Size; i++) {
+
+                const float Ix = patch_dx.row(j)[i];
+                const float Iy = patch_dy.row(j)[i];
+
+                H_xx += Ix * Ix;
+                H_yy += Iy * Iy;
+                H_xy += Ix * Iy;
+            }
+        }
+
+        return min_eigenvalue(H_xx, H_xy, H_yy, Size);
+    }
+
+    /**
+     * @brief Computes the gradients and H^-1 of the patch of
+     * @p feature_index in @p state.
+     *
+     * @return False if H is non-invertible.
+     */
+    template <uint16_t Size>
+    static bool
+    construct_template(const image::BasicPatch<Size>& previous_image_patch,
+                       const int_fast32_t feature_index,
+                       TrackingState<Size>& state) {
+
+        image::BasicPatch<Size> previous_patch_dx, previous_patch_dy;
+        image::dx(previous_image_patch, previous_patch_dx);
+        image::dy(previous_image_patch, previous_patch_dy);
+
+        float H_xx = 0, H_yy = 0, H_xy = 0;
+
+        for (int_fast32_t j = 0; j < Size; j++) {
+            for (int_fast32_t i = 0; i < Size; i++) {
+
+                const float Ix = previous_patch_dx.row(j)[i];
+                const float Iy = previous_patch_dy.row(j)[i];
+
+                H_xx += Ix * Ix;
+                H_yy += Iy * Iy;
+
+                H_xy += Ix * Iy;
+
+                state.gradient_x[feature_index][j * Size + i] = Ix;
+                state.gradient_y[feature_index][j * Size + i] = Iy;
+            }
+        }
+
+        const float H_determinant = H_xx * H_yy - H_xy * H_xy;
+        const float H_trace       = H_xx + H_yy;
+
+        // A nearly singular H gives an H^-1 which is not finite. It is
+        // rejected with a bound rather than by testing H^-1 for infinity or
+        // NaN, which the release build assumes never occur (-Ofast)
+        if (H_determinant <= FLT_EPSILON * H_trace * H_trace) {
+            return false;
+        }
+
+        state.Hinv_xx[feature_index] = H_yy / H_determinant;
+        state.Hinv_yy[feature_index] = H_xx / H_determinant;
+        state.Hinv_xy[feature_index] = -H_xy / H_determinant;
+        state.Hinv_yx[feature_index] = -H_xy / H_determinant;
+
+        return true;
+    }
+
+    /**
+     * @brief Marks the keypoints beyond @p capacity as stale, as there are no
+     * patches for them to be tracked with.
+     *
+     * @return The number of keypoints which can be tracked.
+     */
+    static size_t mark_beyond_capacity(const size_t capacity,
+                                       image::KeyPoint* next_keypoints,
+                                       const size_t previous_keypoints_size) {
+
+        for (size_t i = capacity; i < previous_keypoints_size; i++) {
+            next_keypoints[i].stale = true;
+        }
+
+        return previous_keypoints_size < capacity ? previous_keypoints_size
+                                                  : capacity;
+    }
+
+    /**
+     * @brief Carries the octave each keypoint was detected on over to its
+     * tracked position.
+     */
+    static void copy_octaves(const image::KeyPoint* previous_keypoints,
+                             image::KeyPoint* next_keypoints,
+                             const size_t size) {
+
+        for (size_t i = 0; i < size; i++) {
+            next_keypoints[i].octave = previous_keypoints[i].octave;
+        }
+    }
+
+    /**
+     * @brief Resets the @p size entries of @p out_quality, if not NULL, for
+     * the keypoints which are not stale.
+     */
+    static void reset_quality(const image::KeyPoint* keypoints,
+                              TrackQuality* out_quality,
+                              const size_t size) {
+
+        if (out_quality == NULL) {
+            return;
+        }
+
+        for (size_t i = 0; i < size; i++) {
+            if (!keypoints[i].stale) {
+                out_quality[i].residual               = INFINITY;
+                out_quality[i].min_eigenvalue         = 0;
+                out_quality[i].forward_backward_error = -1;
+                out_quality[i].iterations             = 0;
+            }
+        }
+    }
+
+    /**
+     * @brief Tracks the @p previous_keypoints_size features starting at
+     * @p first_feature of @p previous_patch_pyramid, which is at most
+     * TRACKING_BATCH_SIZE, see track_features. The keypoints and
+     * @p quality are those of the batch.
+     */
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    static void track_batch(
+        image::BasicPatchPyramid<Levels, Size, Capacity>&
+            previous_patch_pyramid,
+        const size_t first_feature,
+        image::ImagePyramid& next_image_pyramid,
+        image::KeyPoint* previous_keypoints,
+        image::KeyPoint* next_keypoints,
+        const size_t previous_keypoints_size,
+        const TrackingLimits& limits,
+        TrackQuality* quality) {
+
+        // LK is based on the following:
+        //
+        // A * v = b
+        //
+        // Where A contains the x and y gradients from the previous
+        // image, v is the flow vector and b is the time derivatives
+        // with respect to the previous image and the current image
+        //
+        // The equations is solved by taking the pseudo-inverse:
+        //
+        // A * v        = b
+        // A^T * A * v  = A^T * b
+        // v            = (A^T * A)^-1 * A^T * b
+        // v            = H^-1 * A^T * b
+        //
+        // Where we let H = A^T * A
+        //
+        // A will thus be on the following form:
+        //
+        //     [ I0x(p_1) I0y(p_1) ]
+        // A = [ I0x(p_2) I0y(p_2) ]
+        //     [       ...         ]
+        //     [ I0x(p_n) I0y(p_n) ]
+        //
+        // Whereas b will be on the following form (the time derivative
+        // is equal to the intensity difference between the images)
+        //
+        //     [I1(p_1) - I0(p_1)]
+        // b = [I1(p_2) - I0(p_2)]
+        //     [       ...       ]
+        //     [I1(p_n) - I0(p_n)]
+        //
+        // clang-format off
+        //
+        // This can be rewritten as:
+        //
+        //     [ Sum(I0x(p_i)^2)            Sum(I0x(p_i) * I0y(p_i)) ]^-1  [ -Sum(I0x(p_i) * (I1(p_i) - I0(p_i))) ]
+        // v = [                                                     ]     [                                      ]
+        //     [ Sum(I0x(p_i) * I0y(p_i))   Sum(I0y(p_i)^2)          ]     [ -Sum(I0y(p_i) * (I1(p_i) - I0(p_i))) ]
+        //
+        // clang-format on
+        //
+        // As the gradients are taken on the previous patch, A^T and H^-1 are
+        // the same for every iteration and are computed once per level. Every
+        // iteration is then only a warp, a subtraction and a multiplication
+        // with A^T. The iterations are run over all features which have not
+        // converged yet at once, and the converged ones are compacted out of
+        // the set.
+
+        TrackingState<Size>& state = tracking_state<Size>;
+
+        const float threshold = 0.01;
+
+        reset_quality(previous_keypoints, quality, previous_keypoints_size);
+
+        for (int_fast32_t feature_index = 0;
+             feature_index < (int_fast32_t)previous_keypoints_size;
+             feature_index++) {
+            state.guess_x[feature_index]  = 0;
+            state.guess_y[feature_index]  = 0;
+            state.rejected[feature_index] = false;
+
+            if (previous_keypoints[feature_index].stale ||
+                (quality == NULL && limits.min_eigenvalue <= 0)) {
+                continue;
+            }
+
+            // Rejected before any iteration is spent on it
+            const float eigenvalue = min_eigenvalue(
+                previous_patch_pyramid.at(first_feature + feature_index, 0));
 
-        // This stores the flow computed for each feature at every pyramid
-        // level. When going down in the pyramid, the flow from the previous
-        // level will be upsampled (by 2) and used in the current level.
-        linalg::Vec2 pyramid_level_flow[previous_keypoints_size]
-                                       [PYRAMID_LEVELS];
+            if (quality != NULL) {
+                quality[feature_index].min_eigenvalue = eigenvalue;
+            }
+
+            state.rejected[feature_index] = eigenvalue <
+                                            limits.min_eigenvalue;
+        }
 
-        for (int pyramid_level = PYRAMID_LEVELS - 1; pyramid_level >= 0;
+        for (int pyramid_level = Levels - 1; pyramid_level >= 0;
              pyramid_level--) {
 
-            image::Image* next_image_at_pyramid_level = next_image_pyramid.at(
-                pyramid_level);
+            TRACE_ZONE(ZONE_TRACK_LEVEL);
+
+            // Only the neighbourhoods of the features are accessed, which
+            // are computed as they are warped when the pyramid is lazy
+            const image::Image* next_image_at_pyramid_level =
+                next_image_pyramid.at(pyramid_level, 0, 0, 0, 0);
+
+            state.features_size = 0;
 
             for (int_fast32_t feature_index = 0;
                  feature_index < (int_fast32_t)previous_keypoints_size;
                  feature_index++) {
 
-                if (previous_keypoints[feature_index].stale) {
+                if (previous_keypoints[feature_index].stale ||
+                    state.rejected[feature_index]) {
                     next_keypoints[feature_index].stale = true;
                     continue;
                 }
 
-                image::Patch previous_image_patch =
-                    previous_patch_pyramid
-                        .patches[feature_index][pyramid_level];
+                // Without a usable gradient (e.g. a flat patch) the flow
+                // cannot be found, so the feature is lost
+                if (!construct_template(
+                        previous_patch_pyramid.at(first_feature + feature_index,
+                                                  pyramid_level),
+                        feature_index,
+                        state)) {
+                    state.rejected[feature_index]       = true;
+                    next_keypoints[feature_index].stale = true;
+                    continue;
+                }
 
-                image::Patch previous_patch_dx, previous_patch_dy;
-                image::dx(previous_image_patch, previous_patch_dx);
-                image::dy(previous_image_patch, previous_patch_dy);
+                state.flow_x[feature_index]     = 0;
+                state.flow_y[feature_index]     = 0;
+                state.norm[feature_index]       = FLT_MAX;
+                state.iterations[feature_index] = 0;
 
-                // LK is based on the following:
-                //
-                // A * v = b
-                //
-                // Where A contains the x and y gradients from the previous
-                // image, v is the flow vector and b is the time derivatives
-                // with respect to the previous image and the current image
-                //
-                // The equations is solved by taking the pseudo-inverse:
-                //
-                // A * v        = b
-                // A^T * A * v  = A^T * b
-                // v            = (A^T * A)^-1 * A^T * b
-                // v            = H^-1 * A^T * b
-                //
-                // Where we let H = A^T * A
-                //
-                // A will thus be on the following form:
-                //
-                //     [ I0x(p_1) I0y(p_1) ]
-                // A = [ I0x(p_2) I0y(p_2) ]
-                //     [       ...         ]
-                //     [ I0x(p_n) I0y(p_n) ]
-                //
-                // Whereas b will be on the following form (the time derivative
-                // is equal to the intensity difference between the images)
-                //
-                //     [I1(p_1) - I0(p_1)]
-                // b = [I1(p_2) - I0(p_2)]
-                //     [       ...       ]
-                //     [I1(p_n) - I0(p_n)]
-                //
-                // clang-format off
-                //
-                // This can be rewritten as:
-                //
-                //     [ Sum(I0x(p_i)^2)            Sum(I0x(p_i) * I0y(p_i)) ]^-1  [ -Sum(I0x(p_i) * (I1(p_i) - I0(p_i))) ]
-                // v = [                                                     ]     [                                      ]
-                //     [ Sum(I0x(p_i) * I0y(p_i))   Sum(I0y(p_i)^2)          ]     [ -Sum(I0y(p_i) * (I1(p_i) - I0(p_i))) ]
-                //
-                // clang-format on
+                state.features[state.features_size++] = feature_index;
+            }
+
+            memcpy(state.active, state.features, state.features_size);
+            state.active_size = state.features_size;
+
+            while (state.active_size > 0) {
+
+                TRACE_ZONE(ZONE_LK_ITERATION);
+
+                size_t still_active_size = 0;
+
+                for (size_t k = 0; k < state.active_size; k++) {
+
+                    const uint8_t feature_index = state.active[k];
+
+                    const image::BasicPatch<Size>& previous_image_patch =
+                        previous_patch_pyramid.at(first_feature + feature_index,
+                                                  pyramid_level);
+
+                    if (quality != NULL) {
+                        quality[feature_index].iterations++;
+                    }
+
+                    float b[Size * Size];
+
+                    const float x = previous_image_patch.origin.x +
+                                    (state.flow_x[feature_index] +
+                                     state.guess_x[feature_index]);
+                    const float y = previous_image_patch.origin.y +
+                                    (state.flow_y[feature_index] +
+                                     state.guess_y[feature_index]);
 
-                linalg::Mat<2 * 2> S(2, 2);
+                    const float current_norm = warp_difference(
+                        previous_image_patch,
+                        x,
+                        y,
+                        *next_image_pyramid.at(pyramid_level,
+                                               floor(x),
+                                               floor(y),
+                                               Size + 1,
+                                               Size + 1),
+                        b);
+
+                    if (current_norm >= state.norm[feature_index]) {
+                        continue;
+                    }
 
-                linalg::Mat<PATCH_SIZE * PATCH_SIZE * 2> AT(2,
-                                                            PATCH_SIZE *
-                                                                PATCH_SIZE);
+                    const float* Ix = state.gradient_x[feature_index];
+                    const float* Iy = state.gradient_y[feature_index];
 
-                linalg::Mat<PATCH_SIZE * PATCH_SIZE> b(PATCH_SIZE * PATCH_SIZE,
-                                                       1);
+                    float ATb_x = 0, ATb_y = 0;
 
-                linalg::Mat<2> ATb(2, 1);
+                    for (int_fast32_t i = 0; i < Size * Size;
+                         i++) {
+                        ATb_x += Ix[i] * b[i];
+                    }
 
-                for (int_fast32_t j = 0; j < PATCH_SIZE; j++) {
-                    for (int_fast32_t i = 0; i < PATCH_SIZE; i++) {
+                    for (int_fast32_t i = 0; i < Size * Size;
+                         i++) {
+                        ATb_y += Iy[i] * b[i];
+                    }
 
-                        const float Ix = previous_patch_dx.row(j)[i];
-                        const float Iy = previous_patch_dy.row(j)[i];
+                    const float incremental_flow_x =
+                        state.Hinv_xx[feature_index] * ATb_x +
+                        state.Hinv_xy[feature_index] * ATb_y;
+                    const float incremental_flow_y =
+                        state.Hinv_yx[feature_index] * ATb_x +
+                        state.Hinv_yy[feature_index] * ATb_y;
 
-                        S(0, 0) += Ix * Ix;
-                        S(1, 1) += Iy * Iy;
+                    state.norm[feature_index] = current_norm;
+                    state.flow_x[feature_index] += incremental_flow_x;
+                    state.flow_y[feature_index] += incremental_flow_y;
 
-                        S(0, 1) += Ix * Iy;
+                    // A flow larger than the image at this level has
+                    // diverged. It is bounded at every iteration, so the
+                    // flow stays finite and the track is lost here instead
+                    // of as a position which is not a number
+                    if (fabsf(state.flow_x[feature_index] +
+                              state.guess_x[feature_index]) >
+                            (float)next_image_at_pyramid_level->width ||
+                        fabsf(state.flow_y[feature_index] +
+                              state.guess_y[feature_index]) >
+                            (float)next_image_at_pyramid_level->height) {
+                        state.rejected[feature_index] = true;
+                        continue;
+                    }
 
-                        AT(0, j * PATCH_SIZE + i) = Ix;
-                        AT(1, j * PATCH_SIZE + i) = Iy;
+                    if (sqrt(incremental_flow_x * incremental_flow_x +
+                             incremental_flow_y * incremental_flow_y) >
+                            threshold &&
+                        state.iterations[feature_index]++ < 50) {
+                        state.active[still_active_size++] = feature_index;
                     }
                 }
 
-                // Off-diagonal entries are equal
-                S(1, 0) = S(0, 1);
+                state.active_size = still_active_size;
+            }
 
-                linalg::Mat<2 * 2> Sinv(2, 2);
-                linalg::inverse(S, Sinv);
+            for (size_t k = 0; k < state.features_size; k++) {
 
-                const float S_determinant = linalg::determinant(S);
+                const uint8_t feature_index = state.features[k];
 
-                if (isnan(S_determinant) || isinf(S_determinant)) {
-                    printf("\tH is non-invertible!\r\n");
-                    break;
+                if (state.rejected[feature_index]) {
+                    next_keypoints[feature_index].stale = true;
+                    continue;
                 }
 
-                // Set norm to max value before the minimization is performed
-                float norm = FLT_MAX;
+                const float displacement_x = state.flow_x[feature_index] +
+                                             state.guess_x[feature_index];
+                const float displacement_y = state.flow_y[feature_index] +
+                                             state.guess_y[feature_index];
+
+                if (pyramid_level > 0) {
+
+                    state.guess_x[feature_index] = 2 * displacement_x;
+                    state.guess_y[feature_index] = 2 * displacement_y;
+
+                } else {
+
+                    const image::BasicPatch<Size>& previous_image_patch =
+                        previous_patch_pyramid.at(first_feature + feature_index,
+                                                  0);
+
+                    image::KeyPoint& key_point = next_keypoints[feature_index];
+
+                    // The position is kept at sub-pixel precision, as
+                    // rounding it here would accumulate as drift over the
+                    // frames of a track
+                    key_point.point.x = previous_image_patch.origin.x +
+                                        Size / 2 + displacement_x;
+
+                    key_point.point.y = previous_image_patch.origin.y +
+                                        Size / 2 + displacement_y;
+
+                    const float residual = state.norm[feature_index] /
+                                           (float)(Size * Size);
+
+                    if (quality != NULL) {
+                        quality[feature_index].residual = residual;
+                    }
+
+                    if ((key_point.point.x < 0) || (key_point.point.y < 0) ||
+                        (key_point.point.x >
+                         next_image_at_pyramid_level->width - 1) ||
+                        (key_point.point.y >
+                         next_image_at_pyramid_level->height - 1) ||
+                        (limits.max_residual > 0 &&
+                         residual > limits.max_residual)) {
+                        key_point.stale = true;
+                    } else {
+                        key_point.stale = false;
+                    }
+                }
+            }
+        }
+    }
+
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    void track_features(
+        image::BasicPatchPyramid<Levels, Size, Capacity>&
+            previous_patch_pyramid,
+        image::ImagePyramid& next_image_pyramid,
+        image::KeyPoint* previous_keypoints,
+        image::KeyPoint* next_keypoints,
+        const size_t previous_keypoints_size,
+        const TrackingLimits& limits,
+        TrackQuality* out_quality) {
+
+        TRACE_ZONE(ZONE_TRACK);
+
+        const size_t size = mark_beyond_capacity(
+            previous_patch_pyramid.capacity(),
+            next_keypoints,
+            previous_keypoints_size);
+
+        copy_octaves(previous_keypoints,
+                     next_keypoints,
+                     previous_keypoints_size);
+
+        // The features are tracked independently of each other, so a batch
+        // at a time gives the same result as all at once
+        for (size_t first_feature = 0; first_feature < size;
+             first_feature += TRACKING_BATCH_SIZE) {
+
+            const size_t batch_size =
+                size - first_feature < TRACKING_BATCH_SIZE
+                    ? size - first_feature
+                    : TRACKING_BATCH_SIZE;
+
+            track_batch(previous_patch_pyramid,
+                        first_feature,
+                        next_image_pyramid,
+                        &previous_keypoints[first_feature],
+                        &next_keypoints[first_feature],
+                        batch_size,
+                        limits,
+                        out_quality == NULL ? NULL
+                                            : &out_quality[first_feature]);
+        }
+    }
+
+    /**
+     * @return The number of bits needed to represent @p value, which has to
+     * be positive.
+     */
+    static inline int bit_length(const uint64_t value) {
+        return 64 - __builtin_clzll(value);
+    }
+
+    /**
+     * @brief Computes the bilinear interpolation of the patch at @p x, @p y in
+     * @p image, without the border, where the position has FLOW_FRACTION_BITS
+     * fractional bits. The intensities are placed in @p out_patch with
+     * WEIGHT_FRACTION_BITS fractional bits.
+     */
+    template <uint16_t Size>
+    SECTION_ITCM static void
+    interpolate_patch(const int32_t x,
+                      const int32_t y,
+                      const image::Image& image,
+                      int16_t out_patch[padded_area(Size)]) {
+
+        const int32_t start_x = x >> FLOW_FRACTION_BITS;
+        const int32_t start_y = y >> FLOW_FRACTION_BITS;
+
+        const int32_t weight_scale = 1 << WEIGHT_FRACTION_BITS;
+
+        const int32_t alpha_x = (x & ((1 << FLOW_FRACTION_BITS) - 1)) >>
+                                (FLOW_FRACTION_BITS - WEIGHT_FRACTION_BITS);
+        const int32_t alpha_y = (y & ((1 << FLOW_FRACTION_BITS) - 1)) >>
+                                (FLOW_FRACTION_BITS - WEIGHT_FRACTION_BITS);
+
+        const int32_t w00 = (weight_scale - alpha_x) * (weight_scale - alpha_y);
+        const int32_t w01 = alpha_x * (weight_scale - alpha_y);
+        const int32_t w10 = (weight_scale - alpha_x) * alpha_y;
+        const int32_t w11 = alpha_x * alpha_y;
+
+        // Copy the patch and the extra row and column needed for the
+        // interpolation, extrapolating with the intensity values at the border
+        // of the image as done for image::Patch
+        uint8_t buffer[(Size + 1) * (Size + 1)];
+
+        for (int_fast32_t j = 0; j < Size + 1; j++) {
+
+            int_fast32_t ys = start_y + j;
+            ys = ys < 0 ? 0 : ys > (int_fast32_t)image.height - 1
+                                  ? image.height - 1
+                                  : ys;
+
+            for (int_fast32_t i = 0; i < Size + 1; i++) {
+
+                int_fast32_t xs = start_x + i;
+                xs = xs < 0 ? 0 : xs > (int_fast32_t)image.width - 1
+                                      ? image.width - 1
+                                      : xs;
+
+                buffer[j * (Size + 1) + i] =
+                    image.data[ys * image.width + xs];
+            }
+        }
+
+        for (int_fast32_t j = 0; j < Size; j++) {
+            for (int_fast32_t i = 0; i < Size; i++) {
+
+                const uint8_t* I = &buffer[j * (Size + 1) + i];
+
+                const int32_t value = w00 * I[0] + w01 * I[1] +
+                                      w10 * I[Size + 1] +
+                                      w11 * I[Size + 2];
+
+                out_patch[j * Size + i] = (int16_t)(
+                    (value + (1 << (WEIGHT_FRACTION_BITS - 1))) >>
+                    WEIGHT_FRACTION_BITS);
+            }
+        }
+
+        out_patch[padded_area(Size) - 1] = 0;
+    }
+
+    /**
+     * @return The dot product of the 16 bit values in @p first and @p second,
+     * computed two at a time with dual multiply-accumulates.
+     */
+    template <uint16_t Size>
+    SECTION_ITCM static inline int32_t
+    dot_product(const int16_t first[padded_area(Size)],
+                const int16_t second[padded_area(Size)]) {
+
+        uint32_t sum = 0;
+
+        for (int_fast32_t k = 0; k < padded_area(Size); k += 2) {
+
+            // The pairs are loaded with memcpy, which compiles to a single
+            // word load, as reading the int16_t arrays through a uint32_t
+            // pointer breaks strict aliasing
+            uint32_t first_pair, second_pair;
+            memcpy(&first_pair, &first[k], sizeof(first_pair));
+            memcpy(&second_pair, &second[k], sizeof(second_pair));
+
+            sum = __SMLAD(first_pair, second_pair, sum);
+        }
+
+        return (int32_t)sum;
+    }
+
+    /**
+     * @brief Computes the (unnormalized) Sobel gradients of @p patch and its
+     * intensities with WEIGHT_FRACTION_BITS fractional bits. They are exact
+     * integers as the patch is at an integer position.
+     */
+    template <uint16_t Size>
+    SECTION_ITCM static void
+    sobel_gradients(const image::BasicFixedPointPatch<Size>& patch,
+                    int16_t out_Ix[padded_area(Size)],
+                    int16_t out_Iy[padded_area(Size)],
+                    int16_t out_I0[padded_area(Size)]) {
+
+        for (int_fast32_t j = 0; j < Size; j++) {
+            for (int_fast32_t i = 0; i < Size; i++) {
+
+                const int_fast32_t w = Size + 2;
+
+                const uint8_t* p = &patch.data[(j + 1) * w + i + 1];
+
+                out_Ix[j * Size + i] = (p[-w + 1] - p[-w - 1]) +
+                                       2 * (p[1] - p[-1]) +
+                                       (p[w + 1] - p[w - 1]);
+
+                out_Iy[j * Size + i] = (p[w - 1] + 2 * p[w] + p[w + 1]) -
+                                       (p[-w - 1] + 2 * p[-w] + p[-w + 1]);
+
+                out_I0[j * Size + i] = p[0] << WEIGHT_FRACTION_BITS;
+            }
+        }
+
+        out_Ix[padded_area(Size) - 1] = 0;
+        out_Iy[padded_area(Size) - 1] = 0;
+        out_I0[padded_area(Size) - 1] = 0;
+    }
+
+    /**
+     * @brief track_batch for the fixed-point tracker.
+     */
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    SECTION_ITCM static void track_fixed_point_batch(
+        image::BasicFixedPointPatchPyramid<Levels, Size, Capacity>&
+            previous_patch_pyramid,
+        const size_t first_feature,
+        image::ImagePyramid& next_image_pyramid,
+        image::KeyPoint* previous_keypoints,
+        image::KeyPoint* next_keypoints,
+        const size_t previous_keypoints_size,
+        const TrackingLimits& limits,
+        TrackQuality* out_quality) {
+
+        // The largest dot product is between the gradients, at most 4 * 255
+        // in magnitude, and the temporal difference, at most 255 in units of
+        // the intensities, summed over the patch in 32 bits
+        static_assert((int64_t)Size * Size * (4 * 255) *
+                              (255 << WEIGHT_FRACTION_BITS) <=
+                          INT32_MAX,
+                      "The dot products of the patch overflow 32 bits");
+
+        const size_t size = previous_keypoints_size;
+
+        reset_quality(previous_keypoints, out_quality, size);
+
+        FixedPointTrackingState<Levels>& state =
+            fixed_point_tracking_state<Levels>;
+
+        int32_t(&pyramid_level_flow)[TRACKING_BATCH_SIZE][Levels][2] =
+            state.pyramid_level_flow;
+        bool(&rejected)[TRACKING_BATCH_SIZE] = state.rejected;
+
+        for (size_t feature_index = 0; feature_index < size; feature_index++) {
+
+            rejected[feature_index] = false;
+
+            if (previous_keypoints[feature_index].stale ||
+                (out_quality == NULL && limits.min_eigenvalue <= 0)) {
+                continue;
+            }
+
+            __attribute__((aligned(4))) int16_t Ix[padded_area(Size)];
+            __attribute__((aligned(4))) int16_t Iy[padded_area(Size)];
+            __attribute__((aligned(4))) int16_t I0[padded_area(Size)];
+
+            sobel_gradients(previous_patch_pyramid.at(first_feature + feature_index, 0),
+                            Ix,
+                            Iy,
+                            I0);
+
+            const float eigenvalue =
+                min_eigenvalue((float)dot_product<Size>(Ix, Ix),
+                               (float)dot_product<Size>(Ix, Iy),
+                               (float)dot_product<Size>(Iy, Iy),
+                               Size);
+
+            if (out_quality != NULL) {
+                out_quality[feature_index].min_eigenvalue = eigenvalue;
+            }
+
+            rejected[feature_index] = eigenvalue < limits.min_eigenvalue;
+        }
+
+        for (int pyramid_level = Levels - 1; pyramid_level >= 0;
+             pyramid_level--) {
+
+            TRACE_ZONE(ZONE_TRACK_LEVEL);
+
+            // Only the neighbourhoods of the features are accessed, which
+            // are computed as they are warped when the pyramid is lazy
+            const image::Image* next_image_at_pyramid_level =
+                next_image_pyramid.at(pyramid_level, 0, 0, 0, 0);
+
+            for (int_fast32_t feature_index = 0;
+                 feature_index < (int_fast32_t)size;
+                 feature_index++) {
+
+                if (previous_keypoints[feature_index].stale ||
+                    rejected[feature_index]) {
+                    next_keypoints[feature_index].stale = true;
+                    continue;
+                }
+
+                if (pyramid_level == Levels - 1) {
+                    pyramid_level_flow[feature_index][pyramid_level][0] = 0;
+                    pyramid_level_flow[feature_index][pyramid_level][1] = 0;
+                }
+
+                const image::BasicFixedPointPatch<Size>& previous_image_patch =
+                    previous_patch_pyramid.at(first_feature + feature_index, pyramid_level);
+
+                // See the float tracker for the derivation
+                __attribute__((aligned(4))) int16_t Ix[padded_area(Size)];
+                __attribute__((aligned(4))) int16_t Iy[padded_area(Size)];
+                __attribute__((aligned(4))) int16_t I0[padded_area(Size)];
+
+                sobel_gradients(previous_image_patch, Ix, Iy, I0);
+
+                // The gradients are at most 4 * 255 in magnitude, so the
+                // structure tensor fits in 32 bits
+                const int64_t Sxx = dot_product<Size>(Ix, Ix);
+                const int64_t Syy = dot_product<Size>(Iy, Iy);
+                const int64_t Sxy = dot_product<Size>(Ix, Iy);
+
+                const int64_t S_determinant = Sxx * Syy - Sxy * Sxy;
+
+                const int64_t S_trace = Sxx + Syy;
+
+                // A nearly singular structure tensor (e.g. a flat patch or an
+                // edge) gives no reliable flow, and its inverse lets the flow
+                // overflow. It is rejected against the trace as in the float
+                // tracker, with FLT_EPSILON = 2^-23
+                if (S_determinant <= ((S_trace * S_trace) >> 23)) {
+                    rejected[feature_index]             = true;
+                    next_keypoints[feature_index].stale = true;
+                    continue;
+                }
+
+                int32_t flow[2] = {0, 0};
+
+                // The inverse of S is stored as 32 bit integers with a
+                // shared exponent, such that the entries are below 2^30:
+                //
+                // S^-1 = Sinv / 2^exponent
+                const int64_t Sxy_abs = Sxy < 0 ? -Sxy : Sxy;
+
+                int64_t S_max = Sxx > Syy ? Sxx : Syy;
+                S_max = S_max > Sxy_abs ? S_max : Sxy_abs;
+
+                const int exponent = 29 + bit_length(S_determinant) -
+                                     bit_length(S_max);
+
+                // Keep 32 significant bits of the determinant, so that the
+                // shifted adjugate does not overflow
+                const int determinant_shift =
+                    bit_length(S_determinant) > 32
+                        ? bit_length(S_determinant) - 32
+                        : 0;
+
+                const int64_t divisor = S_determinant >> determinant_shift;
+                const int adjugate_shift = exponent - determinant_shift;
+
+                const int64_t Sinv00 = (Syy << adjugate_shift) / divisor;
+                const int64_t Sinv01 = (-Sxy << adjugate_shift) / divisor;
+                const int64_t Sinv11 = (Sxx << adjugate_shift) / divisor;
+
+                // The update is in units of the intensities, which have
+                // WEIGHT_FRACTION_BITS fractional bits, and is converted
+                // to FLOW_FRACTION_BITS fractional bits
+                const int update_shift = exponent + WEIGHT_FRACTION_BITS -
+                                         FLOW_FRACTION_BITS;
+
+                __attribute__((aligned(4))) int16_t I1[padded_area(Size)];
+                __attribute__((aligned(4))) int16_t It[padded_area(Size)];
+
+                int32_t norm = INT32_MAX;
 
                 int_fast32_t iterations = 0;
 
-                linalg::Vec2 flow;
+                int64_t incremental_flow[2];
 
-                linalg::Mat<2> incremental_flow;
+                const int64_t max_flow_x =
+                    (int64_t)next_image_at_pyramid_level->width
+                    << FLOW_FRACTION_BITS;
+                const int64_t max_flow_y =
+                    (int64_t)next_image_at_pyramid_level->height
+                    << FLOW_FRACTION_BITS;
 
-                const float threshold = 0.01;
+                bool diverged = false;
 
                 do {
 
-                    const linalg::Vec2 total_flow =
-                        flow + pyramid_level_flow[feature_index][pyramid_level];
+                    if (out_quality != NULL) {
+                        out_quality[feature_index].iterations++;
+                    }
+
+                    const int32_t total_flow_x =
+                        flow[0] +
+                        pyramid_level_flow[feature_index][pyramid_level][0];
+                    const int32_t total_flow_y =
+                        flow[1] +
+                        pyramid_level_flow[feature_index][pyramid_level][1];
 
-                    image::Patch next_image_patch(
-                        previous_image_patch.origin.x + total_flow.x,
-                        previous_image_patch.origin.y + total_flow.y,
-                        *next_image_at_pyramid_level);
+                    const int32_t x = (previous_image_patch.origin_x
+                                       << FLOW_FRACTION_BITS) +
+                                      total_flow_x;
+                    const int32_t y = (previous_image_patch.origin_y
+                                       << FLOW_FRACTION_BITS) +
+                                      total_flow_y;
 
-                    image::Patch patch_dt;
-                    image::dt(previous_image_patch, next_image_patch, patch_dt);
+                    interpolate_patch<Size>(
+                        x,
+                        y,
+                        *next_image_pyramid.at(pyramid_level,
+                                               x >> FLOW_FRACTION_BITS,
+                                               y >> FLOW_FRACTION_BITS,
+                                               Size + 1,
+                                               Size + 1),
+                        I1);
 
-                    float current_norm = 0;
+                    int32_t current_norm = 0;
 
-                    for (int_fast32_t j = 0; j < PATCH_SIZE; j++) {
-                        for (int_fast32_t i = 0; i < PATCH_SIZE; i++) {
-                            const float It = patch_dt.row(j)[i];
+                    for (int_fast32_t k = 0; k < padded_area(Size); k++) {
+                        It[k] = I1[k] - I0[k];
+                        current_norm += It[k] < 0 ? -It[k] : It[k];
+                    }
 
-                            current_norm += fabs(It);
+                    // A^T * b, where b = -It
+                    const int64_t ATb_x = -(int64_t)dot_product<Size>(Ix,
+                                                                      It);
+                    const int64_t ATb_y = -(int64_t)dot_product<Size>(Iy,
+                                                                      It);
 
-                            b(j * PATCH_SIZE + i, 0) = -It;
+                    incremental_flow[0] = Sinv00 * ATb_x + Sinv01 * ATb_y;
+                    incremental_flow[1] = Sinv01 * ATb_x + Sinv11 * ATb_y;
+
+                    for (int n = 0; n < 2; n++) {
+                        if (update_shift > 0) {
+                            incremental_flow[n] =
+                                (incremental_flow[n] +
+                                 ((int64_t)1 << (update_shift - 1))) >>
+                                update_shift;
+                        } else {
+                            incremental_flow[n] <<= -update_shift;
                         }
                     }
 
-                    linalg::multiply(AT, b, ATb);
-                    linalg::multiply(Sinv, ATb, incremental_flow);
+                    if (current_norm >= norm) {
+                        break;
+                    }
 
-                    if (current_norm < norm) {
-                        norm = current_norm;
-                        flow.x += incremental_flow(0, 0);
-                        flow.y += incremental_flow(1, 0);
-                    } else {
+                    // A flow larger than the image at this level has
+                    // diverged. It is bounded before it is added, so that
+                    // the flow and the positions derived from it stay
+                    // within 32 bits
+                    const int64_t next_flow_x = total_flow_x +
+                                                incremental_flow[0];
+                    const int64_t next_flow_y = total_flow_y +
+                                                incremental_flow[1];
+
+                    if ((next_flow_x < 0 ? -next_flow_x : next_flow_x) >
+                            max_flow_x ||
+                        (next_flow_y < 0 ? -next_flow_y : next_flow_y) >
+                            max_flow_y) {
+                        diverged = true;
                         break;
                     }
 
-                } while (linalg::norm(incremental_flow) > threshold &&
+                    norm = current_norm;
+                    flow[0] += (int32_t)incremental_flow[0];
+                    flow[1] += (int32_t)incremental_flow[1];
+
+                } while (incremental_flow[0] * incremental_flow[0] +
+                                 incremental_flow[1] *
+                                     incremental_flow[1] >
+                             FLOW_THRESHOLD * FLOW_THRESHOLD &&
                          iterations++ < 50);
 
-                linalg::Vec2 pyramid_level_displacement =
-                    flow + pyramid_level_flow[feature_index][pyramid_level];
+                if (diverged) {
+                    rejected[feature_index]             = true;
+                    next_keypoints[feature_index].stale = true;
+                    continue;
+                }
+
+                const float residual = (float)norm /
+                                       (float)((1 << WEIGHT_FRACTION_BITS) *
+                                               Size * Size);
+
+                const int32_t pyramid_level_displacement[2] = {
+                    flow[0] +
+                        pyramid_level_flow[feature_index][pyramid_level][0],
+                    flow[1] +
+                        pyramid_level_flow[feature_index][pyramid_level][1]};
 
                 if (pyramid_level > 0) {
 
-                    pyramid_level_flow[feature_index][pyramid_level - 1] =
-                        2 * pyramid_level_displacement;
+                    pyramid_level_flow[feature_index][pyramid_level - 1][0] =
+                        2 * pyramid_level_displacement[0];
+                    pyramid_level_flow[feature_index][pyramid_level - 1][1] =
+                        2 * pyramid_level_displacement[1];
 
                 } else {
 
                     image::KeyPoint& key_point = next_keypoints[feature_index];
 
-                    key_point.point.x = (int)round(
-                        previous_image_patch.origin.x + PATCH_SIZE / 2 +
-                        pyramid_level_displacement.x);
+                    // The patch was placed at the integer position below the
+                    // keypoint, its fraction is added back so that the
+                    // position stays at sub-pixel precision
+                    const float scale = 1.0f / (float)(1 << FLOW_FRACTION_BITS);
 
-                    key_point.point.y = (int)round(
-                        previous_image_patch.origin.y + PATCH_SIZE / 2 +
-                        pyramid_level_displacement.y);
+                    key_point.point.x =
+                        previous_image_patch.origin_x + Size / 2 +
+                        (float)(pyramid_level_displacement[0] +
+                                previous_image_patch.fraction_x) *
+                            scale;
+
+                    key_point.point.y =
+                        previous_image_patch.origin_y + Size / 2 +
+                        (float)(pyramid_level_displacement[1] +
+                                previous_image_patch.fraction_y) *
+                            scale;
+
+                    if (out_quality != NULL) {
+                        out_quality[feature_index].residual = residual;
+                    }
 
                     if ((key_point.point.x < 0) || (key_point.point.y < 0) ||
                         (key_point.point.x >
-                         next_image_pyramid.at(0)->width - 1) ||
+                         next_image_at_pyramid_level->width - 1) ||
                         (key_point.point.y >
-                         next_image_pyramid.at(0)->height - 1)) {
+                         next_image_at_pyramid_level->height - 1) ||
+                        (limits.max_residual > 0 &&
+                         residual > limits.max_residual)) {
                         key_point.stale = true;
                     } else {
                         key_point.stale = false;
@@ -210,4 +1160,178 @@ namespace frontend {
             }
         }
     }
+
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    void track_features(
+        image::BasicFixedPointPatchPyramid<Levels, Size, Capacity>&
+            previous_patch_pyramid,
+        image::ImagePyramid& next_image_pyramid,
+        image::KeyPoint* previous_keypoints,
+        image::KeyPoint* next_keypoints,
+        const size_t previous_keypoints_size,
+        const TrackingLimits& limits,
+        TrackQuality* out_quality) {
+
+        TRACE_ZONE(ZONE_TRACK);
+
+        const size_t size = mark_beyond_capacity(
+            previous_patch_pyramid.capacity(),
+            next_keypoints,
+            previous_keypoints_size);
+
+        copy_octaves(previous_keypoints,
+                     next_keypoints,
+                     previous_keypoints_size);
+
+        // See the float tracker
+        for (size_t first_feature = 0; first_feature < size;
+             first_feature += TRACKING_BATCH_SIZE) {
+
+            const size_t batch_size =
+                size - first_feature < TRACKING_BATCH_SIZE
+                    ? size - first_feature
+                    : TRACKING_BATCH_SIZE;
+
+            track_fixed_point_batch(
+                previous_patch_pyramid,
+                first_feature,
+                next_image_pyramid,
+                &previous_keypoints[first_feature],
+                &next_keypoints[first_feature],
+                batch_size,
+                limits,
+                out_quality == NULL ? NULL : &out_quality[first_feature]);
+        }
+    }
+
+#define INSTANTIATE_TRACKERS(levels, size, capacity)                          \
+    template void track_features(                                             \
+        image::BasicPatchPyramid<levels, size, capacity>&,                    \
+        image::ImagePyramid&,                                                 \
+        image::KeyPoint*,                                                     \
+        image::KeyPoint*,                                                     \
+        const size_t,                                                         \
+        const TrackingLimits&,                                                \
+        TrackQuality*);                                                       \
+    template void track_features(                                             \
+        image::BasicFixedPointPatchPyramid<levels, size, capacity>&,          \
+        image::ImagePyramid&,                                                 \
+        image::KeyPoint*,                                                     \
+        image::KeyPoint*,                                                     \
+        const size_t,                                                         \
+        const TrackingLimits&,                                                \
+        TrackQuality*);                                                       \
+    template void check_forward_backward(                                     \
+        image::BasicPatchPyramid<levels, size, capacity>&,                    \
+        image::ImagePyramid&,                                                 \
+        const image::KeyPoint*,                                               \
+        image::KeyPoint*,                                                     \
+        image::KeyPoint*,                                                     \
+        const size_t,                                                         \
+        const float,                                                          \
+        TrackQuality*);                                                       \
+    template void check_forward_backward(                                     \
+        image::BasicFixedPointPatchPyramid<levels, size, capacity>&,          \
+        image::ImagePyramid&,                                                 \
+        const image::KeyPoint*,                                               \
+        image::KeyPoint*,                                                     \
+        image::KeyPoint*,                                                     \
+        const size_t,                                                         \
+        const float,                                                          \
+        TrackQuality*);
+
+    /**
+     * @brief check_forward_backward for the patch pyramids of either
+     * tracker.
+     */
+    template <typename PatchPyramid>
+    static void track_backward(PatchPyramid& next_patch_pyramid,
+                               image::ImagePyramid& previous_image_pyramid,
+                               const image::KeyPoint* previous_keypoints,
+                               image::KeyPoint* next_keypoints,
+                               image::KeyPoint* backward_keypoints,
+                               const size_t size,
+                               const float max_error,
+                               TrackQuality* out_quality) {
+
+        TRACE_ZONE(ZONE_TRACK);
+
+        track_features(next_patch_pyramid,
+                       previous_image_pyramid,
+                       next_keypoints,
+                       backward_keypoints,
+                       size);
+
+        for (size_t i = 0; i < size; i++) {
+
+            if (next_keypoints[i].stale) {
+                continue;
+            }
+
+            const float dx = backward_keypoints[i].point.x -
+                             previous_keypoints[i].point.x;
+            const float dy = backward_keypoints[i].point.y -
+                             previous_keypoints[i].point.y;
+
+            const float error = sqrtf(dx * dx + dy * dy);
+
+            if (out_quality != NULL) {
+                out_quality[i].forward_backward_error =
+                    backward_keypoints[i].stale ? INFINITY : error;
+            }
+
+            // A diverged backward track is stale, the trackers never leave
+            // a position which is not finite. The error is only compared
+            // for the others, as the release build (-Ofast) assumes finite
+            // math and comparisons with INFINITY or NaN are not reliable
+            if (backward_keypoints[i].stale || error > max_error) {
+                next_keypoints[i].stale = true;
+            }
+        }
+    }
+
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    void check_forward_backward(
+        image::BasicPatchPyramid<Levels, Size, Capacity>& next_patch_pyramid,
+        image::ImagePyramid& previous_image_pyramid,
+        const image::KeyPoint* previous_keypoints,
+        image::KeyPoint* next_keypoints,
+        image::KeyPoint* backward_keypoints,
+        const size_t size,
+        const float max_error,
+        TrackQuality* out_quality) {
+
+        track_backward(next_patch_pyramid,
+                       previous_image_pyramid,
+                       previous_keypoints,
+                       next_keypoints,
+                       backward_keypoints,
+                       size,
+                       max_error,
+                       out_quality);
+    }
+
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    void check_forward_backward(
+        image::BasicFixedPointPatchPyramid<Levels, Size, Capacity>&
+            next_patch_pyramid,
+        image::ImagePyramid& previous_image_pyramid,
+        const image::KeyPoint* previous_keypoints,
+        image::KeyPoint* next_keypoints,
+        image::KeyPoint* backward_keypoints,
+        const size_t size,
+        const float max_error,
+        TrackQuality* out_quality) {
+
+        track_backward(next_patch_pyramid,
+                       previous_image_pyramid,
+                       previous_keypoints,
+                       next_keypoints,
+                       backward_keypoints,
+                       size,
+                       max_error,
+                       out_quality);
+    }
+
+    FOR_EACH_TRACKER_CONFIGURATION(INSTANTIATE_TRACKERS)
 }
@@ -8,6 +8,56 @@
 
 namespace frontend {
 
+    /**
+     * @brief Quality of the track of a keypoint, see track_features and
+     * check_forward_backward.
+     */
+    struct TrackQuality {
+        /**
+         * @brief Mean absolute intensity difference per pixel between the
+         * patch and the next image at the last accepted iteration of the
+         * finest level, INFINITY if the keypoint was not tracked there.
+         */
+        float residual;
+
+        /**
+         * @brief Smallest eigenvalue of the structure tensor S of the patch
+         * at the finest level per pixel, in squared Sobel gradients. Small
+         * for flat patches and edges, which cannot be tracked reliably.
+         */
+        float min_eigenvalue;
+
+        /**
+         * @brief Distance in pixels between the previous keypoint and the
+         * keypoint tracked back from the next image, negative if it was not
+         * checked.
+         */
+        float forward_backward_error;
+
+        /**
+         * @brief Number of Lucas-Kanade iterations over all levels.
+         */
+        uint16_t iterations;
+    };
+
+    /**
+     * @brief Thresholds on the TrackQuality at which the tracker rejects a
+     * keypoint, i.e. marks it as stale. A threshold of 0 is disabled.
+     */
+    struct TrackingLimits {
+        /**
+         * @brief Keypoints with a smaller TrackQuality::min_eigenvalue are
+         * rejected before they are tracked.
+         */
+        float min_eigenvalue = 0;
+
+        /**
+         * @brief Keypoints with a larger TrackQuality::residual are rejected
+         * after they are tracked.
+         */
+        float max_residual = 0;
+    };
+
     /**
      * @brief Tracks keypoints from a image to another.
      *
@@ -18,13 +68,108 @@ namespace frontend {
      * @param previous_keypoints The keypoints captured in the previous frame.
      * @param next_keypoints Buffer for where the keypoints found in @p
      * next_image are placed after tracking.
+     * @param previous_keypoints_size Size of the keypoints buffer. The
+     * keypoints beyond the capacity of @p previous_patch_pyramid are marked
+     * as stale.
+     * @param limits The thresholds at which keypoints are rejected.
+     * @param out_quality If not NULL, receives the quality of the track of
+     * every keypoint which was not stale before.
+     *
+     * @note Built for the configurations of FOR_EACH_TRACKER_CONFIGURATION.
+     */
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    void track_features(
+        image::BasicPatchPyramid<Levels, Size, Capacity>&
+            previous_patch_pyramid,
+        image::ImagePyramid& next_image_pyramid,
+        image::KeyPoint* previous_keypoints,
+        image::KeyPoint* next_keypoints,
+        const size_t previous_keypoints_size,
+        const TrackingLimits& limits = TrackingLimits(),
+        TrackQuality* out_quality    = NULL);
+
+    /**
+     * @brief Fixed-point variant of the tracker, which performs the same
+     * iterations with integer patches and gradients. The bilinear weights have
+     * 7 fractional bits and the flow 16. The structure tensor and the mismatch
+     * vector are accumulated in 32 bit integers with dual 16 bit
+     * multiply-accumulates (SMLAD).
+     *
+     * @param previous_patch_pyramid The previous patch pyramid which contains
+     * patches around the keypoints.
+     * @param next_image_pyramid The pyramid of the image where the keypoints
+     * are to be found.
+     * @param previous_keypoints The keypoints captured in the previous frame.
+     * @param next_keypoints Buffer for where the keypoints found in @p
+     * next_image are placed after tracking.
      * @param previous_keypoints_size Size of the keypoints buffer.
+     * @param limits The thresholds at which keypoints are rejected.
+     * @param out_quality If not NULL, receives the quality of the track of
+     * every keypoint which was not stale before.
+     */
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    void track_features(
+        image::BasicFixedPointPatchPyramid<Levels, Size, Capacity>&
+            previous_patch_pyramid,
+        image::ImagePyramid& next_image_pyramid,
+        image::KeyPoint* previous_keypoints,
+        image::KeyPoint* next_keypoints,
+        const size_t previous_keypoints_size,
+        const TrackingLimits& limits = TrackingLimits(),
+        TrackQuality* out_quality    = NULL);
+
+    /**
+     * @brief Forward-backward consistency check: tracks the @p next_keypoints
+     * back to the previous image and rejects the ones which do not return to
+     * within @p max_error pixels of the @p previous_keypoints they were
+     * tracked from. This catches divergent and occluded tracks, which the
+     * tracker itself cannot tell apart from good ones.
+     *
+     * The backward track uses the patches of the next image, which are
+     * constructed for the next frame anyway, so it only needs room for the
+     * backward tracked keypoints. It takes about as long as the forward
+     * track.
+     *
+     * @param next_patch_pyramid The patch pyramid constructed from the next
+     * image at the @p next_keypoints.
+     * @param previous_image_pyramid The pyramid of the image the
+     * @p previous_keypoints are in, which has to be valid still.
+     * @param previous_keypoints The keypoints tracked from.
+     * @param next_keypoints The tracked keypoints, the rejected ones are
+     * marked as stale.
+     * @param backward_keypoints Receives the @p next_keypoints tracked back
+     * to the previous image, @p size of them.
+     * @param size Number of keypoints.
+     * @param max_error Distance in pixels beyond which a keypoint is
+     * rejected.
+     * @param out_quality If not NULL, receives the forward-backward error of
+     * every keypoint which was not stale before.
+     */
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    void check_forward_backward(
+        image::BasicPatchPyramid<Levels, Size, Capacity>& next_patch_pyramid,
+        image::ImagePyramid& previous_image_pyramid,
+        const image::KeyPoint* previous_keypoints,
+        image::KeyPoint* next_keypoints,
+        image::KeyPoint* backward_keypoints,
+        const size_t size,
+        const float max_error,
+        TrackQuality* out_quality = NULL);
+
+    /**
+     * @brief check_forward_backward for the fixed-point tracker.
      */
-    void track_features(image::PatchPyramid& previous_patch_pyramid,
-                        image::ImagePyramid& next_image_pyramid,
-                        image::KeyPoint* previous_keypoints,
-                        image::KeyPoint* next_keypoints,
-                        const size_t previous_keypoints_size);
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    void check_forward_backward(
+        image::BasicFixedPointPatchPyramid<Levels, Size, Capacity>&
+            next_patch_pyramid,
+        image::ImagePyramid& previous_image_pyramid,
+        const image::KeyPoint* previous_keypoints,
+        image::KeyPoint* next_keypoints,
+        image::KeyPoint* backward_keypoints,
+        const size_t size,
+        const float max_error,
+        TrackQuality* out_quality = NULL);
 }
 
 #endif
@@ -1,18 +1,324 @@
 #include "image.h"
 
+#include "trace.h"
+
 #include <math.h>
 
+#include "board.h"
+#include "fsl_device_registers.h"
+#include "logger.h"
+
 #ifdef CPU_MIMXRT1166DVM6A
-    #include "board.h"
     #include "delay.h"
-    #include "fsl_device_registers.h"
-    #include "profile.h"
-#else
-    #define SECTION_ITCM
+#endif
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON)
+    #include <arm_neon.h>
 #endif
 
 namespace image {
 
+    namespace pyramid {
+
+        /**
+         * @return (a + 2b + c) / 4 as every backend computes it: the rounded
+         * average of b and the truncated average of a and c, which is within
+         * one of the exact rounded value.
+         */
+        static inline uint8_t
+        blur_pixel(const uint8_t a, const uint8_t b, const uint8_t c) {
+            return (b + ((a + c) >> 1) + 1) >> 1;
+        }
+
+        /**
+         * @brief The parts of the rows which are left over by the SIMD
+         * backends, see Armv7em for the parameters.
+         */
+        struct Scalar {
+
+            static inline void blur_vertical(const uint8_t* above,
+                                             const uint8_t* row,
+                                             const uint8_t* below,
+                                             uint8_t* out,
+                                             size_t start,
+                                             const size_t width) {
+                for (; start < width; start++) {
+                    out[start] = blur_pixel(above[start],
+                                            row[start],
+                                            below[start]);
+                }
+            }
+
+            static inline void blur_horizontal(const uint8_t* in,
+                                               uint8_t* out,
+                                               size_t start,
+                                               const size_t width) {
+                for (; start + 1 < width; start++) {
+                    out[start] = blur_pixel(in[start - 1],
+                                            in[start],
+                                            in[start + 1]);
+                }
+            }
+
+            static inline void downsample(const uint8_t* row0,
+                                          const uint8_t* row1,
+                                          uint8_t* out,
+                                          size_t start,
+                                          const size_t out_width) {
+                for (; start < out_width; start++) {
+                    out[start] = (row0[start * 2] + row0[start * 2 + 1] +
+                                  row1[start * 2] + row1[start * 2 + 1]) >>
+                                 2;
+                }
+            }
+        };
+
+        /**
+         * @brief Backend using the 32 bit ARMv7E-M SIMD instructions, 4
+         * pixels at a time. On the host, the instructions are provided by the
+         * portable implementations in src/host.
+         */
+        struct Armv7em {
+
+            static inline uint32_t load(const uint8_t* pixels) {
+                uint32_t packed;
+                memcpy(&packed, pixels, sizeof(packed));
+                return packed;
+            }
+
+            /**
+             * @return blur_pixel of every lane.
+             */
+            static inline uint32_t
+            blur(const uint32_t a, const uint32_t b, const uint32_t c) {
+                const uint32_t average = __UHADD8(a, c);
+
+                // Rounded halving addition, which borrows across no lane
+                return (b | average) - (((b ^ average) >> 1) & 0x7F7F7F7F);
+            }
+
+            /**
+             * @brief Blurs the rows @p above, @p row and @p below vertically
+             * into @p out, which holds @p width pixels.
+             */
+            SECTION_ITCM static void blur_vertical(const uint8_t* above,
+                                                   const uint8_t* row,
+                                                   const uint8_t* below,
+                                                   uint8_t* out,
+                                                   const size_t width) {
+                size_t x = 0;
+
+                for (; x + 4 <= width; x += 4) {
+                    const uint32_t blurred = blur(load(above + x),
+                                                  load(row + x),
+                                                  load(below + x));
+                    memcpy(out + x, &blurred, sizeof(blurred));
+                }
+
+                Scalar::blur_vertical(above, row, below, out, x, width);
+            }
+
+            /**
+             * @brief Blurs @p in horizontally into @p out, except for the
+             * first and the last pixel.
+             */
+            SECTION_ITCM static void blur_horizontal(const uint8_t* in,
+                                                     uint8_t* out,
+                                                     const size_t width) {
+                size_t x = 1;
+
+                for (; x + 5 <= width; x += 4) {
+                    const uint32_t blurred = blur(load(in + x - 1),
+                                                  load(in + x),
+                                                  load(in + x + 1));
+                    memcpy(out + x, &blurred, sizeof(blurred));
+                }
+
+                Scalar::blur_horizontal(in, out, x, width);
+            }
+
+            /**
+             * @brief Averages the 2x2 blocks of @p row0 and @p row1 into the
+             * @p out_width pixels of @p out.
+             */
+            SECTION_ITCM static void downsample(const uint8_t* row0,
+                                                const uint8_t* row1,
+                                                uint8_t* out,
+                                                const size_t out_width) {
+                size_t x = 0;
+
+                for (; x + 2 <= out_width; x += 2) {
+                    const uint32_t pixels0 = load(row0 + x * 2);
+                    const uint32_t pixels1 = load(row1 + x * 2);
+
+                    // Widened to 16 bit lanes, so that the sums are exact
+                    const uint32_t sums =
+                        (pixels0 & 0x00FF00FF) + ((pixels0 >> 8) & 0x00FF00FF) +
+                        (pixels1 & 0x00FF00FF) + ((pixels1 >> 8) & 0x00FF00FF);
+
+                    const uint32_t averages = (sums >> 2) & 0x00FF00FF;
+
+                    out[x]     = (uint8_t)averages;
+                    out[x + 1] = (uint8_t)(averages >> 16);
+                }
+
+                Scalar::downsample(row0, row1, out, x, out_width);
+            }
+        };
+
+#if defined(__SSE2__)
+        /**
+         * @brief Backend processing 16 pixels at a time with SSE2.
+         */
+        struct Sse2 {
+
+            static inline __m128i load(const uint8_t* pixels) {
+                return _mm_loadu_si128((const __m128i*)pixels);
+            }
+
+            static inline __m128i
+            blur(const __m128i a, const __m128i b, const __m128i c) {
+                // _mm_avg_epu8 rounds up, the truncated average is one less
+                // where the sum is odd
+                const __m128i average = _mm_sub_epi8(
+                    _mm_avg_epu8(a, c),
+                    _mm_and_si128(_mm_xor_si128(a, c), _mm_set1_epi8(1)));
+
+                return _mm_avg_epu8(b, average);
+            }
+
+            static void blur_vertical(const uint8_t* above,
+                                      const uint8_t* row,
+                                      const uint8_t* below,
+                                      uint8_t* out,
+                                      const size_t width) {
+                size_t x = 0;
+
+                for (; x + 16 <= width; x += 16) {
+                    _mm_storeu_si128(
+                        (__m128i*)(out + x),
+                        blur(load(above + x), load(row + x), load(below + x)));
+                }
+
+                Scalar::blur_vertical(above, row, below, out, x, width);
+            }
+
+            static void blur_horizontal(const uint8_t* in,
+                                        uint8_t* out,
+                                        const size_t width) {
+                size_t x = 1;
+
+                for (; x + 17 <= width; x += 16) {
+                    _mm_storeu_si128(
+                        (__m128i*)(out + x),
+                        blur(load(in + x - 1), load(in + x), load(in + x + 1)));
+                }
+
+                Scalar::blur_horizontal(in, out, x, width);
+            }
+
+            /**
+             * @return The sums of the horizontal pairs of @p pixels in 16 bit
+             * lanes.
+             */
+            static inline __m128i pair_sums(const __m128i pixels) {
+                const __m128i even = _mm_and_si128(pixels,
+                                                   _mm_set1_epi16(0xFF));
+
+                return _mm_add_epi16(even, _mm_srli_epi16(pixels, 8));
+            }
+
+            static void downsample(const uint8_t* row0,
+                                   const uint8_t* row1,
+                                   uint8_t* out,
+                                   const size_t out_width) {
+                size_t x = 0;
+
+                for (; x + 16 <= out_width; x += 16) {
+                    const __m128i low = _mm_add_epi16(
+                        pair_sums(load(row0 + x * 2)),
+                        pair_sums(load(row1 + x * 2)));
+                    const __m128i high = _mm_add_epi16(
+                        pair_sums(load(row0 + x * 2 + 16)),
+                        pair_sums(load(row1 + x * 2 + 16)));
+
+                    _mm_storeu_si128((__m128i*)(out + x),
+                                     _mm_packus_epi16(_mm_srli_epi16(low, 2),
+                                                      _mm_srli_epi16(high, 2)));
+                }
+
+                Scalar::downsample(row0, row1, out, x, out_width);
+            }
+        };
+#endif
+
+#if defined(__ARM_NEON)
+        /**
+         * @brief Backend processing 16 pixels at a time with NEON.
+         */
+        struct Neon {
+
+            static inline uint8x16_t
+            blur(const uint8x16_t a, const uint8x16_t b, const uint8x16_t c) {
+                return vrhaddq_u8(b, vhaddq_u8(a, c));
+            }
+
+            static void blur_vertical(const uint8_t* above,
+                                      const uint8_t* row,
+                                      const uint8_t* below,
+                                      uint8_t* out,
+                                      const size_t width) {
+                size_t x = 0;
+
+                for (; x + 16 <= width; x += 16) {
+                    vst1q_u8(out + x,
+                             blur(vld1q_u8(above + x),
+                                  vld1q_u8(row + x),
+                                  vld1q_u8(below + x)));
+                }
+
+                Scalar::blur_vertical(above, row, below, out, x, width);
+            }
+
+            static void blur_horizontal(const uint8_t* in,
+                                        uint8_t* out,
+                                        const size_t width) {
+                size_t x = 1;
+
+                for (; x + 17 <= width; x += 16) {
+                    vst1q_u8(out + x,
+                             blur(vld1q_u8(in + x - 1),
+                                  vld1q_u8(in + x),
+                                  vld1q_u8(in + x + 1)));
+                }
+
+                Scalar::blur_horizontal(in, out, x, width);
+            }
+
+            static void downsample(const uint8_t* row0,
+                                   const uint8_t* row1,
+                                   uint8_t* out,
+                                   const size_t out_width) {
+                size_t x = 0;
+
+                for (; x + 8 <= out_width; x += 8) {
+                    const uint16x8_t sums = vaddq_u16(
+                        vpaddlq_u8(vld1q_u8(row0 + x * 2)),
+                        vpaddlq_u8(vld1q_u8(row1 + x * 2)));
+
+                    vst1_u8(out + x, vshrn_n_u16(sums, 2));
+                }
+
+                Scalar::downsample(row0, row1, out, x, out_width);
+            }
+        };
+#endif
+    }
+
     SECTION_ITCM int_fast32_t inline clamp(int_fast32_t value,
                                            int_fast32_t min,
                                            int_fast32_t max) {
@@ -46,68 +352,42 @@ namespace image {
         // [ 1/2 ] * [ 1/4 1/2 1/4] = Gaussian kernel
         // [ 1/4 ]
         //
-        // The kernel is interpreted as the amount of right shift that has to be
-        // done.
-        const uint8_t kernel[3] = {2, 1, 2};
+        // Both passes are computed with halving additions (see
+        // pyramid::blur_pixel), so that no precision is lost by shifting the
+        // taps before adding them.
 
-        // In order to do the convolution in place, we have a buffer for the
-        // current rows operated on
-        uint8_t row_buffer[image_width * 3];
-
-        // The row buffer ptr is shifted along as we go through the r6365ows,
-        // pointing to three rows in the row buffer which holds the image values
-        // before being modified. This enables the convolution to be made in
-        // place
-        //
-        // We calculate the pointers for every row to not having to do modulo
-        // operations in the for loops below
-        uint8_t* row_buffer_ptr[image_height];
-
-        for (size_t i = 0; i < image_height; i++) {
-            row_buffer_ptr[i] = &row_buffer[(i % 3) * image_width];
+        if (image_width < 3 || image_height < 3) {
+            return;
         }
 
-        memcpy(row_buffer_ptr[0], &image_data[0], image_width);
-        memcpy(row_buffer_ptr[1], &image_data[image_width], image_width);
-
-        for (int_fast32_t y = 1; y < (int_fast32_t)image_height - 1; y++) {
-
-            const int_fast32_t y0 = y - 1;
-            const int_fast32_t y1 = y;
-            const int_fast32_t y2 = y + 1;
-
-            // Shift out the last used row with the next one
-            memcpy(row_buffer_ptr[y2],
-                   &image_data[y2 * image_width],
-                   image_width);
-
-            for (int_fast32_t x = 1; x < (int_fast32_t)image_width - 1; x++) {
-
-                const int_fast32_t x0 = (x - 1);
-                const int_fast32_t x1 = x;
-                const int_fast32_t x2 = (x + 1);
-
-                // These are the results from seperable horizontal convolution
-                const uint8_t r00 = row_buffer_ptr[y0][x0] >> kernel[0];
-                const uint8_t r01 = row_buffer_ptr[y0][x1] >> kernel[1];
-                const uint8_t r02 = row_buffer_ptr[y0][x2] >> kernel[2];
+        // In order to do the convolution in place, we have a buffer for the
+        // three rows operated on before being modified, and one for the
+        // result of the vertical convolution
+        uint8_t row_buffer[image_width * 4];
 
-                const uint8_t r10 = row_buffer_ptr[y1][x0] >> kernel[0];
-                const uint8_t r11 = row_buffer_ptr[y1][x1] >> kernel[1];
-                const uint8_t r12 = row_buffer_ptr[y1][x2] >> kernel[2];
+        uint8_t* rows[3] = {&row_buffer[0],
+                            &row_buffer[image_width],
+                            &row_buffer[image_width * 2]};
+        uint8_t* vertical = &row_buffer[image_width * 3];
 
-                const uint8_t r20 = row_buffer_ptr[y2][x0] >> kernel[0];
-                const uint8_t r21 = row_buffer_ptr[y2][x1] >> kernel[1];
-                const uint8_t r22 = row_buffer_ptr[y2][x2] >> kernel[2];
+        memcpy(rows[0], &image_data[0], image_width);
+        memcpy(rows[1], &image_data[image_width], image_width);
 
-                // Whereas these are the result from the seperable vertical
-                // convolution
-                const uint8_t r0 = (r00 + r01 + r02) >> kernel[0];
-                const uint8_t r1 = (r10 + r11 + r12) >> kernel[1];
-                const uint8_t r2 = (r20 + r21 + r22) >> kernel[2];
+        for (size_t y = 2; y < image_height; y++) {
 
-                image_data[y * image_width + x] = r0 + r1 + r2;
-            }
+            // Shift out the last used row with the next one
+            memcpy(rows[y % 3], &image_data[y * image_width], image_width);
+
+            pyramid::DefaultBackend::blur_vertical(rows[(y - 2) % 3],
+                                                   rows[(y - 1) % 3],
+                                                   rows[y % 3],
+                                                   vertical,
+                                                   image_width);
+
+            pyramid::DefaultBackend::blur_horizontal(
+                vertical,
+                &image_data[(y - 1) * image_width],
+                image_width);
         }
     }
 
@@ -176,36 +456,405 @@ namespace image {
     }
     // ------------------------- Image Pyramid -------------------------------
 
+    /**
+     * @brief Window of a pyramid level: the last three rows of the level
+     * before they are blurred, and the row blurred vertically.
+     */
+    struct PyramidWindow {
+        uint8_t* rows[3];
+        uint8_t* vertical;
+    };
+
+    /**
+     * @brief Adds row @p y of @p level, which has been placed in its window,
+     * to the pyramid: blurs the row above it and, if it completes a 2x2
+     * block row, adds the averaged row to the level below.
+     */
+    template <typename Backend>
+    static void add_pyramid_row(Image* images,
+                                PyramidWindow* windows,
+                                size_t level,
+                                size_t y) {
+        while (true) {
+            const Image& image           = images[level];
+            const PyramidWindow& window  = windows[level];
+            const size_t width           = image.width;
+            const uint8_t* row           = window.rows[y % 3];
+
+            // The rows at the border are not blurred
+            if (y == 0 || y == image.height - 1) {
+                memcpy(&image.data[y * width], row, width);
+            }
+
+            if (y >= 2) {
+                const uint8_t* above = window.rows[(y - 1) % 3];
+                uint8_t* out         = &image.data[(y - 1) * width];
+
+                Backend::blur_vertical(window.rows[(y - 2) % 3],
+                                       above,
+                                       row,
+                                       window.vertical,
+                                       width);
+
+                out[0]         = above[0];
+                out[width - 1] = above[width - 1];
+
+                Backend::blur_horizontal(window.vertical, out, width);
+            }
+
+            if (level + 1 == PYRAMID_LEVELS || (y & 1) == 0 ||
+                (y >> 1) >= images[level + 1].height) {
+                return;
+            }
+
+            // Average the raw rows, as the lower levels are downsampled
+            // before they are blurred
+            Backend::downsample(window.rows[(y - 1) % 3],
+                                row,
+                                windows[level + 1].rows[(y >> 1) % 3],
+                                images[level + 1].width);
+
+            level++;
+            y >>= 1;
+        }
+    }
+
     ImagePyramid::ImagePyramid(const Image& source, uint8_t* pyramid_buffer) {
+        construct<pyramid::DefaultBackend>(source, pyramid_buffer);
+    }
+
+    template <typename Backend>
+    void ImagePyramid::construct(const Image& source, uint8_t* pyramid_buffer) {
+
+        TRACE_ZONE(ZONE_PYRAMID);
+
+        lazy = false;
 
         images[0].width  = source.width;
         images[0].height = source.height;
         images[0].data   = source.data;
 
-        size_t offset = 0;
+        size_t offset      = 0;
+        size_t window_size = source.width * 4;
 
         for (size_t i = 1; i < PYRAMID_LEVELS; i++) {
-            images[i].data = pyramid_buffer + offset;
-
-            downsample(images[i - 1], images[i]);
+            images[i].width  = images[i - 1].width >> 1;
+            images[i].height = images[i - 1].height >> 1;
+            images[i].data   = pyramid_buffer + offset;
 
             offset += images[i].width * images[i].height;
+            window_size += images[i].width * 4;
         }
 
-        // Blur the images
+        if (source.width == 0) {
+            return;
+        }
+
+        uint8_t window_buffer[window_size];
+        PyramidWindow windows[PYRAMID_LEVELS];
+
+        uint8_t* window_ptr = window_buffer;
+
         for (size_t i = 0; i < PYRAMID_LEVELS; i++) {
+            for (size_t row = 0; row < 3; row++) {
+                windows[i].rows[row] = window_ptr;
+                window_ptr += images[i].width;
+            }
 
-            image::blur_inplace(images[i]);
+            windows[i].vertical = window_ptr;
+            window_ptr += images[i].width;
+        }
+
+        // The first level is blurred in place, which is fine as a row is
+        // only written once the row below it has been read into the window
+        for (size_t y = 0; y < source.height; y++) {
+            memcpy(windows[0].rows[y % 3],
+                   &source.data[y * source.width],
+                   source.width);
+
+            add_pyramid_row<Backend>(images, windows, 0, y);
         }
     }
 
+    template void
+    ImagePyramid::construct<pyramid::Armv7em>(const Image&, uint8_t*);
+
+#if defined(__SSE2__)
+    template void
+    ImagePyramid::construct<pyramid::Sse2>(const Image&, uint8_t*);
+#endif
+
+#if defined(__ARM_NEON)
+    template void
+    ImagePyramid::construct<pyramid::Neon>(const Image&, uint8_t*);
+#endif
+
+    /**
+     * @return The number of tiles covering @p length pixels.
+     */
+    static inline size_t tiles_along(const size_t length) {
+        return (length + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE;
+    }
+
+    static inline bool is_tile_set(const uint32_t* bitmap, const size_t tile) {
+        return (bitmap[tile / 32] >> (tile % 32)) & 1;
+    }
+
+    static inline void set_tile(uint32_t* bitmap, const size_t tile) {
+        bitmap[tile / 32] |= 1U << (tile % 32);
+    }
+
+    void ImagePyramid::construct_lazy(const Image& source,
+                                      uint8_t* pyramid_buffer) {
+
+        TRACE_ZONE(ZONE_PYRAMID);
+
+        if (tiles_along(source.width) * tiles_along(source.height) >
+            PYRAMID_TILE_BITMAP_WORDS * 32) {
+            construct<pyramid::DefaultBackend>(source, pyramid_buffer);
+            return;
+        }
+
+        lazy = true;
+
+        memset(raw_tiles, 0, sizeof(raw_tiles));
+        memset(tiles, 0, sizeof(tiles));
+        complete_levels = 0;
+
+        raw_images[0] = source;
+
+        images[0].width  = source.width;
+        images[0].height = source.height;
+        images[0].data   = pyramid_buffer;
+
+        size_t offset = source.width * source.height;
+
+        for (size_t i = 1; i < PYRAMID_LEVELS; i++) {
+            const size_t width  = images[i - 1].width >> 1;
+            const size_t height = images[i - 1].height >> 1;
+
+            raw_images[i] = Image(pyramid_buffer + offset, width, height);
+            offset += width * height;
+
+            images[i] = Image(pyramid_buffer + offset, width, height);
+            offset += width * height;
+        }
+    }
+
+    /**
+     * @brief Blurs the region [@p x0, @p x1) x [@p y0, @p y1) of @p raw into
+     * @p image, which yields the same pixels as construct. The pixels of
+     * @p raw one pixel around the region have to be computed.
+     */
+    static void blur_region(const Image& raw,
+                            const Image& image,
+                            const size_t x0,
+                            const size_t y0,
+                            const size_t x1,
+                            const size_t y1) {
+
+        const size_t width = image.width;
+
+        // The columns of the vertical pass, including the neighbouring ones
+        // needed by the horizontal pass
+        const size_t start = x0 > 0 ? x0 - 1 : 0;
+        const size_t end   = x1 < width ? x1 + 1 : width;
+
+        uint8_t vertical[end - start];
+
+        for (size_t y = y0; y < y1; y++) {
+            const uint8_t* row = &raw.data[y * width];
+            uint8_t* out       = &image.data[y * width];
+
+            // The pixels at the border are not blurred, as in construct
+            if (y == 0 || y == image.height - 1) {
+                memcpy(&out[x0], &row[x0], x1 - x0);
+                continue;
+            }
+
+            pyramid::DefaultBackend::blur_vertical(&row[start - width],
+                                                   &row[start],
+                                                   &row[start + width],
+                                                   vertical,
+                                                   end - start);
+
+            if (x0 == 0) {
+                out[0] = row[0];
+            }
+
+            if (x1 == width) {
+                out[width - 1] = row[width - 1];
+            }
+
+            pyramid::DefaultBackend::blur_horizontal(vertical,
+                                                     &out[start],
+                                                     end - start);
+        }
+    }
+
+    void ImagePyramid::ensure_raw_tile(const size_t level,
+                                       const size_t tile_x,
+                                       const size_t tile_y) {
+
+        // The source is always complete
+        if (level == 0) {
+            return;
+        }
+
+        const Image& image = raw_images[level];
+        const size_t tile  = tile_y * tiles_along(image.width) + tile_x;
+
+        if (is_tile_set(raw_tiles[level], tile)) {
+            return;
+        }
+
+        // The tile is the 2x2 average of the two by two tiles of the level
+        // above, which are at the bottom and the right edge only partially
+        // covered
+        const Image& above       = raw_images[level - 1];
+        const size_t above_tiles = tiles_along(above.width);
+
+        for (size_t y = tile_y * 2; y < tile_y * 2 + 2; y++) {
+            for (size_t x = tile_x * 2; x < tile_x * 2 + 2 && x < above_tiles;
+                 x++) {
+                if (y < tiles_along(above.height)) {
+                    ensure_raw_tile(level - 1, x, y);
+                }
+            }
+        }
+
+        const size_t x0 = tile_x * PYRAMID_TILE_SIZE;
+        const size_t y0 = tile_y * PYRAMID_TILE_SIZE;
+        const size_t x1 = x0 + PYRAMID_TILE_SIZE < image.width
+                              ? x0 + PYRAMID_TILE_SIZE
+                              : image.width;
+        const size_t y1 = y0 + PYRAMID_TILE_SIZE < image.height
+                              ? y0 + PYRAMID_TILE_SIZE
+                              : image.height;
+
+        for (size_t y = y0; y < y1; y++) {
+            pyramid::DefaultBackend::downsample(
+                &above.data[y * 2 * above.width + x0 * 2],
+                &above.data[(y * 2 + 1) * above.width + x0 * 2],
+                &image.data[y * image.width + x0],
+                x1 - x0);
+        }
+
+        set_tile(raw_tiles[level], tile);
+    }
+
+    void ImagePyramid::ensure_tile(const size_t level,
+                                   const size_t tile_x,
+                                   const size_t tile_y) {
+
+        const Image& raw   = raw_images[level];
+        const Image& image = images[level];
+
+        const size_t tiles_x = tiles_along(image.width);
+        const size_t tiles_y = tiles_along(image.height);
+        const size_t tile    = tile_y * tiles_x + tile_x;
+
+        if (is_tile_set(tiles[level], tile)) {
+            return;
+        }
+
+        // The blur reaches one pixel into the neighbouring tiles
+        for (size_t y = tile_y > 0 ? tile_y - 1 : 0;
+             y <= tile_y + 1 && y < tiles_y;
+             y++) {
+            for (size_t x = tile_x > 0 ? tile_x - 1 : 0;
+                 x <= tile_x + 1 && x < tiles_x;
+                 x++) {
+                ensure_raw_tile(level, x, y);
+            }
+        }
+
+        const size_t x0 = tile_x * PYRAMID_TILE_SIZE;
+        const size_t y0 = tile_y * PYRAMID_TILE_SIZE;
+        const size_t x1 = x0 + PYRAMID_TILE_SIZE < image.width
+                              ? x0 + PYRAMID_TILE_SIZE
+                              : image.width;
+        const size_t y1 = y0 + PYRAMID_TILE_SIZE < image.height
+                              ? y0 + PYRAMID_TILE_SIZE
+                              : image.height;
+
+        blur_region(raw, image, x0, y0, x1, y1);
+
+        set_tile(tiles[level], tile);
+    }
+
     image::Image* ImagePyramid::at(const size_t pyramid_level) {
-        return &images[pyramid_level];
+        Image* image = &images[pyramid_level];
+
+        if (!lazy || (complete_levels >> pyramid_level) & 1) {
+            return image;
+        }
+
+        const size_t tiles_x = tiles_along(image->width);
+        const size_t tiles_y = tiles_along(image->height);
+
+        for (size_t tile_y = 0; tile_y < tiles_y; tile_y++) {
+            for (size_t tile_x = 0; tile_x < tiles_x; tile_x++) {
+                ensure_raw_tile(pyramid_level, tile_x, tile_y);
+            }
+        }
+
+        // Blurring the whole level at once is faster than tile by tile, and
+        // the tiles computed already are recomputed to the same pixels
+        blur_region(raw_images[pyramid_level],
+                    *image,
+                    0,
+                    0,
+                    image->width,
+                    image->height);
+
+        for (size_t tile = 0; tile < tiles_x * tiles_y; tile++) {
+            set_tile(tiles[pyramid_level], tile);
+        }
+
+        complete_levels |= 1 << pyramid_level;
+
+        return image;
+    }
+
+    image::Image* ImagePyramid::at(const size_t pyramid_level,
+                                   const int32_t x,
+                                   const int32_t y,
+                                   const int32_t width,
+                                   const int32_t height) {
+
+        Image* image = &images[pyramid_level];
+
+        if (!lazy || width <= 0 || height <= 0 || image->width == 0 ||
+            image->height == 0) {
+            return image;
+        }
+
+        const int32_t last_x = (int32_t)image->width - 1;
+        const int32_t last_y = (int32_t)image->height - 1;
+
+        const size_t tile_x0 = clamp(x, 0, last_x) / PYRAMID_TILE_SIZE;
+        const size_t tile_y0 = clamp(y, 0, last_y) / PYRAMID_TILE_SIZE;
+        const size_t tile_x1 = clamp(x + width - 1, 0, last_x) /
+                               PYRAMID_TILE_SIZE;
+        const size_t tile_y1 = clamp(y + height - 1, 0, last_y) /
+                               PYRAMID_TILE_SIZE;
+
+        for (size_t tile_y = tile_y0; tile_y <= tile_y1; tile_y++) {
+            for (size_t tile_x = tile_x0; tile_x <= tile_x1; tile_x++) {
+                ensure_tile(pyramid_level, tile_x, tile_y);
+            }
+        }
+
+        return image;
     }
 
     // ---------------------------- Patch ------------------------------------
 
-    Patch::Patch(const float x, const float y, const image::Image& image)
+    template <uint16_t Size>
+    BasicPatch<Size>::BasicPatch(const float x,
+                                 const float y,
+                                 const image::Image& image)
         : origin{x, y} {
 
         int_fast32_t start_point_x = floor(x);
@@ -214,9 +863,9 @@ namespace image {
         // First want to copy over the data and append an extra
         // border to the left and top edge for interpolation
         uint8_t
-            buffer[(PATCH_SIZE_WITH_BORDER + 2) * (PATCH_SIZE_WITH_BORDER + 2)];
+            buffer[(SIZE_WITH_BORDER + 2) * (SIZE_WITH_BORDER + 2)];
 
-        for (int_fast32_t j = 0; j < (int_fast32_t)PATCH_SIZE_WITH_BORDER + 2;
+        for (int_fast32_t j = 0; j < (int_fast32_t)SIZE_WITH_BORDER + 2;
              j++) {
 
             // Make sure that the patch don't go outside bounds of the
@@ -225,12 +874,12 @@ namespace image {
             int_fast32_t ys = clamp(start_point_y + j - 2, 0, image.height - 1);
 
             for (int_fast32_t i = 0;
-                 i < (int_fast32_t)PATCH_SIZE_WITH_BORDER + 2;
+                 i < (int_fast32_t)SIZE_WITH_BORDER + 2;
                  i++) {
                 int_fast32_t xs =
                     clamp(start_point_x + i - 2, 0, image.width - 1);
 
-                buffer[j * (PATCH_SIZE_WITH_BORDER + 2) + i] =
+                buffer[j * (SIZE_WITH_BORDER + 2) + i] =
                     image.data[ys * image.width + xs];
             }
         }
@@ -238,23 +887,23 @@ namespace image {
         float alpha_x = abs(x - start_point_x);
         float alpha_y = abs(y - start_point_y);
 
-        for (int_fast32_t j = 0; j < (int_fast32_t)PATCH_SIZE_WITH_BORDER;
+        for (int_fast32_t j = 0; j < (int_fast32_t)SIZE_WITH_BORDER;
              j++) {
 
-            for (int_fast32_t i = 0; i < (int_fast32_t)PATCH_SIZE_WITH_BORDER;
+            for (int_fast32_t i = 0; i < (int_fast32_t)SIZE_WITH_BORDER;
                  i++) {
 
                 // Store values for interpolating at sub-pixel level
                 const float I =
-                    buffer[(j + 1) * (PATCH_SIZE_WITH_BORDER + 2) + i + 1];
+                    buffer[(j + 1) * (SIZE_WITH_BORDER + 2) + i + 1];
                 const float I_x_shift =
-                    buffer[(j + 1) * (PATCH_SIZE_WITH_BORDER + 2) + i + 2];
+                    buffer[(j + 1) * (SIZE_WITH_BORDER + 2) + i + 2];
                 const float I_y_shift =
-                    buffer[(j + 2) * (PATCH_SIZE_WITH_BORDER + 2) + i + 1];
+                    buffer[(j + 2) * (SIZE_WITH_BORDER + 2) + i + 1];
                 const float I_xy_shift =
-                    buffer[(j + 2) * (PATCH_SIZE_WITH_BORDER + 2) + i + 2];
+                    buffer[(j + 2) * (SIZE_WITH_BORDER + 2) + i + 2];
 
-                data[j * PATCH_SIZE_WITH_BORDER + i] =
+                data[j * SIZE_WITH_BORDER + i] =
                     (1 - alpha_x) * (1 - alpha_y) * I +
                     alpha_x * (1 - alpha_y) * I_x_shift +
                     (1 - alpha_x) * alpha_y * I_y_shift +
@@ -263,139 +912,269 @@ namespace image {
         }
     }
 
-    float* Patch::row(int index) {
-        return &data[(index + 1) * (PATCH_SIZE_WITH_BORDER) + 1];
+    template <uint16_t Size> float* BasicPatch<Size>::row(int index) {
+        return &data[(index + 1) * (SIZE_WITH_BORDER) + 1];
+    }
+
+    template <uint16_t Size>
+    const float* BasicPatch<Size>::row(int index) const {
+        return &data[(index + 1) * (SIZE_WITH_BORDER) + 1];
     }
 
-    void Patch::print() {
+    template <uint16_t Size> void BasicPatch<Size>::print() {
 
-        for (size_t j = 0; j < PATCH_SIZE_WITH_BORDER; j++) {
-            for (size_t i = 0; i < PATCH_SIZE_WITH_BORDER; i++) {
+        for (size_t j = 0; j < SIZE_WITH_BORDER; j++) {
+            for (size_t i = 0; i < SIZE_WITH_BORDER; i++) {
 
-                printf("%3.f ", data[j * PATCH_SIZE_WITH_BORDER + i]);
+                printf("%3.f ", data[j * SIZE_WITH_BORDER + i]);
             }
 
             printf("\r\n");
         }
     }
 
-    void dx(const Patch& source, Patch& destination) {
+    template <uint16_t Size>
+    void dx(const BasicPatch<Size>& source, BasicPatch<Size>& destination) {
 
         destination.origin.x = source.origin.x;
         destination.origin.y = source.origin.y;
 
+        constexpr int_fast32_t w = BasicPatch<Size>::SIZE_WITH_BORDER;
+
         float kernel[3][3] = {{-1, 1}, {-2, 2}, {-1, 1}};
 
-        for (int_fast32_t j = 1; j < PATCH_SIZE + 1; j++) {
-            for (int_fast32_t i = 1; i < PATCH_SIZE + 1; i++) {
+        for (int_fast32_t j = 1; j < Size + 1; j++) {
+            for (int_fast32_t i = 1; i < Size + 1; i++) {
 
                 // Here we utilize the border so that we can take the gradient
                 // on the patch without having to omit pixels
-                destination.data[j * PATCH_SIZE_WITH_BORDER + i] =
-                    source.data[(j - 1) * PATCH_SIZE_WITH_BORDER + (i - 1)] *
-                        kernel[0][0] +
-                    source.data[(j - 1) * PATCH_SIZE_WITH_BORDER + (i + 1)] *
-                        kernel[0][1] +
+                destination.data[j * w + i] =
+                    source.data[(j - 1) * w + (i - 1)] * kernel[0][0] +
+                    source.data[(j - 1) * w + (i + 1)] * kernel[0][1] +
 
-                    source.data[j * PATCH_SIZE_WITH_BORDER + (i - 1)] *
-                        kernel[1][0] +
-                    source.data[j * PATCH_SIZE_WITH_BORDER + (i + 1)] *
-                        kernel[1][1] +
+                    source.data[j * w + (i - 1)] * kernel[1][0] +
+                    source.data[j * w + (i + 1)] * kernel[1][1] +
 
-                    source.data[(j + 1) * PATCH_SIZE_WITH_BORDER + (i - 1)] *
-                        kernel[2][0] +
-                    source.data[(j + 1) * PATCH_SIZE_WITH_BORDER + (i + 1)] *
-                        kernel[2][1];
+                    source.data[(j + 1) * w + (i - 1)] * kernel[2][0] +
+                    source.data[(j + 1) * w + (i + 1)] * kernel[2][1];
             }
         }
     }
 
-    void dy(const Patch& source, Patch& destination) {
+    template <uint16_t Size>
+    void dy(const BasicPatch<Size>& source, BasicPatch<Size>& destination) {
         destination.origin.x = source.origin.x;
         destination.origin.y = source.origin.y;
 
+        constexpr int_fast32_t w = BasicPatch<Size>::SIZE_WITH_BORDER;
+
         float kernel[2][3] = {{-1, -2, -1}, {1, 2, 1}};
 
-        for (int_fast32_t j = 1; j < PATCH_SIZE + 1; j++) {
-            for (int_fast32_t i = 1; i < PATCH_SIZE + 1; i++) {
+        for (int_fast32_t j = 1; j < Size + 1; j++) {
+            for (int_fast32_t i = 1; i < Size + 1; i++) {
 
                 // Here we utilize the border so that we can take the gradient
                 // on the patch without having to omit pixels
-                destination.data[j * PATCH_SIZE_WITH_BORDER + i] =
-                    source.data[(j - 1) * PATCH_SIZE_WITH_BORDER + (i - 1)] *
-                        kernel[0][0] +
-                    source.data[(j - 1) * PATCH_SIZE_WITH_BORDER + i] *
-                        kernel[0][1] +
+                destination.data[j * w + i] =
+                    source.data[(j - 1) * w + (i - 1)] * kernel[0][0] +
+                    source.data[(j - 1) * w + i] * kernel[0][1] +
 
-                    source.data[(j - 1) * PATCH_SIZE_WITH_BORDER + (i + 1)] *
-                        kernel[0][2] +
-                    source.data[(j + 1) * PATCH_SIZE_WITH_BORDER + (i - 1)] *
-                        kernel[1][0] +
+                    source.data[(j - 1) * w + (i + 1)] * kernel[0][2] +
+                    source.data[(j + 1) * w + (i - 1)] * kernel[1][0] +
 
-                    source.data[(j + 1) * PATCH_SIZE_WITH_BORDER + i] *
-                        kernel[1][1] +
-                    source.data[(j + 1) * PATCH_SIZE_WITH_BORDER + (i + 1)] *
-                        kernel[1][2];
+                    source.data[(j + 1) * w + i] * kernel[1][1] +
+                    source.data[(j + 1) * w + (i + 1)] * kernel[1][2];
             }
         }
     }
 
-    void dt(const Patch& first, const Patch& second, Patch& desitination) {
+    template <uint16_t Size>
+    void dt(const BasicPatch<Size>& first,
+            const BasicPatch<Size>& second,
+            BasicPatch<Size>& desitination) {
         desitination.origin.x = first.origin.x;
         desitination.origin.y = first.origin.y;
 
-        for (int_fast32_t j = 0; j < PATCH_SIZE_WITH_BORDER; j++) {
-            for (int_fast32_t i = 0; i < PATCH_SIZE_WITH_BORDER; i++) {
-                desitination.data[j * PATCH_SIZE_WITH_BORDER + i] =
-                    second.data[j * PATCH_SIZE_WITH_BORDER + i] -
-                    first.data[j * PATCH_SIZE_WITH_BORDER + i];
+        constexpr int_fast32_t w = BasicPatch<Size>::SIZE_WITH_BORDER;
+
+        for (int_fast32_t j = 0; j < w; j++) {
+            for (int_fast32_t i = 0; i < w; i++) {
+                desitination.data[j * w + i] = second.data[j * w + i] -
+                                               first.data[j * w + i];
             }
         }
     }
 
-    void PatchPyramid::construct(image::ImagePyramid& image_pyramid,
-                                 const image::KeyPoint* patch_centre_points,
-                                 const size_t patch_centre_points_size) {
+    /**
+     * @return False, after logging an error, if @p patch_centre_points_size
+     * points do not fit the @p capacity of a patch pyramid.
+     */
+    static bool fits_patch_pyramid(const size_t patch_centre_points_size,
+                                   const size_t capacity) {
 
-        if (patch_centre_points_size > MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL) {
+        if (patch_centre_points_size <= capacity) {
+            return true;
+        }
 
-#ifdef CPU_MIMXRT1166DVM6A
-            logger::errorf("Patch pyramid can't hold %d entries, max: %d\r\n",
-                           patch_centre_points_size,
-                           MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL);
-#else
-            printf("Patch pyramid can't hold %lu entries, max: %d\r\n",
-                   patch_centre_points_size,
-                   MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL);
+        logger::errorf("Patch pyramid can't hold %zu entries, max: %zu\r\n",
+                       patch_centre_points_size,
+                       capacity);
 
-#endif
-            exit(1);
+        return false;
+    }
+
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    bool BasicPatchPyramid<Levels, Size, Capacity>::construct(
+        image::ImagePyramid& image_pyramid,
+        const image::KeyPoint* patch_centre_points,
+        const size_t patch_centre_points_size) {
+
+        TRACE_ZONE(ZONE_PATCHES);
+
+        const bool fits = fits_patch_pyramid(patch_centre_points_size,
+                                             this->capacity());
+
+        // The points beyond the capacity are left out, so the tracker still
+        // tracks the first ones and only marks the rest as stale
+        const size_t size = fits ? patch_centre_points_size
+                                 : this->capacity();
+
+        constexpr int_fast32_t w = BasicPatch<Size>::SIZE_WITH_BORDER;
+
+        for (int pyramid_level = 0; pyramid_level < Levels; pyramid_level++) {
+
+            for (int patch_index = 0;
+                 patch_index < (int_fast32_t)size;
+                 patch_index++) {
+
+                if (patch_centre_points[patch_index].stale) {
+                    continue;
+                }
+
+                // The keypoints are at sub-pixel positions, which the patch
+                // is interpolated to on every level
+                const float scale = 1.0f / (float)(1 << pyramid_level);
+
+                const float x =
+                    (patch_centre_points[patch_index].point.x - Size / 2) *
+                    scale;
+
+                const float y =
+                    (patch_centre_points[patch_index].point.y - Size / 2) *
+                    scale;
+
+                // The patch and the border around it used for the
+                // interpolation
+                this->at(patch_index, pyramid_level) = BasicPatch<Size>(
+                    x,
+                    y,
+                    *image_pyramid.at(pyramid_level,
+                                      (int_fast32_t)floor(x) - 2,
+                                      (int_fast32_t)floor(y) - 2,
+                                      w + 2,
+                                      w + 2));
+            }
         }
 
-        for (int pyramid_level = 0; pyramid_level < PYRAMID_LEVELS;
-             pyramid_level++) {
+        return fits;
+    }
+
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    bool BasicFixedPointPatchPyramid<Levels, Size, Capacity>::construct(
+        image::ImagePyramid& image_pyramid,
+        const image::KeyPoint* patch_centre_points,
+        const size_t patch_centre_points_size) {
+
+        TRACE_ZONE(ZONE_PATCHES);
+
+        const bool fits = fits_patch_pyramid(patch_centre_points_size,
+                                             this->capacity());
+
+        // The points beyond the capacity are left out, so the tracker still
+        // tracks the first ones and only marks the rest as stale
+        const size_t size = fits ? patch_centre_points_size
+                                 : this->capacity();
+
+        constexpr int_fast32_t w = BasicFixedPointPatch<Size>::SIZE_WITH_BORDER;
+
+        for (int pyramid_level = 0; pyramid_level < Levels; pyramid_level++) {
 
             for (int patch_index = 0;
-                 patch_index < (int_fast32_t)patch_centre_points_size;
+                 patch_index < (int_fast32_t)size;
                  patch_index++) {
 
                 if (patch_centre_points[patch_index].stale) {
                     continue;
                 }
 
-                const int x =
-                    (int_fast32_t)((patch_centre_points[patch_index].point.x -
-                                    PATCH_SIZE / 2)) >>
+                // The position with PATCH_FRACTION_BITS, split into the
+                // integer origin of the patch and the fraction the tracker
+                // adds back to the flow
+                const int32_t fixed_x =
+                    (int32_t)floorf(
+                        (patch_centre_points[patch_index].point.x - Size / 2) *
+                        (float)(1 << PATCH_FRACTION_BITS)) >>
                     pyramid_level;
 
-                const int y =
-                    (int_fast32_t)((patch_centre_points[patch_index].point.y -
-                                    PATCH_SIZE / 2)) >>
+                const int32_t fixed_y =
+                    (int32_t)floorf(
+                        (patch_centre_points[patch_index].point.y - Size / 2) *
+                        (float)(1 << PATCH_FRACTION_BITS)) >>
                     pyramid_level;
 
-                patches[patch_index][pyramid_level] =
-                    Patch(x, y, *image_pyramid.at(pyramid_level));
+                const int x = fixed_x >> PATCH_FRACTION_BITS;
+                const int y = fixed_y >> PATCH_FRACTION_BITS;
+
+                BasicFixedPointPatch<Size>& patch = this->at(patch_index,
+                                                             pyramid_level);
+
+                patch.origin_x   = x;
+                patch.origin_y   = y;
+                patch.fraction_x = fixed_x & ((1 << PATCH_FRACTION_BITS) - 1);
+                patch.fraction_y = fixed_y & ((1 << PATCH_FRACTION_BITS) - 1);
+
+                const image::Image& image = *image_pyramid.at(pyramid_level,
+                                                              x - 1,
+                                                              y - 1,
+                                                              w,
+                                                              w);
+
+                // Extrapolate with the intensity values at the border of the
+                // image, as done for Patch
+                for (int_fast32_t j = 0; j < w; j++) {
+
+                    const int_fast32_t ys = clamp(y + j - 1,
+                                                  0,
+                                                  image.height - 1);
+
+                    for (int_fast32_t i = 0; i < w; i++) {
+
+                        const int_fast32_t xs = clamp(x + i - 1,
+                                                      0,
+                                                      image.width - 1);
+
+                        patch.data[j * w + i] =
+                            image.data[ys * image.width + xs];
+                    }
+                }
             }
         }
+
+        return fits;
     }
+
+#define INSTANTIATE_PATCH(size)                                               \
+    template struct BasicPatch<size>;                                         \
+    template void dx<size>(const BasicPatch<size>&, BasicPatch<size>&);       \
+    template void dy<size>(const BasicPatch<size>&, BasicPatch<size>&);       \
+    template void dt<size>(const BasicPatch<size>&,                           \
+                           const BasicPatch<size>&,                           \
+                           BasicPatch<size>&);
+
+#define INSTANTIATE_PATCH_PYRAMIDS(levels, size, capacity)                    \
+    template struct BasicPatchPyramid<levels, size, capacity>;                \
+    template struct BasicFixedPointPatchPyramid<levels, size, capacity>;
+
+    FOR_EACH_PATCH_SIZE(INSTANTIATE_PATCH)
+    FOR_EACH_TRACKER_CONFIGURATION(INSTANTIATE_PATCH_PYRAMIDS)
 }
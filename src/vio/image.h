@@ -7,18 +7,131 @@
 
 #include "linalg.h"
 
-#ifdef CPU_MIMXRT1166DVM6A
-    #include "profile.h"
-#endif
-
+/**
+ * @brief Resolution of the images of the datasets, which the image buffers
+ * and the scratch memory of FAST are sized for.
+ */
+constexpr uint32_t MAX_IMAGE_WIDTH  = 752;
+constexpr uint32_t MAX_IMAGE_HEIGHT = 480;
+
+/**
+ * @brief Size of the image buffers.
+ */
+constexpr uint32_t MAX_IMAGE_SIZE = MAX_IMAGE_WIDTH * MAX_IMAGE_HEIGHT;
+
+/**
+ * @brief Number of levels of an image pyramid, which is the most levels the
+ * tracker can use.
+ */
 constexpr uint16_t PYRAMID_LEVELS = 5;
-constexpr uint16_t PATCH_SIZE     = 7;
+
+/**
+ * @brief Default size of the patches, the tracker can be built for others,
+ * see FOR_EACH_TRACKER_CONFIGURATION.
+ */
+constexpr uint16_t PATCH_SIZE = 7;
 
 constexpr uint16_t PATCH_SIZE_WITH_BORDER                 = PATCH_SIZE + 2;
 constexpr uint16_t MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL = 74;
 
+/**
+ * @brief Capacity of a patch pyramid of which the patches are placed in a
+ * pool when it is initialised, see image::PatchStorage.
+ */
+constexpr uint16_t POOLED_CAPACITY = 0;
+
+/**
+ * @brief Fractional bits of the sub-pixel keypoint position stored in a
+ * fixed-point patch, see image::BasicFixedPointPatch.
+ */
+constexpr uint16_t PATCH_FRACTION_BITS = 16;
+
+/**
+ * @brief Calls @p INSTANTIATE with the number of pyramid levels, the patch
+ * size and the capacity of every configuration of the patch pyramids and the
+ * trackers which is built. A deployment with other parameters adds its
+ * configuration here.
+ */
+#define FOR_EACH_TRACKER_CONFIGURATION(INSTANTIATE)                          \
+    INSTANTIATE(PYRAMID_LEVELS,                                              \
+                PATCH_SIZE,                                                  \
+                MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL)                      \
+    INSTANTIATE(PYRAMID_LEVELS, PATCH_SIZE, POOLED_CAPACITY)                 \
+    INSTANTIATE(3, 5, POOLED_CAPACITY)
+
+/**
+ * @brief Calls @p INSTANTIATE with every patch size of
+ * FOR_EACH_TRACKER_CONFIGURATION, once each.
+ */
+#define FOR_EACH_PATCH_SIZE(INSTANTIATE)                                     \
+    INSTANTIATE(PATCH_SIZE)                                                  \
+    INSTANTIATE(5)
+
+/**
+ * @brief Width and height of the tiles of a lazily built image pyramid, see
+ * ImagePyramid::construct_lazy.
+ */
+constexpr uint16_t PYRAMID_TILE_SIZE = 32;
+
+/**
+ * @brief Number of words of the bitmaps of the valid tiles of a pyramid
+ * level, which fits the tiles of the first level of the largest image.
+ */
+constexpr uint32_t PYRAMID_TILE_BITMAP_WORDS =
+    ((MAX_IMAGE_WIDTH + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE *
+         ((MAX_IMAGE_HEIGHT + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE) +
+     31) /
+    32;
+
+/**
+ * @brief Size of the buffer of a lazily built image pyramid of an image of
+ * MAX_IMAGE_SIZE: the blurred first level, and every lower level both before
+ * and after it is blurred.
+ */
+constexpr uint32_t LAZY_PYRAMID_BUFFER_SIZE = MAX_IMAGE_SIZE +
+                                              2 * (MAX_IMAGE_SIZE / 3);
+
 namespace image {
 
+    /**
+     * @brief Backends for building the image pyramid, selected at compile time
+     * through the template parameter of ImagePyramid::construct. All backends
+     * yield identical pyramids.
+     */
+    namespace pyramid {
+
+        /**
+         * @brief 32 bit ARMv7E-M SIMD instructions, 4 pixels at a time. Used
+         * on the target, and available on the host through the portable
+         * implementations of the instructions.
+         */
+        struct Armv7em;
+
+#if defined(__SSE2__)
+        /**
+         * @brief SSE2, 16 pixels at a time.
+         */
+        struct Sse2;
+#endif
+
+#if defined(__ARM_NEON)
+        /**
+         * @brief NEON, 16 pixels at a time.
+         */
+        struct Neon;
+#endif
+
+#if defined(CPU_MIMXRT1166DVM6A)
+        typedef Armv7em DefaultBackend;
+#elif defined(__SSE2__)
+        typedef Sse2 DefaultBackend;
+#elif defined(__ARM_NEON)
+        typedef Neon DefaultBackend;
+#else
+        typedef Armv7em DefaultBackend;
+#endif
+    }
+
     /**
      * @brief Struct for a 8 bit, 1 channel grayscale image.
      */
@@ -60,7 +173,9 @@ namespace image {
     };
 
     /**
-     * @brief Blurs a image data buffer inplace.
+     * @brief Blurs a image data buffer inplace with the 3x3 Gaussian kernel
+     * [1 2 1]^T [1 2 1] / 16, applied as two rounded [1 2 1] / 4 passes. The
+     * pixels at the border are left as they are.
      *
      * @param image_data The image data buffer.
      * @param image_width Width of image.
@@ -106,7 +221,45 @@ namespace image {
          */
         Image images[PYRAMID_LEVELS] = {};
 
+        /**
+         * @brief If true, the tiles of the levels are only computed when
+         * they are accessed, see construct_lazy.
+         */
+        bool lazy = false;
+
+        /**
+         * @brief The levels before they are blurred, where the first level
+         * is the source image. Only used when lazy.
+         */
+        Image raw_images[PYRAMID_LEVELS] = {};
+
+        /**
+         * @brief Bitmaps of the tiles which have been computed in the raw
+         * images and the images, in row major order. Only used when lazy.
+         */
+        uint32_t raw_tiles[PYRAMID_LEVELS][PYRAMID_TILE_BITMAP_WORDS] = {};
+        uint32_t tiles[PYRAMID_LEVELS][PYRAMID_TILE_BITMAP_WORDS]     = {};
+
+        /**
+         * @brief Bitmask of the levels which have been computed completely.
+         * Only used when lazy.
+         */
+        uint8_t complete_levels = 0;
+
+        void ensure_raw_tile(const size_t level,
+                             const size_t tile_x,
+                             const size_t tile_y);
+
+        void ensure_tile(const size_t level,
+                         const size_t tile_x,
+                         const size_t tile_y);
+
       public:
+        /**
+         * @brief Initializes an empty pyramid.
+         */
+        ImagePyramid() {}
+
         /**
          * @brief Constructs an image pyramid from a @p image. Note that the
          * first level in the pyramid will refer to the image passed to this
@@ -121,45 +274,95 @@ namespace image {
         ImagePyramid(const Image& source, uint8_t* pyramid_buffer);
 
         /**
-         * @return A pointer to the image at the given @p pyramid_level.
+         * @brief Builds the pyramid as the constructor does, with @p Backend
+         * (see image::pyramid).
+         *
+         * Every level is the 2x2 average of the level above it before it is
+         * blurred (see blur_inplace). The levels are built in a single pass
+         * over @p source: every row is read into a window of three rows of
+         * its level, from which the row above it is blurred and every second
+         * row is averaged with the one before into the level below, so the
+         * image is only read and written once.
+         */
+        template <typename Backend>
+        void construct(const Image& source, uint8_t* pyramid_buffer);
+
+        /**
+         * @brief Sets up the pyramid of @p source without computing any of
+         * it. The levels are computed per tile of PYRAMID_TILE_SIZE when they
+         * are first accessed through at, to the same values as construct.
+         * When only the neighbourhoods of the tracked features are accessed,
+         * most of the pyramid is never computed.
+         *
+         * The source image is left as it is, and the first level is placed
+         * in @p pyramid_buffer as well, which has to hold
+         * LAZY_PYRAMID_BUFFER_SIZE bytes. Images with more tiles than the
+         * bitmaps hold are built eagerly with construct instead.
+         */
+        void construct_lazy(const Image& source, uint8_t* pyramid_buffer);
+
+        /**
+         * @return A pointer to the image at the given @p pyramid_level, which
+         * is computed completely if the pyramid is lazy (e.g. for FAST).
          */
         image::Image* at(const size_t pyramid_level);
+
+        /**
+         * @return A pointer to the image at the given @p pyramid_level, where
+         * only the region of @p width by @p height at @p x, @p y (clamped to
+         * the image) is guaranteed to be computed.
+         */
+        image::Image* at(const size_t pyramid_level,
+                         const int32_t x,
+                         const int32_t y,
+                         const int32_t width,
+                         const int32_t height);
     };
 
-    struct Patch;
+    template <uint16_t Size> struct BasicPatch;
 
     /**
      * @brief Takes the x gradient of @p source and places it in @p
      * destination with use of convolution using a Sobel kernel.
      */
-    void dx(const Patch& source, Patch& destination);
+    template <uint16_t Size>
+    void dx(const BasicPatch<Size>& source, BasicPatch<Size>& destination);
 
     /**
      * @brief Takes the y gradient of @p source and places it in @p
      * destination with use of convolution using a Sobel kernel.
      */
-    void dy(const Patch& source, Patch& destination);
+    template <uint16_t Size>
+    void dy(const BasicPatch<Size>& source, BasicPatch<Size>& destination);
 
     /**
      * @brief Takes the time gradient from @p first and @p second and places
      * it in @p destination.
      */
-    void dt(const Patch& first, const Patch& second, Patch& destination);
+    template <uint16_t Size>
+    void dt(const BasicPatch<Size>& first,
+            const BasicPatch<Size>& second,
+            BasicPatch<Size>& destination);
 
     /**
-     * @brief A patch of a given image.
+     * @brief A patch of a given image, of @p Size by @p Size pixels.
      *
      * @note The data of the patch is stored in floats, in order to make
      * gradients more precise.
      */
-    struct Patch {
+    template <uint16_t Size> struct BasicPatch {
+        static_assert(Size % 2 == 1, "The patch needs a centre pixel");
+
+        static constexpr uint16_t SIZE             = Size;
+        static constexpr uint16_t SIZE_WITH_BORDER = Size + 2;
+
       private:
         /**
          * @brief The data of the patch. Note that we store a border around
          * the patch in order e.g. be able to take the gradient of the whole
          * patch (excluding the border), without having omit pixels.
          */
-        float data[PATCH_SIZE_WITH_BORDER * PATCH_SIZE_WITH_BORDER];
+        float data[SIZE_WITH_BORDER * SIZE_WITH_BORDER];
 
       public:
         /**
@@ -171,7 +374,7 @@ namespace image {
         /**
          * @brief Initializes the patch with empty data.
          */
-        Patch() : origin{0, 0} { memset(data, 0, sizeof(data)); }
+        BasicPatch() : origin{0, 0} { memset(data, 0, sizeof(data)); }
 
         /**
          * @brief Initializes the Patch with a start point and a reference
@@ -182,67 +385,210 @@ namespace image {
          * @param y Start position of patch in y direction.
          * @param image Where to grab the values for the patch from.
          */
-        Patch(const float x, const float y, const image::Image& image);
+        BasicPatch(const float x, const float y, const image::Image& image);
 
         /**
          * @return A pointer to the @p index row. The pointer will point to
          * the value after the border at each row.
          */
         float* row(int index);
+        const float* row(int index) const;
 
-        friend void dx(const Patch& source, Patch& destination);
-        friend void dy(const Patch& source, Patch& destination);
-        friend void
-        dt(const Patch& first, const Patch& second, Patch& destination);
+        friend void dx<Size>(const BasicPatch& source,
+                             BasicPatch& destination);
+        friend void dy<Size>(const BasicPatch& source,
+                             BasicPatch& destination);
+        friend void dt<Size>(const BasicPatch& first,
+                             const BasicPatch& second,
+                             BasicPatch& destination);
 
         void print();
     };
 
+    typedef BasicPatch<PATCH_SIZE> Patch;
+
     struct KeyPoint {
         linalg::Vec2 point;
         bool stale;
 
+        /**
+         * @brief Pyramid level the keypoint was detected on, 0 for the full
+         * resolution. The point is at level 0 regardless.
+         */
+        uint8_t octave;
+
         KeyPoint() {
             point.x = 0;
             point.y = 0;
             stale   = false;
+            octave  = 0;
         }
 
         KeyPoint(float x, float y) {
             point.x = x;
             point.y = y;
             stale   = false;
+            octave  = 0;
         }
     };
 
     /**
-     * @brief Contains N pyramids of patches, where each level in the
-     * pyramid is downsampled by half for each axis.
+     * @brief The patches of a patch pyramid: @p Levels patches for each of
+     * @p Capacity features, or for as many features as fit in the pool given
+     * to initialise if the capacity is POOLED_CAPACITY.
      */
-    struct PatchPyramid {
+    template <typename PatchType, uint16_t Levels, uint16_t Capacity>
+    struct PatchStorage {
+        PatchType patches[Capacity][Levels];
+
+        /**
+         * @return The patch of @p feature_index at @p pyramid_level.
+         */
+        PatchType& at(const size_t feature_index, const size_t pyramid_level) {
+            return patches[feature_index][pyramid_level];
+        }
+
+        const PatchType& at(const size_t feature_index,
+                            const size_t pyramid_level) const {
+            return patches[feature_index][pyramid_level];
+        }
+
         /**
-         * The patches in the pyramid.
+         * @return The number of features the patches can be held for.
          */
-        image::Patch patches[MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL]
-                            [PYRAMID_LEVELS];
+        size_t capacity() const { return Capacity; }
+    };
+
+    template <typename PatchType, uint16_t Levels>
+    struct PatchStorage<PatchType, Levels, POOLED_CAPACITY> {
+        PatchType* pool      = NULL;
+        size_t pool_capacity = 0;
+
+        /**
+         * @brief Places the patches in @p patch_pool, which holds
+         * @p patch_pool_size patches, e.g. in SDRAM.
+         */
+        void initialise(PatchType* patch_pool, const size_t patch_pool_size) {
+            pool          = patch_pool;
+            pool_capacity = patch_pool_size / Levels;
+        }
+
+        PatchType& at(const size_t feature_index, const size_t pyramid_level) {
+            return pool[feature_index * Levels + pyramid_level];
+        }
+
+        const PatchType& at(const size_t feature_index,
+                            const size_t pyramid_level) const {
+            return pool[feature_index * Levels + pyramid_level];
+        }
+
+        size_t capacity() const { return pool_capacity; }
+    };
+
+    /**
+     * @brief Contains N pyramids of patches, where each level in the
+     * pyramid is downsampled by half for each axis. The tracker uses the
+     * first @p Levels levels of the image pyramid.
+     */
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    struct BasicPatchPyramid
+        : PatchStorage<BasicPatch<Size>, Levels, Capacity> {
+        static_assert(Levels >= 1 && Levels <= PYRAMID_LEVELS,
+                      "The image pyramid does not have that many levels");
+
+        static constexpr uint16_t LEVELS = Levels;
+        static constexpr uint16_t SIZE   = Size;
 
         /**
          * @brief Constructs a patch pyramid with N pyramids equal to the
          * amount of features and M pyramid levels.
          *
-         * @note This will downsample the @p image inplace, and thus modify
-         * it.
+         * @param image_pyramid The pyramid to construct the patches from.
+         * @param patch_centre_points The center points for each patch, at
+         * sub-pixel precision.
+         * @param patch_centre_points_size Size of the patch start points.
+         *
+         * @return False if there are more points than the capacity, in which
+         * case only the patches of the first points up to the capacity are
+         * constructed. The tracker marks the keypoints beyond it as stale.
+         */
+        bool construct(image::ImagePyramid& image_pyramid,
+                       const image::KeyPoint* patch_centre_points,
+                       const size_t patch_centre_points_size);
+    };
+
+    typedef BasicPatchPyramid<PYRAMID_LEVELS,
+                              PATCH_SIZE,
+                              MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL>
+        PatchPyramid;
+
+    /**
+     * @brief A patch with integer intensities, used by the fixed-point
+     * tracker.
+     *
+     * @note The patches of a patch pyramid are placed at the integer position
+     * below the keypoint, so the intensities are exact and there is no need
+     * to store them as floats. This takes a quarter of the memory of a Patch.
+     */
+    template <uint16_t Size> struct BasicFixedPointPatch {
+        static constexpr uint16_t SIZE             = Size;
+        static constexpr uint16_t SIZE_WITH_BORDER = Size + 2;
+
+        /**
+         * @brief The data of the patch, including the border, row major.
+         */
+        uint8_t data[SIZE_WITH_BORDER * SIZE_WITH_BORDER];
+
+        /**
+         * @brief The upper left start point of the patch, excluding the
+         * border.
+         */
+        int16_t origin_x;
+        int16_t origin_y;
+
+        /**
+         * @brief Sub-pixel position of the keypoint relative to the origin,
+         * in 1 / 2^PATCH_FRACTION_BITS pixels. The data is not interpolated
+         * to it, the tracker adds it to the flow of the patch instead.
+         */
+        uint16_t fraction_x;
+        uint16_t fraction_y;
+    };
+
+    typedef BasicFixedPointPatch<PATCH_SIZE> FixedPointPatch;
+
+    /**
+     * @brief Patch pyramid for the fixed-point tracker, see
+     * BasicPatchPyramid.
+     */
+    template <uint16_t Levels, uint16_t Size, uint16_t Capacity>
+    struct BasicFixedPointPatchPyramid
+        : PatchStorage<BasicFixedPointPatch<Size>, Levels, Capacity> {
+        static_assert(Levels >= 1 && Levels <= PYRAMID_LEVELS,
+                      "The image pyramid does not have that many levels");
+
+        static constexpr uint16_t LEVELS = Levels;
+        static constexpr uint16_t SIZE   = Size;
+
+        /**
+         * @brief Constructs the patches in the same way as
+         * BasicPatchPyramid::construct.
          *
          * @param image_pyramid The pyramid to construct the patches from.
-         * Assumes that the first image (at the finest level) is blurred,
-         * but the rest are not.
          * @param patch_centre_points The center points for each patch.
          * @param patch_centre_points_size Size of the patch start points.
+         *
+         * @return False if there are more points than the capacity.
          */
-        void construct(image::ImagePyramid& image_pyramid,
+        bool construct(image::ImagePyramid& image_pyramid,
                        const image::KeyPoint* patch_centre_points,
                        const size_t patch_centre_points_size);
     };
+
+    typedef BasicFixedPointPatchPyramid<PYRAMID_LEVELS,
+                                        PATCH_SIZE,
+                                        MAX_NUMBER_OF_PATCHES_IN_PYRAMID_LEVEL>
+        FixedPointPatchPyramid;
 }
 
 #endif